@@ -0,0 +1,308 @@
+/**
+ * \file batch.c
+ * \brief Implements the batch mode: the collectors run in a loop and their data is streamed to stdout
+ *
+ * Without ncurses, the menus and the update threads, a tick is just the reads of /proc
+ * and the formatting of the records, so the interval can be well below 100 ms. The
+ * records of a tick are formatted into a large buffer, written when it's full and at the
+ * end of the tick, so that a reader of the pipe gets whole ticks with a few write() calls
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "batch.h"
+#include "mem_info.h"
+#include "cpu_info.h"
+#include "process_info.h"
+
+bool batch_parse_format(const char *name, enum batch_format *format)
+{
+    if (strcmp(name, "ndjson") == 0 || strcmp(name, "json") == 0)
+    {
+        *format = BATCH_NDJSON;
+        return true;
+    }
+    if (strcmp(name, "csv") == 0)
+    {
+        *format = BATCH_CSV;
+        return true;
+    }
+    return false;
+}
+
+// writes the bytes in the buffer, retrying after partial writes
+static bool writer_flush(Out_writer_t *w)
+{
+    size_t off = 0;
+    while (off < w->len && w->failed == false)
+    {
+        ssize_t n = write(w->fd, w->buf + off, w->len - off);
+        if (n == -1)
+        {
+            if (errno != EINTR)
+            {
+                w->failed = true;
+            }
+            continue;
+        }
+        off += n;
+    }
+    w->len = 0;
+    return (w->failed == false);
+}
+
+// appends n bytes to the buffer, flushing it first if they don't fit
+static void writer_put(Out_writer_t *w, const char *s, size_t n)
+{
+    while (n > 0)
+    {
+        if (w->len == BATCH_BUFSZ)
+        {
+            writer_flush(w);
+        }
+        size_t chunk = (n < BATCH_BUFSZ - w->len ? n : BATCH_BUFSZ - w->len);
+        memcpy(w->buf + w->len, s, chunk);
+        w->len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+// formats into the buffer, flushing it first if the result doesn't fit (the result must be shorter than the buffer)
+static void writer_printf(Out_writer_t *w, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->len, BATCH_BUFSZ - w->len, fmt, ap);
+    va_end(ap);
+    if (n >= 0 && (size_t)n >= BATCH_BUFSZ - w->len)
+    {
+        writer_flush(w);
+        va_start(ap, fmt);
+        n = vsnprintf(w->buf, BATCH_BUFSZ, fmt, ap);
+        va_end(ap);
+    }
+    if (n > 0)
+    {
+        w->len += ((size_t)n < BATCH_BUFSZ - w->len ? (size_t)n : BATCH_BUFSZ - w->len - 1);
+    }
+}
+
+// writes s as a JSON string (null if s is NULL), escaping quotes, backslashes and control characters
+static void writer_json_string(Out_writer_t *w, const char *s)
+{
+    if (s == NULL)
+    {
+        writer_put(w, "null", 4);
+        return;
+    }
+    writer_put(w, "\"", 1);
+    const char *run = s;
+    for (; *s != '\0'; s++)
+    {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\' || c < 0x20)
+        {
+            writer_put(w, run, s - run);
+            if (c == '"' || c == '\\')
+            {
+                char esc[2] = {'\\', c};
+                writer_put(w, esc, 2);
+            }
+            else
+            {
+                writer_printf(w, "\\u%04x", c);
+            }
+            run = s + 1;
+        }
+    }
+    writer_put(w, run, s - run);
+    writer_put(w, "\"", 1);
+}
+
+// writes s as a CSV field, quoted (with doubled quotes) if it contains a separator, a quote or a newline
+static void writer_csv_string(Out_writer_t *w, const char *s)
+{
+    if (s == NULL)
+    {
+        return;
+    }
+    if (strpbrk(s, ",\"\r\n") == NULL)
+    {
+        writer_put(w, s, strlen(s));
+        return;
+    }
+    writer_put(w, "\"", 1);
+    const char *run = s;
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"')
+        {
+            writer_put(w, run, s + 1 - run);
+            run = s;
+        }
+    }
+    writer_put(w, run, s - run);
+    writer_put(w, "\"", 1);
+}
+
+// the usage of a core (or the whole CPU): what's not idle
+static float core_usage(const struct core_data_t *core)
+{
+    return 100.0 - core->perc[CPU_IDLE] - core->perc[CPU_IOWAIT];
+}
+
+static void write_ndjson(Out_writer_t *w, double time, const Mem_data_t *mem, const CPU_data_t *cpu,
+                         TaskList *tasks, long page_kb)
+{
+    writer_printf(w, "{\"time\":%.3f,\"mem\":{\"total_kb\":%lu,\"free_kb\":%lu,\"available_kb\":%lu,"
+                     "\"buff_cache_kb\":%lu,\"swap_total_kb\":%lu,\"swap_free_kb\":%lu},",
+                  time, mem->total_mem, mem->free_mem, mem->avail_mem, mem->buffer_cached, mem->swp_tot,
+                  mem->swp_free);
+    const struct core_data_t *t = &cpu->total;
+    writer_printf(w, "\"cpu\":{\"usage\":%.1f,\"user\":%.1f,\"nice\":%.1f,\"system\":%.1f,\"iowait\":%.1f,"
+                     "\"irq\":%.1f,\"softirq\":%.1f,\"steal\":%.1f,\"procs_running\":%d,\"procs_blocked\":%d,"
+                     "\"ctxt_per_sec\":%.0f,\"cores\":[",
+                  core_usage(t), t->perc[CPU_USER], t->perc[CPU_NICE], t->perc[CPU_SYSTEM], t->perc[CPU_IOWAIT],
+                  t->perc[CPU_IRQ], t->perc[CPU_SOFTIRQ], t->perc[CPU_STEAL], cpu->procs_running,
+                  cpu->procs_blocked, counter_rate(&cpu->ctxt));
+    for (int c = 0; c < cpu->num_cores; c++)
+    {
+        // offline cores are null
+        if (cpu->percore[c].online == true)
+        {
+            writer_printf(w, (c > 0 ? ",%.1f" : "%.1f"), core_usage(&cpu->percore[c]));
+        }
+        else
+        {
+            writer_put(w, (c > 0 ? ",null" : "null"), (c > 0 ? 5 : 4));
+        }
+    }
+    writer_printf(w, "]},\"processes\":[");
+    for (long i = 0; i < tasks->num_ps; i++)
+    {
+        guint h = task_handle(tasks, i);
+        Task *p = task_at(tasks, h);
+        writer_printf(w, "%s{\"pid\":%d,\"ppid\":%d,\"user\":", (i > 0 ? "," : ""), tasks->cols.pid[h],
+                      tasks->cols.ppid[h]);
+        writer_json_string(w, p->username);
+        writer_printf(w, ",\"state\":\"%c\",\"nice\":%ld,\"cpu\":%lu,\"threads\":%ld,\"vsz_bytes\":%ld,"
+                         "\"rss_kb\":%ld,\"command\":",
+                      tasks->cols.state[h], p->nice, tasks->cols.cpu[h], tasks->cols.num_threads[h],
+                      tasks->cols.virt_size_bytes[h], tasks->cols.resident_set[h] * page_kb);
+        writer_json_string(w, p->command);
+        writer_put(w, "}", 1);
+    }
+    writer_put(w, "]}\n", 3);
+}
+
+static void write_csv_header(Out_writer_t *w)
+{
+    writer_printf(w, "#mem,time,total_kb,free_kb,available_kb,buff_cache_kb,swap_total_kb,swap_free_kb\n");
+    writer_printf(w, "#cpu,time,usage,user,nice,system,iowait,irq,softirq,steal,procs_running,procs_blocked,"
+                     "ctxt_per_sec\n");
+    writer_printf(w, "#proc,time,pid,ppid,user,state,nice,cpu,threads,vsz_bytes,rss_kb,command\n");
+}
+
+static void write_csv(Out_writer_t *w, double time, const Mem_data_t *mem, const CPU_data_t *cpu,
+                      TaskList *tasks, long page_kb)
+{
+    writer_printf(w, "mem,%.3f,%lu,%lu,%lu,%lu,%lu,%lu\n", time, mem->total_mem, mem->free_mem, mem->avail_mem,
+                  mem->buffer_cached, mem->swp_tot, mem->swp_free);
+    const struct core_data_t *t = &cpu->total;
+    writer_printf(w, "cpu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%d,%d,%.0f\n", time, core_usage(t),
+                  t->perc[CPU_USER], t->perc[CPU_NICE], t->perc[CPU_SYSTEM], t->perc[CPU_IOWAIT], t->perc[CPU_IRQ],
+                  t->perc[CPU_SOFTIRQ], t->perc[CPU_STEAL], cpu->procs_running, cpu->procs_blocked,
+                  counter_rate(&cpu->ctxt));
+    for (long i = 0; i < tasks->num_ps; i++)
+    {
+        guint h = task_handle(tasks, i);
+        Task *p = task_at(tasks, h);
+        writer_printf(w, "proc,%.3f,%d,%d,", time, tasks->cols.pid[h], tasks->cols.ppid[h]);
+        writer_csv_string(w, p->username);
+        writer_printf(w, ",%c,%ld,%lu,%ld,%ld,%ld,", tasks->cols.state[h], p->nice, tasks->cols.cpu[h],
+                      tasks->cols.num_threads[h], tasks->cols.virt_size_bytes[h],
+                      tasks->cols.resident_set[h] * page_kb);
+        writer_csv_string(w, p->command);
+        writer_put(w, "\n", 1);
+    }
+}
+
+/**
+ * \brief Runs the collectors in a loop, writing their data to stdout
+ *
+ * At each tick memory, CPU and processes are read (in this thread: no update thread is
+ * started) and written as a record, sorted by PID. The ticks are scheduled on absolute
+ * times of the monotonic clock, so that the interval doesn't drift with the time taken
+ * by a tick; when a tick takes longer than the interval, the next one starts right away
+ * \param [in,out] data The data structures filled by the collectors
+ * \param [in] opts The format, interval and number of ticks
+ * \return Returns the exit status of the program: 0, or 1 if stdout can't be written
+ */
+int run_batch(struct taskmgr_data_t *data, const struct batch_options *opts)
+{
+    Out_writer_t *out = malloc(sizeof(Out_writer_t));
+    if (out == NULL)
+    {
+        return 1;
+    }
+    out->fd = STDOUT_FILENO;
+    out->len = 0;
+    out->failed = false;
+    long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    long long interval_ns = (long long)(opts->interval * 1e9);
+
+    if (opts->format == BATCH_CSV)
+    {
+        write_csv_header(out);
+    }
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (long tick = 0; (opts->count == 0 || tick < opts->count) && out->failed == false; tick++)
+    {
+        if (tick > 0)
+        {
+            long long ns = next.tv_nsec + interval_ns;
+            next.tv_sec += ns / 1000000000LL;
+            next.tv_nsec = ns % 1000000000LL;
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec))
+            {
+                // the last tick took longer than the interval
+                next = now;
+            }
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            {
+            }
+        }
+        get_mem_info(data->mem_stats);
+        get_cpu_info(data->cpu_stats);
+        get_processes_info(data->tasks, data->cpu_stats);
+        g_array_sort_with_data(data->tasks->order, cmp_pid_incr, data->tasks);
+
+        struct timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+        double time = wall.tv_sec + wall.tv_nsec / 1e9;
+        if (opts->format == BATCH_CSV)
+        {
+            write_csv(out, time, data->mem_stats, data->cpu_stats, data->tasks, page_kb);
+        }
+        else
+        {
+            write_ndjson(out, time, data->mem_stats, data->cpu_stats, data->tasks, page_kb);
+        }
+        writer_flush(out);
+    }
+    int ret = (out->failed == true ? 1 : 0);
+    free(out);
+    return ret;
+}
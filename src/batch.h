@@ -0,0 +1,48 @@
+/**
+ * \file batch.h
+ * \brief Headless mode that writes the collected data to stdout as NDJSON or CSV
+ */
+#ifndef BATCH_INCLUDED
+#define BATCH_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "main.h"
+
+// size of the buffer of the output writer (it's flushed when full and at the end of each tick)
+#define BATCH_BUFSZ 65536
+// default interval between ticks (in seconds)
+#define BATCH_INTERVAL 1.0
+
+// the formats of the records written by the batch mode
+enum batch_format
+{
+    BATCH_NDJSON, ///< a JSON object per tick, on its own line
+    BATCH_CSV     ///< a row per record, whose first column is the kind of record (mem, cpu or proc)
+};
+
+// the options of the batch mode, set from the command line
+struct batch_options
+{
+    bool enabled;             ///< flag set to run in batch mode instead of the TUI
+    enum batch_format format; ///< the format of the records
+    double interval;          ///< the interval between ticks (in seconds)
+    long count;               ///< the number of ticks (0 to run until killed)
+};
+
+// a buffered writer on a file descriptor
+typedef struct out_writer_t
+{
+    int fd;
+    size_t len;  ///< the number of bytes in buf not written yet
+    bool failed; ///< flag set if a write failed (such as when the reader closed the pipe)
+    char buf[BATCH_BUFSZ];
+} Out_writer_t;
+
+// parses the name of a format ("ndjson" or "csv"), returning false if it's unknown
+bool batch_parse_format(const char *name, enum batch_format *format);
+// runs the collectors every opts->interval seconds, writing a record per tick to stdout
+int run_batch(struct taskmgr_data_t *data, const struct batch_options *opts);
+
+#endif
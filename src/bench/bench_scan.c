@@ -0,0 +1,160 @@
+/**
+ * \file bench_scan.c
+ * \brief Measures the throughput of get_processes_info() on a generated procfs tree
+ *
+ * A tree with the number of processes given is written in a temporary directory (see
+ * fixture.h) and the collectors read it instead of /proc. The first scan, which reads the
+ * command and owner of every process and fills the arena, is timed on its own; the scans
+ * after it are those of a TUI or a daemon running for a while, and their median and 95th
+ * percentile are reported. They are timed once with the stat files read one at a time and
+ * once with io_uring (if it's available), with the system calls each reader takes per process
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fixture.h"
+#include "collect.h"
+
+// the scans timed after the first one, unless given on the command line
+#define BENCH_SCANS 20
+// the seed of the fixtures, so that every run scans the same tree
+#define BENCH_SEED 42
+
+// the time elapsed since t0, in milliseconds
+static double elapsed_ms(const struct timespec *t0)
+{
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e3 + (t1.tv_nsec - t0->tv_nsec) / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * \brief Times the scans with a reader of the stat files
+ *
+ * The reader of the TaskList is replaced, and a scan warms it up (with io_uring, the kernel
+ * starts the workers that read procfs at the first batch) before the scans timed
+ * \param [in,out] c The collector, which has scanned the tree once
+ * \param [in] uring Whether the stat files are read with io_uring or one at a time
+ * \param [in] scans The scans timed
+ * \param [in] nprocs The processes of the tree
+ * \param [out] times The buffer of the times of the scans (scans of them)
+ * \return Returns false if a scan failed or did not find every process
+ */
+static bool bench_reader(Collect_t *c, bool uring, long scans, long nprocs, double *times)
+{
+    const char *name = (uring == true ? "io_uring" : "sync");
+    Readbatch_t *rb = &c->tasks->stat_batch;
+    readbatch_free(rb);
+    if (readbatch_init(rb, STAT_BUFSZ, uring) == false)
+    {
+        return false;
+    }
+    if (uring == true && rb->ring == NULL)
+    {
+        printf("%-8s: not available (not built in, blocked, or a kernel older than 5.17)\n", name);
+        return true;
+    }
+    bool ok = get_processes_info(c->tasks, c->cpu_stats);
+    unsigned long syscalls = rb->syscalls;
+    struct timespec t0;
+    for (long s = 0; s < scans && ok == true; s++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        ok = get_processes_info(c->tasks, c->cpu_stats);
+        times[s] = elapsed_ms(&t0);
+    }
+    // every process must have been found, whatever its command name
+    if (ok == false || c->tasks->num_ps != nprocs)
+    {
+        fprintf(stderr, "Scan failed (%s): %ld processes found out of %ld\n", name, c->tasks->num_ps, nprocs);
+        return false;
+    }
+    qsort(times, scans, sizeof(double), cmp_double);
+    double median = times[scans / 2];
+    double p95 = times[(scans * 95 - 1) / 100];
+    printf("%-8s: median %.2f ms, p95 %.2f ms over %ld scans (%.0f processes/s), %.3f syscalls per stat file\n", name,
+           median, p95, scans, nprocs / (median / 1e3), (double)(rb->syscalls - syscalls) / scans / nprocs);
+    if (uring == true && rb->ring == NULL)
+    {
+        printf("%-8s: a submission failed, and the files were read synchronously afterwards\n", name);
+    }
+    return true;
+}
+
+/**
+ * \brief The program's main function
+ */
+int main(int argc, char **argv)
+{
+    long nprocs, scans = BENCH_SCANS;
+    if (argc < 2 || argc > 3 || isNumber(argv[1], &nprocs) != 0 || nprocs < 1 ||
+        (argc == 3 && (isNumber(argv[2], &scans) != 0 || scans < 1)))
+    {
+        fprintf(stderr, "Usage: %s PROCESSES [SCANS]\n", argv[0]);
+        return 1;
+    }
+
+    // the tree is written where the temporary files go (tmpfs on most systems, like /proc)
+    const char *tmpdir = getenv("TMPDIR");
+    char root[PROCFS_ROOTMAX + 1];
+    int len = snprintf(root, sizeof(root), "%s/summer-bench.XXXXXX", (tmpdir && *tmpdir ? tmpdir : "/tmp"));
+    if (len < 0 || len >= (int)sizeof(root) || mkdtemp(root) == NULL)
+    {
+        fprintf(stderr, "Cannot create a temporary directory in %s\n", (tmpdir && *tmpdir ? tmpdir : "/tmp"));
+        return 1;
+    }
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (fixture_write(root, nprocs, BENCH_SEED) == false || procfs_set_root(root) == false)
+    {
+        perror(root);
+        fixture_remove(root);
+        return 1;
+    }
+    printf("fixture: %ld processes written in %.0f ms\n", nprocs, elapsed_ms(&t0));
+
+    Collect_t *c = collect_open();
+    if (c == NULL)
+    {
+        fixture_remove(root);
+        return 1;
+    }
+    // the cpu usage of the processes is relative to the total read from stat
+    get_cpu_info(c->cpu_stats);
+
+    int ret = 0;
+    double *times = malloc(scans * sizeof(double));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    bool ok = get_processes_info(c->tasks, c->cpu_stats);
+    double first = elapsed_ms(&t0);
+    if (times == NULL || ok == false || c->tasks->num_ps != nprocs)
+    {
+        fprintf(stderr, "Scan failed: %ld processes found out of %ld\n", c->tasks->num_ps, nprocs);
+        ret = 1;
+    }
+    else
+    {
+        printf("first scan: %.1f ms\n", first);
+        if (bench_reader(c, false, scans, nprocs, times) == false || bench_reader(c, true, scans, nprocs, times) == false)
+        {
+            ret = 1;
+        }
+    }
+
+    free(times);
+    collect_close(c);
+    if (fixture_remove(root) == false)
+    {
+        perror(root);
+        ret = 1;
+    }
+    return ret;
+}
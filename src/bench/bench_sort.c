@@ -0,0 +1,276 @@
+/**
+ * \file bench_sort.c
+ * \brief Compares the memory and the sorting time of the process list with and without the columns
+ *
+ * A TaskList is filled with synthetic processes, as a replay fills it (see add_task()), and
+ * the same processes are copied into an array of records with the layout struct task had
+ * before the fields read at each scan moved to the columns of the TaskList. For each sorting
+ * mode both are shuffled in the same order and sorted with g_array_sort_with_data(): the
+ * records are moved by value, while the TaskList moves its handles and reads the columns.
+ * The median of the runs is reported, with the bytes of each layout: the fields read only
+ * when needed (struct task_extra) take no room until they are read, as in a replay
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "collect.h"
+
+// the sorts timed for each mode, unless given on the command line
+#define SORT_RUNS 10
+// the seed of the processes and of the shuffles, so that every run sorts the same lists
+#define SORT_SEED 42
+// the user ids the processes are spread over
+#define SORT_USERS 500
+
+// a process with the layout of struct task before the columns (its hot fields inline)
+struct task_aos
+{
+    bool visible;
+    bool present;
+    bool highlight;
+    int pid;
+    int ppid;
+    int userid;
+    char *username;
+    char *command;
+    char **args;
+    char state;
+    unsigned long int cpu_usr;
+    unsigned long int cpu_sys;
+    long int nice;
+    long int num_threads;
+    long int virt_size_bytes;
+    long int resident_set;
+    unsigned long long start_time;
+    Cgroup *cgroup;
+    struct counter io[TASK_IO_NKEYS];
+    bool io_denied;
+    unsigned long pss_kb;
+    unsigned long uss_kb;
+    unsigned long swap_kb;
+    double smaps_time;
+    bool smaps_denied;
+    unsigned long shown_frame;
+    long int num_fds;
+    double fds_time;
+    bool fds_denied;
+    long int num_conns;
+    double conns_time;
+    bool details_pending;
+};
+
+// the comparators of the records, as they were before the columns
+static int aos_pid_incr(const void *a, const void *b, void *data)
+{
+    (void)data;
+    return ((const struct task_aos *)a)->pid - ((const struct task_aos *)b)->pid;
+}
+
+static int aos_nthreads_decr(const void *a, const void *b, void *data)
+{
+    (void)data;
+    return ((const struct task_aos *)b)->num_threads - ((const struct task_aos *)a)->num_threads;
+}
+
+static int aos_cpu_decr(const void *a, const void *b, void *data)
+{
+    (void)data;
+    unsigned long ca = ((const struct task_aos *)a)->cpu_usr + ((const struct task_aos *)a)->cpu_sys;
+    unsigned long cb = ((const struct task_aos *)b)->cpu_usr + ((const struct task_aos *)b)->cpu_sys;
+    return (cb > ca) - (cb < ca);
+}
+
+static int aos_commands(const void *a, const void *b, void *data)
+{
+    (void)data;
+    const char *ca = ((const struct task_aos *)a)->command, *cb = ((const struct task_aos *)b)->command;
+    if (ca == NULL || cb == NULL)
+    {
+        return (ca == NULL) - (cb == NULL);
+    }
+    return strcasecmp(ca, cb);
+}
+
+// a sorting mode, with its comparator for each layout
+struct sort_mode
+{
+    const char *name;
+    int (*aos)(const void *, const void *, void *);
+    int (*columns)(const void *, const void *, void *);
+};
+
+static const struct sort_mode sort_modes[] = {
+    {"PID incr", aos_pid_incr, cmp_pid_incr},
+    {"threads decr", aos_nthreads_decr, cmp_nthreads_decr},
+    {"CPU decr", aos_cpu_decr, cmp_cpu_decr},
+    {"command", aos_commands, cmp_commands},
+};
+
+static double now_ms(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * \brief Fills the TaskList and the records with the same synthetic processes, by increasing PID
+ * \param [in,out] tasks The TaskList (emptied first)
+ * \param [out] aos The records (nprocs of them)
+ * \param [in] nprocs The processes
+ * \return Returns false if the processes could not be allocated
+ */
+static bool fill_tasks(TaskList *tasks, struct task_aos *aos, long nprocs)
+{
+    static const char *names[] = {"systemd", "bash", "sshd: user@pts/0", "postgres: checkpointer", "kworker/3:1",
+                                  "nginx: worker process", "python3 -m http.server", "java -Xmx4g -jar app.jar"};
+    char command[64];
+    int pid = 1;
+    str_arena_begin(&tasks->strings);
+    reset_tasks(tasks);
+    for (long i = 0; i < nprocs; i++)
+    {
+        pid += 1 + rand() % 4;
+        Task t;
+        memset(&t, 0, sizeof(Task));
+        t.visible = true;
+        t.present = true;
+        t.pid = pid;
+        t.userid = rand() % SORT_USERS;
+        snprintf(command, sizeof(command), "%s %ld", names[rand() % (sizeof(names) / sizeof(names[0]))], i);
+        t.command = str_arena_strdup(&tasks->strings, command);
+        t.start_time = rand();
+        struct task_stat st = {pid, 1 + rand() % pid, "RSSDI"[rand() % 5], rand() % 1000, rand() % 40 - 20,
+                               1 + rand() % 64, (long)(rand() % 4096) << 20, rand() % 65536, t.start_time};
+        if (add_task(tasks, &t, &st) == false)
+        {
+            return false;
+        }
+        struct task_aos *a = &aos[i];
+        memset(a, 0, sizeof(struct task_aos));
+        a->visible = true;
+        a->present = true;
+        a->pid = st.pid;
+        a->ppid = st.ppid;
+        a->userid = t.userid;
+        a->command = t.command;
+        a->state = st.state;
+        a->cpu_usr = st.cpu / 2;
+        a->cpu_sys = st.cpu - st.cpu / 2;
+        a->nice = st.nice;
+        a->num_threads = st.num_threads;
+        a->virt_size_bytes = st.virt_size_bytes;
+        a->resident_set = st.resident_set;
+        a->start_time = st.start_time;
+    }
+    str_arena_reclaim(&tasks->strings);
+    return true;
+}
+
+/**
+ * \brief The program's main function
+ */
+int main(int argc, char **argv)
+{
+    long nprocs, runs = SORT_RUNS;
+    if (argc < 2 || argc > 3 || isNumber(argv[1], &nprocs) != 0 || nprocs < 1 ||
+        (argc == 3 && (isNumber(argv[2], &runs) != 0 || runs < 1)))
+    {
+        fprintf(stderr, "Usage: %s PROCESSES [RUNS]\n", argv[0]);
+        return 1;
+    }
+    srand(SORT_SEED);
+    TaskList *tasks = tasklist_new(0);
+    struct task_aos *aos = malloc(nprocs * sizeof(struct task_aos));
+    long *perm = malloc(nprocs * sizeof(long));
+    double *times = malloc(runs * sizeof(double));
+    GArray *records = g_array_sized_new(false, false, sizeof(struct task_aos), nprocs);
+    if (tasks == NULL || aos == NULL || perm == NULL || times == NULL || fill_tasks(tasks, aos, nprocs) == false)
+    {
+        fprintf(stderr, "Cannot allocate %ld processes\n", nprocs);
+        g_array_free(records, true);
+        free(times);
+        free(perm);
+        free(aos);
+        if (tasks != NULL)
+        {
+            tasklist_free(tasks);
+        }
+        return 1;
+    }
+
+    // the bytes of each layout: the columns and the handles are what the numeric sorts read
+    size_t column_bytes = sizeof(int) * 2 + sizeof(char) + sizeof(unsigned long) * 2 + sizeof(long) * 3;
+    size_t before = nprocs * sizeof(struct task_aos);
+    size_t after = nprocs * (sizeof(Task) + column_bytes + sizeof(guint)) + tasks->extras->len * sizeof(struct task_extra);
+    printf("%ld processes\n", nprocs);
+    printf("before: struct task %zu B, %zu KiB\n", sizeof(struct task_aos), before / 1024);
+    printf("after:  Task %zu B + %zu B of columns + %zu B of handle, %zu KiB (%zu KiB of columns and handles)\n",
+           sizeof(Task), column_bytes, sizeof(guint), after / 1024, nprocs * (column_bytes + sizeof(guint)) / 1024);
+    printf("        + %zu B of struct task_extra per process whose I/O, memory, open files or sockets are read "
+           "(%u here)\n",
+           sizeof(struct task_extra), tasks->extras->len);
+
+    for (size_t m = 0; m < sizeof(sort_modes) / sizeof(sort_modes[0]); m++)
+    {
+        double median[2];
+        for (int layout = 0; layout < 2; layout++)
+        {
+            for (long r = 0; r < runs; r++)
+            {
+                // the same shuffle for both layouts
+                srand(SORT_SEED + r);
+                for (long i = 0; i < nprocs; i++)
+                {
+                    perm[i] = i;
+                }
+                for (long i = nprocs - 1; i > 0; i--)
+                {
+                    long j = rand() % (i + 1), tmp = perm[i];
+                    perm[i] = perm[j];
+                    perm[j] = tmp;
+                }
+                double t0;
+                if (layout == 0)
+                {
+                    g_array_set_size(records, 0);
+                    for (long i = 0; i < nprocs; i++)
+                    {
+                        g_array_append_val(records, aos[perm[i]]);
+                    }
+                    t0 = now_ms();
+                    g_array_sort_with_data(records, sort_modes[m].aos, NULL);
+                }
+                else
+                {
+                    for (long i = 0; i < nprocs; i++)
+                    {
+                        task_handle(tasks, i) = perm[i];
+                    }
+                    t0 = now_ms();
+                    g_array_sort_with_data(tasks->order, sort_modes[m].columns, tasks);
+                }
+                times[r] = now_ms() - t0;
+            }
+            qsort(times, runs, sizeof(double), cmp_double);
+            median[layout] = times[runs / 2];
+        }
+        printf("sort by %-12s: before %7.2f ms, after %7.2f ms (median of %ld)\n", sort_modes[m].name, median[0],
+               median[1], runs);
+    }
+
+    g_array_free(records, true);
+    free(times);
+    free(perm);
+    free(aos);
+    tasklist_free(tasks);
+    return 0;
+}
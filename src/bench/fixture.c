@@ -0,0 +1,303 @@
+/**
+ * \file fixture.c
+ * \brief Generates fake procfs trees, to benchmark the scan on any number of processes
+ */
+#define _XOPEN_SOURCE 700 // for nftw
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fixture.h"
+
+// the size of the buffer where each file is formatted (the long command lines are shorter)
+#define FIXTURE_BUFSZ 16384
+
+// the commands of the processes: the kernel threads have no command line
+static const struct
+{
+    const char *comm;  ///< the name in stat and comm
+    const char *argv0; ///< the first argument of cmdline, NULL for a kernel thread
+} commands[] = {
+    {"systemd", "/usr/lib/systemd/systemd"},
+    {"kworker/0:1-events", NULL},
+    {"(sd-pam)", "(sd-pam)"},
+    {"a) b (c", "./a) b (c"},
+    {"Web Content", "/usr/lib/firefox/firefox"},
+    {"bash", "-bash"},
+    {"python3", "/usr/bin/python3"},
+    {"postgres: writer", "postgres: writer"},
+    {"ksoftirqd/3", NULL},
+    {"java", "/usr/lib/jvm/bin/java"},
+    {"sshd", "sshd: user@pts/0"},
+    {"node", "/usr/bin/node"},
+};
+#define NUM_COMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+// the states of the processes, mostly sleeping as on a real system
+static const char states[] = "SSSSSSSSRRIDZT";
+
+// writes a whole file in the directory dirfd
+static bool write_file(int dirfd, const char *name, const char *buf, size_t len)
+{
+    int fd = openat(dirfd, name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        return false;
+    }
+    bool ok = (write(fd, buf, len) == (ssize_t)len);
+    return (close(fd) == 0 && ok);
+}
+
+// writes a formatted file in the directory dirfd
+static bool write_formatted(int dirfd, const char *name, char *buf, int len)
+{
+    return (len > 0 && len < FIXTURE_BUFSZ && write_file(dirfd, name, buf, len));
+}
+
+// writes the system-wide files
+static bool write_system_files(int dirfd, long nprocs, unsigned int *seed)
+{
+    char buf[FIXTURE_BUFSZ];
+    int len = 0;
+    // the total of the cpu line is the sum of the cores
+    unsigned long cores[FIXTURE_CORES][4];
+    unsigned long total[4] = {0};
+    for (int c = 0; c < FIXTURE_CORES; c++)
+    {
+        for (int f = 0; f < 4; f++)
+        {
+            cores[c][f] = 100000 + rand_r(seed) % 1000000;
+            total[f] += cores[c][f];
+        }
+    }
+    len += snprintf(buf + len, FIXTURE_BUFSZ - len, "cpu  %lu 120 %lu %lu 900 0 300 0 0 0\n", total[0], total[1],
+                    total[2] + total[3]);
+    for (int c = 0; c < FIXTURE_CORES; c++)
+    {
+        len += snprintf(buf + len, FIXTURE_BUFSZ - len, "cpu%d %lu 15 %lu %lu 110 0 40 0 0 0\n", c, cores[c][0],
+                        cores[c][1], cores[c][2] + cores[c][3]);
+    }
+    len += snprintf(buf + len, FIXTURE_BUFSZ - len,
+                    "intr 91234567 9 0 0 0 0 0 0 0 1 0 0 0 0\n"
+                    "ctxt 123456789\n"
+                    "btime 1700000000\n"
+                    "processes %ld\n"
+                    "procs_running %ld\n"
+                    "procs_blocked 1\n"
+                    "softirq 4567890 0 12 0 34 0 0 56 0 0 78\n",
+                    nprocs * 10, nprocs / 100 + 1);
+    if (write_formatted(dirfd, "stat", buf, len) == false)
+    {
+        return false;
+    }
+
+    len = 0;
+    for (int c = 0; c < FIXTURE_CORES; c++)
+    {
+        len += snprintf(buf + len, FIXTURE_BUFSZ - len,
+                        "processor\t: %d\n"
+                        "vendor_id\t: GenuineIntel\n"
+                        "model name\t: Fixture CPU @ 3.00GHz\n"
+                        "cpu MHz\t\t: 3000.000\n"
+                        "cache size\t: 16384 KB\n\n",
+                        c);
+    }
+    if (write_formatted(dirfd, "cpuinfo", buf, len) == false)
+    {
+        return false;
+    }
+
+    len = snprintf(buf, FIXTURE_BUFSZ,
+                   "MemTotal:       32768000 kB\n"
+                   "MemFree:         8192000 kB\n"
+                   "MemAvailable:   20480000 kB\n"
+                   "Buffers:          512000 kB\n"
+                   "Cached:         10240000 kB\n"
+                   "SwapCached:            0 kB\n"
+                   "Active:         12000000 kB\n"
+                   "Inactive:        8000000 kB\n"
+                   "SwapTotal:       8192000 kB\n"
+                   "SwapFree:        8000000 kB\n"
+                   "Dirty:              1200 kB\n"
+                   "Shmem:            600000 kB\n"
+                   "SReclaimable:     700000 kB\n"
+                   "SUnreclaim:       200000 kB\n");
+    if (write_formatted(dirfd, "meminfo", buf, len) == false)
+    {
+        return false;
+    }
+
+    len = snprintf(buf, FIXTURE_BUFSZ,
+                   "nr_free_pages 2048000\n"
+                   "nr_dirty 300\n"
+                   "pgpgin 12345678\n"
+                   "pgpgout 23456789\n"
+                   "pswpin 0\n"
+                   "pswpout 0\n"
+                   "pgfault 987654321\n"
+                   "pgmajfault 12345\n");
+    return write_formatted(dirfd, "vmstat", buf, len);
+}
+
+// writes the command line of a process (NUL-separated arguments), a few KB long for some of them
+static int format_cmdline(char *buf, long i, const char *argv0, unsigned int *seed)
+{
+    int len = 0;
+    if (argv0 == NULL)
+    {
+        return 0;
+    }
+    len += snprintf(buf, FIXTURE_BUFSZ, "%s", argv0) + 1;
+    int nargs = rand_r(seed) % 6;
+    for (int a = 0; a < nargs; a++)
+    {
+        len += snprintf(buf + len, FIXTURE_BUFSZ - len, "--option-%d=value%ld", a, i) + 1;
+    }
+    if (i % FIXTURE_LONGCMD == 0)
+    {
+        // a classpath of a few KB, as a single argument
+        len += snprintf(buf + len, FIXTURE_BUFSZ - len, "-cp") + 1;
+        int njars = 50 + rand_r(seed) % 150;
+        for (int j = 0; j < njars && len < FIXTURE_BUFSZ - 64; j++)
+        {
+            len += snprintf(buf + len, FIXTURE_BUFSZ - len, "%s/opt/app/lib/library-%d.jar", (j > 0 ? ":" : ""), j);
+        }
+        len += 1;
+    }
+    return len;
+}
+
+// writes the directory of the i-th process
+static bool write_process(int dirfd, long i, int pid, int ppid, unsigned int *seed)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%d", pid);
+    if (mkdirat(dirfd, name, 0755) == -1)
+    {
+        return false;
+    }
+    int pdir = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (pdir == -1)
+    {
+        return false;
+    }
+
+    const char *comm = commands[i % NUM_COMMANDS].comm;
+    const char *argv0 = commands[i % NUM_COMMANDS].argv0;
+    char state = states[rand_r(seed) % (sizeof(states) - 1)];
+    // root, a few hundred users and nobody
+    int r = rand_r(seed) % 10;
+    int uid = (r < 3 ? 0 : (r < 9 ? 1000 + rand_r(seed) % 300 : 65534));
+    long threads = 1 + (rand_r(seed) % 8 == 0 ? rand_r(seed) % 64 : 0);
+    unsigned long utime = rand_r(seed) % 100000, stime = rand_r(seed) % 20000;
+    unsigned long long start = 100 + i * 7;
+    unsigned long vsize = (argv0 == NULL ? 0 : (4096UL + rand_r(seed) % 1000000) * 4096);
+    long rss = (argv0 == NULL ? 0 : 100 + rand_r(seed) % 100000);
+    long nice = (rand_r(seed) % 5 == 0 ? rand_r(seed) % 40 - 20 : 0);
+    char buf[FIXTURE_BUFSZ];
+    bool ok = true;
+
+    // the 52 fields of stat (see man 5 proc)
+    int len = snprintf(buf, FIXTURE_BUFSZ,
+                       "%d (%s) %c %d %d %d 0 -1 4194560 %u 0 %u 0 %lu %lu 0 0 20 %ld %ld 0 %llu %lu %ld "
+                       "18446744073709551615 94000000000000 94000000100000 140700000000000 0 0 0 0 4096 0 0 0 0 "
+                       "17 %d 0 0 0 0 0 94000000200000 94000000300000 94000001000000 140700000001000 "
+                       "140700000002000 140700000002000 140700000003000 0\n",
+                       pid, comm, state, ppid, pid, ppid, rand_r(seed) % 100000, rand_r(seed) % 100, utime, stime,
+                       nice, threads, start, vsize, rss, (int)(i % FIXTURE_CORES));
+    ok = ok && write_formatted(pdir, "stat", buf, len);
+
+    len = snprintf(buf, FIXTURE_BUFSZ,
+                   "Name:\t%s\n"
+                   "Umask:\t0022\n"
+                   "State:\t%c\n"
+                   "Tgid:\t%d\n"
+                   "Ngid:\t0\n"
+                   "Pid:\t%d\n"
+                   "PPid:\t%d\n"
+                   "TracerPid:\t0\n"
+                   "Uid:\t%d\t%d\t%d\t%d\n"
+                   "Gid:\t%d\t%d\t%d\t%d\n"
+                   "FDSize:\t64\n"
+                   "VmRSS:\t%ld kB\n"
+                   "Threads:\t%ld\n",
+                   comm, state, pid, pid, ppid, uid, uid, uid, uid, uid, uid, uid, uid, rss * 4, threads);
+    ok = ok && write_formatted(pdir, "status", buf, len);
+
+    len = snprintf(buf, FIXTURE_BUFSZ, "%s\n", comm);
+    ok = ok && write_formatted(pdir, "comm", buf, len);
+
+    len = format_cmdline(buf, i, argv0, seed);
+    ok = ok && write_file(pdir, "cmdline", buf, len);
+
+    len = snprintf(buf, FIXTURE_BUFSZ,
+                   "rchar: %u\nwchar: %u\nsyscr: %u\nsyscw: %u\n"
+                   "read_bytes: %u\nwrite_bytes: %u\ncancelled_write_bytes: 0\n",
+                   rand_r(seed), rand_r(seed), rand_r(seed) % 100000, rand_r(seed) % 100000, rand_r(seed),
+                   rand_r(seed));
+    ok = ok && write_formatted(pdir, "io", buf, len);
+
+    // kernel threads are in the root cgroup, the others in a service or a user session
+    if (argv0 == NULL)
+        len = snprintf(buf, FIXTURE_BUFSZ, "0::/\n");
+    else if (uid == 0)
+        len = snprintf(buf, FIXTURE_BUFSZ, "0::/system.slice/service-%ld.service\n", i % 40);
+    else
+        len = snprintf(buf, FIXTURE_BUFSZ, "0::/user.slice/user-%d.slice/session-%ld.scope\n", uid, i % 7);
+    ok = ok && write_formatted(pdir, "cgroup", buf, len);
+
+    close(pdir);
+    return ok;
+}
+
+/**
+ * \brief Writes a fake procfs tree
+ *
+ * The PIDs grow from FIXTURE_FIRSTPID with gaps of 1 to 3, and each process's parent is one
+ * of the processes before it. The uids have no entry in /etc/passwd but 0 and 65534, as on a system with
+ * many users in a directory service
+ * \param [in] dir The directory where the tree is written (it must exist)
+ * \param [in] nprocs The number of processes
+ * \param [in] seed The seed of the pseudo-random contents
+ * \return Returns true iff all the files have been written
+ */
+bool fixture_write(const char *dir, long nprocs, unsigned int seed)
+{
+    int dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd == -1)
+    {
+        return false;
+    }
+    // the PIDs written so far, to choose the parents from
+    int *pids = malloc(nprocs * sizeof(int));
+    bool ok = (pids != NULL && write_system_files(dirfd, nprocs, &seed) == true);
+    int pid = FIXTURE_FIRSTPID;
+    for (long i = 0; i < nprocs && ok == true; i++)
+    {
+        pids[i] = pid;
+        ok = write_process(dirfd, i, pid, (i == 0 ? 0 : pids[rand_r(&seed) % i]), &seed);
+        pid += 1 + rand_r(&seed) % 3;
+    }
+    free(pids);
+    close(dirfd);
+    return ok;
+}
+
+// removes a file or directory of the tree (the directories are visited after their contents)
+static int remove_entry(const char *path, const struct stat *sb, int type, struct FTW *ftwbuf)
+{
+    (void)sb;
+    (void)type;
+    (void)ftwbuf;
+    return (remove(path) == 0 || errno == ENOENT ? 0 : -1);
+}
+
+bool fixture_remove(const char *dir)
+{
+    return (nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS) == 0);
+}
@@ -0,0 +1,28 @@
+/**
+ * \file fixture.h
+ * \brief Generates fake procfs trees, to benchmark the scan on any number of processes
+ *
+ * A tree holds the system-wide files read by the collectors (stat, meminfo, cpuinfo and vmstat)
+ * and a directory per process with its stat, status, cmdline, comm, io and cgroup files, in
+ * the format of the kernel. The processes are the awkward ones too: kernel threads with an
+ * empty cmdline, command lines several KB long, command names holding blanks and parentheses,
+ * and owners spread over many user ids. The contents depend only on the seed
+ */
+#ifndef FIXTURE_INCLUDED
+#define FIXTURE_INCLUDED
+
+#include <stdbool.h>
+
+// the number of cores listed in the generated stat and cpuinfo
+#define FIXTURE_CORES 8
+// one process in FIXTURE_LONGCMD has a command line of several KB
+#define FIXTURE_LONGCMD 16
+// the PID of the first process (the PIDs have gaps, as on a real system)
+#define FIXTURE_FIRSTPID 1
+
+// writes a tree with nprocs processes in the directory dir, which must exist and be empty
+bool fixture_write(const char *dir, long nprocs, unsigned int seed);
+// removes the tree in dir, and dir itself
+bool fixture_remove(const char *dir);
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * \file gen_fixture.c
+ * \brief Writes a fake procfs tree, to be read with summer-taskmgr --proc-root
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "fixture.h"
+
+/**
+ * \brief The program's main function
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 3 || argc > 4)
+    {
+        fprintf(stderr, "Usage: %s DIR PROCESSES [SEED]\n", argv[0]);
+        return 1;
+    }
+    char *end;
+    long nprocs = strtol(argv[2], &end, 10);
+    if (*end != '\0' || nprocs < 1 || nprocs > 4000000)
+    {
+        fprintf(stderr, "Not a valid number of processes: %s\n", argv[2]);
+        return 1;
+    }
+    unsigned long seed = 1;
+    if (argc == 4)
+    {
+        seed = strtoul(argv[3], &end, 10);
+        if (*end != '\0')
+        {
+            fprintf(stderr, "Not a valid seed: %s\n", argv[3]);
+            return 1;
+        }
+    }
+    if (mkdir(argv[1], 0755) == -1 && errno != EEXIST)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    if (fixture_write(argv[1], nprocs, (unsigned int)seed) == false)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
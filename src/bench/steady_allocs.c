@@ -0,0 +1,144 @@
+/**
+ * \file steady_allocs.c
+ * \brief Checks that the scans of an unchanged set of processes allocate no memory
+ *
+ * A tree with a fixed set of processes is written in a temporary directory (see fixture.h)
+ * and scanned a few times to warm up the arena and the buffers of the TaskList. The scans
+ * after them must neither allocate blocks of the arena nor call malloc(), calloc() or
+ * realloc() at all: this program defines them, counting the calls made while a scan runs
+ * (by the library and by glib as well) before handing them to the C library
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "fixture.h"
+#include "collect.h"
+
+// the processes of the tree: few enough that glib sorts their handles without a temporary buffer
+#define ALLOCS_PROCS 200
+// the scans that fill the arena and grow the buffers, then those that must not allocate
+#define ALLOCS_WARMUP 3
+#define ALLOCS_SCANS 10
+#define ALLOCS_SEED 42
+
+// the allocator of the C library, which the functions below hand the calls to
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+// set while a scan is counted, and the calls counted
+static atomic_bool counting = false;
+static atomic_ulong allocs = 0;
+
+void *malloc(size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed) == true)
+        atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed) == true)
+        atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed) == true)
+        atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+/**
+ * \brief Scans the tree, counting the allocations of each scan after the warm-up
+ * \param [in,out] c The collector
+ * \param [in] mode The name of the scan mode, for the report
+ * \return Returns false if a scan failed or allocated memory
+ */
+static bool check_scans(Collect_t *c, const char *mode)
+{
+    for (int s = 0; s < ALLOCS_WARMUP; s++)
+    {
+        if (get_processes_info(c->tasks, c->cpu_stats) == false)
+        {
+            fprintf(stderr, "%s: scan failed\n", mode);
+            return false;
+        }
+    }
+    Str_arena_t *arena = &c->tasks->strings;
+    unsigned long block_allocs = arena->block_allocs, block_frees = arena->block_frees;
+    bool ok = true;
+    for (int s = 0; s < ALLOCS_SCANS && ok == true; s++)
+    {
+        atomic_store(&allocs, 0);
+        atomic_store(&counting, true);
+        ok = get_processes_info(c->tasks, c->cpu_stats);
+        atomic_store(&counting, false);
+        unsigned long n = atomic_load(&allocs);
+        if (ok == false || c->tasks->num_ps != ALLOCS_PROCS)
+        {
+            fprintf(stderr, "%s: scan %d found %ld processes out of %d\n", mode, s, c->tasks->num_ps, ALLOCS_PROCS);
+            ok = false;
+        }
+        else if (n > 0)
+        {
+            fprintf(stderr, "%s: scan %d allocated memory %lu times\n", mode, s, n);
+            ok = false;
+        }
+    }
+    if (arena->block_allocs != block_allocs || arena->block_frees != block_frees)
+    {
+        fprintf(stderr, "%s: the arena allocated %lu blocks and freed %lu after the warm-up\n", mode,
+                arena->block_allocs - block_allocs, arena->block_frees - block_frees);
+        ok = false;
+    }
+    printf("%s: %s (%lu blocks of the arena, %zu bytes of strings)\n", mode,
+           (ok == true ? "no allocations per scan" : "FAILED"), arena->block_allocs - arena->block_frees,
+           arena->live_bytes);
+    return ok;
+}
+
+/**
+ * \brief The program's main function
+ */
+int main(void)
+{
+    const char *tmpdir = getenv("TMPDIR");
+    char root[PROCFS_ROOTMAX + 1];
+    int len = snprintf(root, sizeof(root), "%s/summer-allocs.XXXXXX", (tmpdir && *tmpdir ? tmpdir : "/tmp"));
+    if (len < 0 || len >= (int)sizeof(root) || mkdtemp(root) == NULL)
+    {
+        fprintf(stderr, "Cannot create a temporary directory in %s\n", (tmpdir && *tmpdir ? tmpdir : "/tmp"));
+        return 1;
+    }
+    if (fixture_write(root, ALLOCS_PROCS, ALLOCS_SEED) == false || procfs_set_root(root) == false)
+    {
+        perror(root);
+        fixture_remove(root);
+        return 1;
+    }
+    Collect_t *c = collect_open();
+    if (c == NULL)
+    {
+        fixture_remove(root);
+        return 1;
+    }
+    get_cpu_info(c->cpu_stats);
+
+    // every field of every process is read again, then only the stat files of those out of view
+    bool ok = check_scans(c, "full scan");
+    c->tasks->viewport_scan = true;
+    ok = check_scans(c, "viewport scan") && ok;
+
+    collect_close(c);
+    if (fixture_remove(root) == false)
+    {
+        perror(root);
+        ok = false;
+    }
+    return (ok == true ? 0 : 1);
+}
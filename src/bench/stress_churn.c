@@ -0,0 +1,344 @@
+/**
+ * \file stress_churn.c
+ * \brief Scans /proc while thousands of short-lived processes start and end every second
+ *
+ * A churner process forks children that exit at once and reaps them, at the rate given, so
+ * that processes end between the listing of /proc and the reading of their files, and PIDs
+ * are reused once the counter wraps around at kernel.pid_max. Meanwhile the collector scans
+ * back to back, and after each scan the list is checked: no PID may appear twice or be zero,
+ * and a set of sentinel processes, which live for the whole run, must always be found with
+ * their parent. At the end the latency percentiles of the scans are reported, with the
+ * growth of the resident set and of the string arena since the end of the warm-up.
+ * The PIDs wrap around after pid_max forks, which can take long (pid_max is 4194304 on most
+ * 64-bit systems): the run can be extended until they have wrapped around a number of times
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+#include "collect.h"
+
+// the duration of the run (in seconds) and the forks per second, unless given on the command line
+#define CHURN_SECONDS 20
+#define CHURN_RATE 5000
+// the processes that live for the whole run, which every scan must find
+#define CHURN_SENTINELS 32
+// the churner checks its pace every CHURN_BATCH forks
+#define CHURN_BATCH 32
+// the progress lines written during the run (the first one ends the warm-up)
+#define CHURN_CHECKPOINTS 10
+
+// the counters of the churner, in memory shared with the scanner
+struct churn_stats
+{
+    _Atomic long forks;
+    _Atomic long failures; ///< the forks that failed (out of PIDs or memory)
+    _Atomic long wraps;    ///< the times a PID was lower than the one before (the counter wrapped around)
+    _Atomic int stop;
+};
+
+// the errors found in the lists of processes
+struct churn_errors
+{
+    long duplicated; ///< PIDs listed more than once
+    long zeroed;     ///< processes with PID 0 (or negative)
+    long dropped;    ///< sentinels missing, or listed with the wrong parent
+};
+
+static double now_sec(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// forks children that exit at once, rate times per second, until stats->stop is set
+static void churn(struct churn_stats *stats, long rate)
+{
+    double start = now_sec();
+    pid_t last = 0;
+    long forks = 0;
+    while (atomic_load(&stats->stop) == 0)
+    {
+        for (int b = 0; b < CHURN_BATCH; b++)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                _exit(0);
+            }
+            if (pid == -1)
+            {
+                atomic_fetch_add(&stats->failures, 1);
+                continue;
+            }
+            waitpid(pid, NULL, 0);
+            if (pid < last)
+            {
+                atomic_fetch_add(&stats->wraps, 1);
+            }
+            last = pid;
+            forks++;
+        }
+        atomic_store(&stats->forks, forks);
+        // ahead of the pace: wait until the forks done are due
+        double ahead = start + (double)forks / rate - now_sec();
+        if (ahead > 0)
+        {
+            struct timespec ts = {(time_t)ahead, (long)((ahead - (time_t)ahead) * 1e9)};
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+// starts a child that runs until it's killed, or until its parent ends
+static pid_t start_child(struct churn_stats *stats, long rate)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (stats != NULL)
+        {
+            churn(stats, rate);
+            _exit(0);
+        }
+        for (;;)
+        {
+            pause();
+        }
+    }
+    return pid;
+}
+
+// checks the list of processes after a scan: pids is a buffer of (at least) tasks->num_ps PIDs
+static void check_tasks(const TaskList *tasks, int *pids, const pid_t *sentinels, struct churn_errors *errors)
+{
+    long n = tasks->num_ps;
+    memcpy(pids, tasks->cols.pid, n * sizeof(int));
+    qsort(pids, n, sizeof(int), cmp_int);
+    for (long i = 0; i < n; i++)
+    {
+        if (pids[i] <= 0)
+        {
+            errors->zeroed++;
+        }
+        if (i > 0 && pids[i] == pids[i - 1])
+        {
+            errors->duplicated++;
+        }
+    }
+    for (int s = 0; s < CHURN_SENTINELS; s++)
+    {
+        long h = find_task(tasks, sentinels[s]);
+        if (h < 0 || tasks->cols.ppid[h] != getpid())
+        {
+            errors->dropped++;
+        }
+    }
+}
+
+// the resident set of this process (in KB), from its status file
+static long rss_kb(void)
+{
+    char path[BUF_BASESZ], line[256];
+    long kb = -1;
+    procfs_path(path, BUF_BASESZ, "self/status");
+    FILE *f = fopen(path, "r");
+    while (f != NULL && fgets(line, sizeof(line), f) != NULL)
+    {
+        if (sscanf(line, "VmRSS: %ld", &kb) == 1)
+        {
+            break;
+        }
+    }
+    if (f != NULL)
+    {
+        fclose(f);
+    }
+    return kb;
+}
+
+/**
+ * \brief The program's main function
+ */
+int main(int argc, char **argv)
+{
+    long seconds = CHURN_SECONDS, rate = CHURN_RATE, min_wraps = 0;
+    if (argc > 4 || (argc > 1 && (isNumber(argv[1], &seconds) != 0 || seconds < 1)) ||
+        (argc > 2 && (isNumber(argv[2], &rate) != 0 || rate < 1)) ||
+        (argc > 3 && (isNumber(argv[3], &min_wraps) != 0 || min_wraps < 0)))
+    {
+        fprintf(stderr, "Usage: %s [SECONDS [FORKS_PER_SECOND [WRAPAROUNDS]]]\n", argv[0]);
+        return 1;
+    }
+
+    pid_t sentinels[CHURN_SENTINELS];
+    for (int s = 0; s < CHURN_SENTINELS; s++)
+    {
+        sentinels[s] = start_child(NULL, 0);
+    }
+    struct churn_stats *stats =
+        mmap(NULL, sizeof(struct churn_stats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    memset(stats, 0, sizeof(struct churn_stats));
+    pid_t churner = start_child(stats, rate);
+
+    Collect_t *c = collect_open();
+    if (c == NULL)
+    {
+        return 1;
+    }
+    struct churn_errors errors = {0, 0, 0};
+    long cap_pids = 0, cap_times = 1024, scans = 0;
+    int *pids = NULL;
+    double *times = malloc(cap_times * sizeof(double));
+    long base_rss = 0, base_forks = 0;
+    size_t base_arena = 0;
+    double start = now_sec(), base_time = start;
+    int checkpoint = 0;
+    bool scan_failed = false;
+    printf("churning %ld forks/s for %ld s, %d sentinels\n", rate, seconds, CHURN_SENTINELS);
+    if (min_wraps > 0)
+    {
+        printf("(and until the PIDs wrap around %ld times)\n", min_wraps);
+    }
+
+    while (times != NULL)
+    {
+        double t0 = now_sec();
+        if (t0 - start >= seconds && atomic_load(&stats->wraps) >= min_wraps)
+        {
+            break;
+        }
+        get_cpu_info(c->cpu_stats);
+        bool ok = get_processes_info(c->tasks, c->cpu_stats);
+        double t1 = now_sec();
+        if (ok == false)
+        {
+            fprintf(stderr, "Scan failed after %ld scans\n", scans);
+            scan_failed = true;
+            break;
+        }
+        if (scans == cap_times)
+        {
+            cap_times *= 2;
+            double *grown = realloc(times, cap_times * sizeof(double));
+            if (grown == NULL)
+            {
+                break;
+            }
+            times = grown;
+        }
+        times[scans++] = (t1 - t0) * 1e3;
+        if (c->tasks->num_ps > cap_pids)
+        {
+            cap_pids = c->tasks->num_ps * 2;
+            free(pids);
+            pids = malloc(cap_pids * sizeof(int));
+            if (pids == NULL)
+            {
+                break;
+            }
+        }
+        check_tasks(c->tasks, pids, sentinels, &errors);
+
+        // a progress line at each tenth of the run (and every tenth of it after, if it's extended)
+        if (t1 - start >= (double)seconds * (checkpoint + 1) / CHURN_CHECKPOINTS)
+        {
+            long forks = atomic_load(&stats->forks);
+            long rss = rss_kb();
+            printf("%5.1f s: %6ld scans, %5ld processes, %6.0f forks/s, rss %ld KB, arena %zu KB\n", t1 - start,
+                   scans, c->tasks->num_ps, (forks - base_forks) / (t1 - base_time), rss,
+                   c->tasks->strings.reserved_bytes / 1024);
+            if (checkpoint == 0)
+            {
+                // the end of the warm-up: the growth is measured from here
+                base_rss = rss;
+                base_arena = c->tasks->strings.reserved_bytes;
+            }
+            base_forks = forks;
+            base_time = t1;
+            checkpoint++;
+        }
+    }
+
+    atomic_store(&stats->stop, 1);
+    waitpid(churner, NULL, 0);
+    for (int s = 0; s < CHURN_SENTINELS; s++)
+    {
+        kill(sentinels[s], SIGKILL);
+        waitpid(sentinels[s], NULL, 0);
+    }
+
+    int ret = (scan_failed == true ? 1 : 0);
+    if (times == NULL || pids == NULL || scans == 0)
+    {
+        fprintf(stderr, "No scans completed\n");
+        ret = 1;
+    }
+    else
+    {
+        long forks = atomic_load(&stats->forks);
+        double elapsed = now_sec() - start;
+        char pid_max[32] = "?";
+        char path[BUF_BASESZ];
+        procfs_path(path, BUF_BASESZ, "sys/kernel/pid_max");
+        FILE *f = fopen(path, "r");
+        if (f != NULL)
+        {
+            if (fscanf(f, "%31s", pid_max) != 1)
+            {
+                strcpy(pid_max, "?");
+            }
+            fclose(f);
+        }
+        printf("forks: %ld (%.0f/s), %ld failed, PIDs wrapped around %ld times (pid_max %s)\n", forks,
+               forks / elapsed, atomic_load(&stats->failures), atomic_load(&stats->wraps), pid_max);
+        qsort(times, scans, sizeof(double), cmp_double);
+        printf("scan latency over %ld scans: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", scans,
+               times[scans / 2], times[scans * 9 / 10], times[scans * 99 / 100], times[scans - 1]);
+        long rss = rss_kb();
+        printf("growth since the warm-up: rss %+ld KB (%ld KB), arena %+ld KB (%zu KB)\n", rss - base_rss, rss,
+               ((long)c->tasks->strings.reserved_bytes - (long)base_arena) / 1024,
+               c->tasks->strings.reserved_bytes / 1024);
+        printf("errors: %ld duplicated, %ld zeroed, %ld sentinels dropped\n", errors.duplicated, errors.zeroed,
+               errors.dropped);
+        if (errors.duplicated + errors.zeroed + errors.dropped > 0)
+        {
+            ret = 1;
+        }
+        if (atomic_load(&stats->wraps) == 0)
+        {
+            printf("note: the PIDs didn't wrap around: lower kernel.pid_max or run longer to reuse them\n");
+        }
+    }
+    free(times);
+    free(pids);
+    collect_close(c);
+    munmap(stats, sizeof(struct churn_stats));
+    return ret;
+}
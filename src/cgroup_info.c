@@ -0,0 +1,168 @@
+/**
+ * \file cgroup_info.c
+ * \brief Implements functions that group tasks by cgroup and read the cgroups' statistics
+ *
+ * The cgroup of a process is read from /proc/[pid]/cgroup only when the process is first
+ * seen by the scan, and the aggregates of each cgroup (tasks, threads, resident set) are
+ * updated as tasks come, change and go, so that grouping never needs a pass over all tasks
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "history.h"
+#include "cgroup_info.h"
+
+static void free_cgroup(void *p)
+{
+    Cgroup *cg = (Cgroup *)p;
+    free(cg->path);
+    free(cg);
+}
+
+GHashTable *cgroup_table_new(void)
+{
+    // keys are owned by the cgroups (their path), so only values are freed
+    return g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_cgroup);
+}
+
+// reads a small file whole into buf (null-terminated): returns the number of bytes read or -1
+static ssize_t read_small_file(const char *path, char *buf, size_t bufsz)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    ssize_t nread = read(fd, buf, bufsz - 1);
+    close(fd);
+    if (nread >= 0)
+    {
+        buf[nread] = '\0';
+    }
+    return nread;
+}
+
+/**
+ * \brief Gets the cgroup of a process
+ *
+ * The unified (v2) hierarchy is the line starting with "0::" in /proc/[pid]/cgroup.
+ * If the cgroup is not in table yet a new cgroup, with no tasks, is added to it
+ * \param [in,out] table The table of cgroups
+ * \param [in] pid The process' PID
+ * \return Returns the cgroup, or NULL if the process has vanished or is not in a v2 cgroup
+ */
+Cgroup *get_task_cgroup(GHashTable *table, int pid)
+{
+    char path[BUF_BASESZ];
+    char buf[PROCFILE_BUFSZ];
+    procfs_path(path, BUF_BASESZ, "%d/cgroup", pid);
+    if (read_small_file(path, buf, PROCFILE_BUFSZ) <= 0)
+    {
+        return NULL;
+    }
+    char *line = buf;
+    while (*line != '\0' && strncmp(line, "0::", 3) != 0)
+    {
+        line = (char *)next_line(line);
+    }
+    if (*line == '\0')
+    {
+        return NULL;
+    }
+    line += 3;
+    line[strcspn(line, "\n")] = '\0';
+
+    Cgroup *cg = g_hash_table_lookup(table, line);
+    if (cg == NULL)
+    {
+        if ((cg = calloc(1, sizeof(Cgroup))) == NULL)
+        {
+            return NULL;
+        }
+        if ((cg->path = strdup(line)) == NULL)
+        {
+            free(cg);
+            return NULL;
+        }
+        g_hash_table_insert(table, cg->path, cg);
+    }
+    return cg;
+}
+
+void cgroup_add_task(Cgroup *cg, long int num_threads, long int resident_set)
+{
+    if (cg)
+    {
+        cg->num_tasks++;
+        cg->num_threads += num_threads;
+        cg->resident_set += resident_set;
+    }
+}
+
+void cgroup_update_task(Cgroup *cg, long int delta_threads, long int delta_rss)
+{
+    if (cg)
+    {
+        cg->num_threads += delta_threads;
+        cg->resident_set += delta_rss;
+    }
+}
+
+void cgroup_remove_task(GHashTable *table, Cgroup *cg, long int num_threads, long int resident_set)
+{
+    if (cg)
+    {
+        cg->num_tasks--;
+        cg->num_threads -= num_threads;
+        cg->resident_set -= resident_set;
+        if (cg->num_tasks <= 0)
+        {
+            g_hash_table_remove(table, cg->path);
+        }
+    }
+}
+
+// reads the statistics of a single cgroup (see Documentation/admin-guide/cgroup-v2.rst)
+static void get_cgroup_stats(gpointer key, gpointer value, gpointer user_data)
+{
+    Cgroup *cg = (Cgroup *)value;
+    double now = *(double *)user_data;
+    char path[PROCFILE_BUFSZ];
+    char buf[PROCFILE_BUFSZ];
+    const char *p;
+
+    cg->has_stats = false;
+    snprintf(path, PROCFILE_BUFSZ, "%s%s/cpu.stat", CGROUP_ROOT, cg->path);
+    if (read_small_file(path, buf, PROCFILE_BUFSZ) > 0 && strncmp(buf, "usage_usec ", 11) == 0)
+    {
+        p = buf + 11;
+        counter_update(&cg->cpu_usage, parse_ull(&p), now);
+        // usage is in microseconds: the rate is the fraction of a core used
+        cg->cpu_perc = counter_rate(&cg->cpu_usage) / 10000.0;
+        cg->has_stats = true;
+    }
+    snprintf(path, PROCFILE_BUFSZ, "%s%s/memory.current", CGROUP_ROOT, cg->path);
+    if (read_small_file(path, buf, PROCFILE_BUFSZ) > 0)
+    {
+        p = buf;
+        cg->memory_current = parse_ull(&p);
+    }
+    snprintf(path, PROCFILE_BUFSZ, "%s%s/pids.current", CGROUP_ROOT, cg->path);
+    if (read_small_file(path, buf, PROCFILE_BUFSZ) > 0)
+    {
+        p = buf;
+        cg->pids_current = parse_ull(&p);
+    }
+}
+
+void get_cgroups_info(GHashTable *table)
+{
+    double now = history_now();
+    g_hash_table_foreach(table, get_cgroup_stats, &now);
+}
@@ -0,0 +1,46 @@
+/**
+ * \file cgroup_info.h
+ * \brief Data structures and functions related to cgroups (v2) and the tasks they contain
+ */
+#ifndef CGROUP_INFO_INCLUDED
+#define CGROUP_INFO_INCLUDED
+
+#include <glib.h>
+
+#include "common.h"
+#include "procfile.h"
+#include "process_info.h"
+
+// mount point of the cgroup v2 hierarchy
+#define CGROUP_ROOT "/sys/fs/cgroup"
+
+// a cgroup, with the aggregates of the tasks it contains
+struct cgroup
+{
+    char *path; ///< the path relative to CGROUP_ROOT, as in /proc/[pid]/cgroup (starts with '/')
+    // aggregates of the tasks in the tasklist belonging to this cgroup (updated incrementally)
+    long int num_tasks;
+    long int num_threads;
+    long int resident_set; ///< sum of the resident set (in pages) of the tasks
+    // statistics read from the cgroup's own files
+    bool has_stats;           ///< false if the files could not be read (such as on cgroup v1)
+    struct counter cpu_usage; ///< usage_usec from cpu.stat
+    float cpu_perc;           ///< cpu usage since the previous read (100% is one core)
+    unsigned long long memory_current;
+    long int pids_current;
+};
+
+// creates the table of cgroups, indexed by path
+GHashTable *cgroup_table_new(void);
+// gets the cgroup of the process pid from /proc/[pid]/cgroup, adding it to table if needed
+Cgroup *get_task_cgroup(GHashTable *table, int pid);
+// adds a task (with its threads and resident set) to the aggregates of its cgroup
+void cgroup_add_task(Cgroup *cg, long int num_threads, long int resident_set);
+// updates the aggregates of the cgroup by the changes of a task's threads and resident set
+void cgroup_update_task(Cgroup *cg, long int delta_threads, long int delta_rss);
+// removes a task from its cgroup, deleting the cgroup from table when it becomes empty
+void cgroup_remove_task(GHashTable *table, Cgroup *cg, long int num_threads, long int resident_set);
+// reads cpu.stat, memory.current and pids.current of every cgroup in table
+void get_cgroups_info(GHashTable *table);
+
+#endif
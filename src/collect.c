@@ -0,0 +1,72 @@
+/**
+ * \file collect.c
+ * \brief Implements the API of libsummer-collect
+ */
+#include <stdlib.h>
+
+#include "collect.h"
+
+/**
+ * \brief Allocates a collector
+ *
+ * The model and the number of cores of the CPU are read once here. The processes' values
+ * of smaps_rollup, which are expensive to read and are not in the snapshots, are not read
+ * \return Returns the collector, or NULL if it could not be allocated
+ */
+Collect_t *collect_open(void)
+{
+    Collect_t *c = calloc(1, sizeof(Collect_t));
+    if (c == NULL)
+    {
+        return NULL;
+    }
+    c->mem_stats = mem_data_new();
+    c->cpu_stats = cpu_data_new();
+    c->tasks = tasklist_new(CMDLINE_DISPLAY_CAP);
+    if (c->mem_stats == NULL || c->cpu_stats == NULL || c->tasks == NULL)
+    {
+        collect_close(c);
+        return NULL;
+    }
+    c->tasks->skip_smaps = true;
+    return c;
+}
+
+void collect_close(Collect_t *c)
+{
+    if (c->mem_stats)
+        mem_data_free(c->mem_stats);
+    if (c->cpu_stats)
+        cpu_data_free(c->cpu_stats);
+    if (c->tasks)
+        tasklist_free(c->tasks);
+    free(c);
+}
+
+/**
+ * \brief Reads memory, CPU and processes
+ *
+ * The CPU usage of the processes is the time they ran since the previous update
+ * \param [in,out] c The collector
+ * \return Returns true iff all of them have been read
+ */
+bool collect_update(Collect_t *c)
+{
+    bool mem_ok = get_mem_info(c->mem_stats);
+    bool cpu_ok = get_cpu_info(c->cpu_stats);
+    return (get_processes_info(c->tasks, c->cpu_stats) && mem_ok && cpu_ok);
+}
+
+/**
+ * \brief Copies the last tick into a snapshot
+ *
+ * The processes are sorted by PID. The strings (commands, usernames and the model of the
+ * CPU) are borrowed from the collector: they are valid until its next update
+ * \param [in,out] c The collector
+ * \param [out] snap The snapshot, whose arrays are reused from a tick to the next
+ * \return Returns false if the arrays of the snapshot could not grow
+ */
+bool collect_snapshot(Collect_t *c, struct rec_state *snap)
+{
+    return rec_fill_state(snap, c->mem_stats, c->cpu_stats, c->tasks);
+}
@@ -0,0 +1,42 @@
+/**
+ * \file collect.h
+ * \brief The API of libsummer-collect, which collects memory, CPU and process data without a terminal
+ *
+ * The library holds the readers of procfs, the collectors of memory, CPU, processes, cgroups
+ * and sockets, and the sorting of the processes: the task manager links it, and so can the
+ * benchmarks or any program that wants the data in-process. None of its headers includes
+ * ncurses. A collector is updated once per tick, and then a snapshot of the tick can be taken:
+ * a struct rec_state, the same state that the record mode writes and the daemon publishes.
+ * The structures of the collector are exposed as well, for the fields that aren't in the
+ * snapshots. A collector must not be updated by two threads at once
+ */
+#ifndef COLLECT_INCLUDED
+#define COLLECT_INCLUDED
+
+#include <stdbool.h>
+
+#include "common.h"
+#include "procfile.h"
+#include "mem_info.h"
+#include "cpu_info.h"
+#include "process_info.h"
+#include "snapshot.h"
+
+// the data read by a collector
+typedef struct collect_t
+{
+    Mem_data_t *mem_stats;
+    CPU_data_t *cpu_stats;
+    TaskList *tasks;
+} Collect_t;
+
+// allocates a collector reading the procfs root set (see procfs_set_root())
+Collect_t *collect_open(void);
+// closes the files of a collector and frees it
+void collect_close(Collect_t *c);
+// reads memory, CPU and processes, at each tick
+bool collect_update(Collect_t *c);
+// copies the last tick into snap (initialized with rec_state_init() and freed with rec_state_release())
+bool collect_snapshot(Collect_t *c, struct rec_state *snap);
+
+#endif
@@ -0,0 +1,631 @@
+/**
+ * \file collector.c
+ * \brief Implements the collector daemon and the clients attached to it
+ *
+ * The daemon writes a snapshot in the slot that isn't published, so the clients copying the
+ * last snapshot are not disturbed: a client copies again only if the daemon published twice
+ * while it was copying. A slot that needs more room gets a new region at the end of the
+ * segment, so the region of the other slot never moves. The clients wait for a snapshot with
+ * a futex on the generation counter, woken by the daemon when it publishes one
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "collector.h"
+#include "mem_info.h"
+#include "cpu_info.h"
+#include "process_info.h"
+
+// set by SIGINT and SIGTERM to stop the daemon
+static volatile sig_atomic_t collector_quit = 0;
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    collector_quit = 1;
+}
+
+// glibc has no wrapper for futex(2)
+static long futex(const _Atomic uint32_t *word, int op, uint32_t val, const struct timespec *timeout)
+{
+    return syscall(SYS_futex, word, op, val, timeout, NULL, 0);
+}
+
+static size_t align8(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+// the state of the daemon
+struct shm_writer
+{
+    int fd;
+    unsigned char *map;
+    size_t map_len;
+    GHashTable *user_offs; ///< the offsets of the usernames written in the snapshot, by uid
+};
+
+/**
+ * \brief Creates the segment of a daemon
+ *
+ * A segment left by a daemon that didn't stop cleanly is replaced, but not the one of a
+ * daemon still running
+ * \param [in] path The name of the segment
+ * \param [in] mode The permissions of the segment (-1 for SHM_MODE, less the umask)
+ * \return Returns the file descriptor of the segment, or -1 on errors
+ */
+static int create_segment(const char *path, int mode)
+{
+    int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, SHM_MODE);
+    if (fd == -1 && errno == EEXIST)
+    {
+        pid_t pid = 0;
+        int old = shm_open(path, O_RDONLY | O_CLOEXEC, 0);
+        if (old != -1)
+        {
+            struct shm_header hdr;
+            if (pread(old, &hdr, sizeof(hdr), 0) == sizeof(hdr) && memcmp(hdr.magic, SHM_MAGIC, SHM_MAGICLEN) == 0)
+            {
+                pid = hdr.writer_pid;
+            }
+            close(old);
+        }
+        if (pid > 0 && (kill(pid, 0) == 0 || errno == EPERM))
+        {
+            fprintf(stderr, "%s is served by the collector with PID %d\n", path, pid);
+            return -1;
+        }
+        shm_unlink(path);
+        fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, SHM_MODE);
+    }
+    if (fd == -1)
+    {
+        perror(path);
+        return -1;
+    }
+    // the segment shows what procfs may hide from other users (hidepid=): it's shared wider only on request
+    if (mode >= 0 && fchmod(fd, mode) == -1)
+    {
+        perror(path);
+        close(fd);
+        shm_unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+// an upper bound of the size of the snapshot of s (the usernames are counted once per process)
+static size_t snapshot_size(const struct rec_state *s)
+{
+    size_t size = sizeof(struct shm_snapshot) + (s->num_cores + 1) * CPU_NFIELDS * sizeof(int64_t);
+    size = align8(size + s->num_cores) + s->tasks->len * sizeof(struct shm_task);
+    size += (s->model != NULL ? strlen(s->model) + 1 : 0);
+    for (guint i = 0; i < s->tasks->len; i++)
+    {
+        const struct rec_task *t = &g_array_index(s->tasks, struct rec_task, i);
+        size += (t->command != NULL ? strlen(t->command) + 1 : 0);
+        size += (t->username != NULL ? strlen(t->username) + 1 : 0);
+    }
+    return size;
+}
+
+// copies a string at *off in the snapshot, returning its offset (0 for NULL)
+static uint32_t put_snapshot_string(unsigned char *base, size_t *off, const char *s)
+{
+    if (s == NULL)
+    {
+        return 0;
+    }
+    size_t len = strlen(s) + 1;
+    uint32_t at = *off;
+    memcpy(base + at, s, len);
+    *off += len;
+    return at;
+}
+
+// writes the snapshot of s at base, returning its size
+static size_t write_snapshot(unsigned char *base, const struct rec_state *s, GHashTable *user_offs)
+{
+    struct shm_snapshot *snap = (struct shm_snapshot *)base;
+    snap->time_ms = s->time_ms;
+    memcpy(snap->mem, s->mem, sizeof(snap->mem));
+    snap->procs_running = s->procs_running;
+    snap->procs_blocked = s->procs_blocked;
+    snap->ctxt = s->ctxt;
+    snap->intr = s->intr;
+    snap->forks = s->forks;
+    snap->num_cores = s->num_cores;
+    snap->num_tasks = s->tasks->len;
+
+    size_t off = sizeof(struct shm_snapshot);
+    snap->perc_off = off;
+    memcpy(base + off, s->perc, (s->num_cores + 1) * CPU_NFIELDS * sizeof(int64_t));
+    off += (s->num_cores + 1) * CPU_NFIELDS * sizeof(int64_t);
+    snap->online_off = off;
+    for (int c = 0; c < s->num_cores; c++)
+    {
+        base[off + c] = (s->online[c] == true ? 1 : 0);
+    }
+    off = align8(off + s->num_cores);
+    snap->tasks_off = off;
+    struct shm_task *tasks = (struct shm_task *)(base + off);
+    off += s->tasks->len * sizeof(struct shm_task);
+
+    snap->model_off = put_snapshot_string(base, &off, s->model);
+    g_hash_table_remove_all(user_offs);
+    for (guint i = 0; i < s->tasks->len; i++)
+    {
+        const struct rec_task *t = &g_array_index(s->tasks, struct rec_task, i);
+        struct shm_task *st = &tasks[i];
+        st->cpu = t->cpu;
+        st->nice = t->nice;
+        st->num_threads = t->num_threads;
+        st->virt_size_bytes = t->virt_size_bytes;
+        st->resident_set = t->resident_set;
+        st->start_time = t->start_time;
+        st->pid = t->pid;
+        st->ppid = t->ppid;
+        st->uid = t->uid;
+        st->state = t->state;
+        st->command_off = put_snapshot_string(base, &off, t->command);
+        // the processes of a user share a copy of the name
+        gpointer user_off;
+        if (g_hash_table_lookup_extended(user_offs, GINT_TO_POINTER(t->uid), NULL, &user_off) == false)
+        {
+            user_off = GUINT_TO_POINTER(put_snapshot_string(base, &off, t->username));
+            g_hash_table_insert(user_offs, GINT_TO_POINTER(t->uid), user_off);
+        }
+        st->username_off = GPOINTER_TO_UINT(user_off);
+    }
+    return off;
+}
+
+/**
+ * \brief Publishes a snapshot of s
+ *
+ * The snapshot is written in the slot that isn't current, with its sequence number odd,
+ * then that slot becomes the current one and the clients waiting are woken up
+ * \param [in,out] w The daemon
+ * \param [in] s The state of the tick
+ * \return Returns false if the segment could not grow
+ */
+static bool publish(struct shm_writer *w, const struct rec_state *s)
+{
+    struct shm_header *hdr = (struct shm_header *)w->map;
+    uint32_t i = 1 - atomic_load_explicit(&hdr->current, memory_order_relaxed);
+    // one more byte for the zero ending the region, where the strings read by a client end
+    // even if it reads the slot while it's being written
+    size_t need = snapshot_size(s) + 1;
+
+    atomic_store_explicit(&hdr->slot[i].seq, atomic_load_explicit(&hdr->slot[i].seq, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (hdr->slot[i].cap < need)
+    {
+        // a new region at the end of the segment (the region of the other slot stays where it is)
+        long page = sysconf(_SC_PAGESIZE);
+        size_t cap = ((need + need / 2) + page - 1) / page * page;
+        size_t offset = w->map_len;
+        unsigned char *map = MAP_FAILED;
+        if (ftruncate(w->fd, offset + cap) == 0)
+        {
+            map = mremap(w->map, w->map_len, offset + cap, MREMAP_MAYMOVE);
+        }
+        if (map == MAP_FAILED)
+        {
+            atomic_fetch_add_explicit(&hdr->slot[i].seq, 1, memory_order_release);
+            return false;
+        }
+        w->map = map;
+        w->map_len = offset + cap;
+        hdr = (struct shm_header *)map;
+        hdr->slot[i].offset = offset;
+        hdr->slot[i].cap = cap;
+        atomic_store_explicit(&hdr->size, w->map_len, memory_order_release);
+    }
+    hdr->slot[i].len = write_snapshot(w->map + hdr->slot[i].offset, s, w->user_offs);
+    atomic_fetch_add_explicit(&hdr->slot[i].seq, 1, memory_order_release);
+
+    atomic_store_explicit(&hdr->current, i, memory_order_release);
+    atomic_fetch_add_explicit(&hdr->generation, 1, memory_order_release);
+    futex(&hdr->generation, FUTEX_WAKE, INT_MAX, NULL);
+    return true;
+}
+
+/**
+ * \brief Runs the collector daemon
+ *
+ * It collects the data every opts->interval seconds, as the batch mode does, and publishes
+ * it in the segment until SIGINT or SIGTERM; the segment is removed when it stops (the
+ * clients still attached keep the last snapshot)
+ * \param [in,out] data The data structures filled by the collectors
+ * \param [in] opts The name of the segment, its permissions and the interval
+ * \return Returns the exit status
+ */
+int run_collector(struct taskmgr_data_t *data, const struct collector_options *opts)
+{
+    char path[NAME_MAX];
+    snprintf(path, sizeof(path), "%s%s", SHM_PREFIX, opts->name);
+    struct shm_writer w;
+    w.fd = create_segment(path, opts->mode);
+    if (w.fd == -1)
+    {
+        return 1;
+    }
+    w.map_len = sysconf(_SC_PAGESIZE);
+    w.map = MAP_FAILED;
+    if (ftruncate(w.fd, w.map_len) == 0)
+    {
+        w.map = mmap(NULL, w.map_len, PROT_READ | PROT_WRITE, MAP_SHARED, w.fd, 0);
+    }
+    if (w.map == MAP_FAILED)
+    {
+        perror(path);
+        shm_unlink(path);
+        close(w.fd);
+        return 1;
+    }
+    struct shm_header *hdr = (struct shm_header *)w.map;
+    memcpy(hdr->magic, SHM_MAGIC, SHM_MAGICLEN);
+    hdr->writer_pid = getpid();
+    hdr->interval_ms = opts->interval * 1000;
+    atomic_store(&hdr->size, w.map_len);
+    w.user_offs = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    struct sigaction sa = {.sa_handler = on_stop_signal};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    struct rec_state cur;
+    rec_state_init(&cur);
+    long long interval_ns = (long long)(opts->interval * 1e9);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    int ret = 0;
+    for (long tick = 0; collector_quit == 0; tick++)
+    {
+        if (tick > 0)
+        {
+            long long ns = next.tv_nsec + interval_ns;
+            next.tv_sec += ns / 1000000000LL;
+            next.tv_nsec = ns % 1000000000LL;
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec))
+            {
+                next = now;
+            }
+            // interrupted by the stop signals
+            if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR && collector_quit == 1)
+            {
+                break;
+            }
+        }
+        get_mem_info(data->mem_stats);
+        get_cpu_info(data->cpu_stats);
+        get_processes_info(data->tasks, data->cpu_stats);
+        if (rec_fill_state(&cur, data->mem_stats, data->cpu_stats, data->tasks) == false || publish(&w, &cur) == false)
+        {
+            perror(path);
+            ret = 1;
+            break;
+        }
+    }
+    rec_state_release(&cur);
+    g_hash_table_destroy(w.user_offs);
+    shm_unlink(path);
+    munmap(w.map, w.map_len);
+    close(w.fd);
+    return ret;
+}
+
+// maps the segment open in fd read-only, checking its header
+static const unsigned char *map_segment(int fd, size_t *len)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(struct shm_header))
+    {
+        return NULL;
+    }
+    const unsigned char *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        return NULL;
+    }
+    if (memcmp(map, SHM_MAGIC, SHM_MAGICLEN) != 0)
+    {
+        munmap((void *)map, st.st_size);
+        return NULL;
+    }
+    *len = st.st_size;
+    return map;
+}
+
+Attach_t *collector_attach(const char *name)
+{
+    char path[NAME_MAX];
+    snprintf(path, sizeof(path), "%s%s", SHM_PREFIX, name);
+    int fd = shm_open(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1)
+    {
+        fprintf(stderr, "No collector serving %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    size_t len;
+    const unsigned char *map = map_segment(fd, &len);
+    if (map == NULL)
+    {
+        fprintf(stderr, "Not a collector segment: %s\n", path);
+        close(fd);
+        return NULL;
+    }
+    Attach_t *attach = calloc(1, sizeof(Attach_t));
+    attach->name = strdup(path);
+    attach->fd = fd;
+    attach->map = map;
+    attach->map_len = len;
+    attach->writer_pid = ((const struct shm_header *)map)->writer_pid;
+    rec_state_init(&attach->view);
+    pthread_mutex_init(&attach->mux_memdata, NULL);
+    return attach;
+}
+
+void collector_stop(Attach_t *attach)
+{
+    pthread_mutex_lock(&attach->mux_memdata);
+    attach->stop = true;
+    // wakes up the attach thread, if it's waiting for a snapshot
+    futex(&((const struct shm_header *)attach->map)->generation, FUTEX_WAKE, INT_MAX, NULL);
+    pthread_mutex_unlock(&attach->mux_memdata);
+}
+
+void collector_detach(Attach_t *attach)
+{
+    // nothing in the view is owned but its arrays
+    g_array_set_size(attach->view.tasks, 0);
+    attach->view.perc = NULL;
+    attach->view.online = NULL;
+    attach->view.model = NULL;
+    rec_state_free(&attach->view);
+    free(attach->copy);
+    munmap((void *)attach->map, attach->map_len);
+    close(attach->fd);
+    pthread_mutex_destroy(&attach->mux_memdata);
+    free(attach->name);
+    free(attach);
+}
+
+// replaces the mapping (under mux_memdata, since collector_stop() uses it)
+static void replace_mapping(Attach_t *attach, int fd, const unsigned char *map, size_t len)
+{
+    pthread_mutex_lock(&attach->mux_memdata);
+    munmap((void *)attach->map, attach->map_len);
+    if (fd != attach->fd)
+    {
+        close(attach->fd);
+        attach->fd = fd;
+    }
+    attach->map = map;
+    attach->map_len = len;
+    attach->writer_pid = ((const struct shm_header *)map)->writer_pid;
+    pthread_mutex_unlock(&attach->mux_memdata);
+}
+
+// the string at off in the copy of a snapshot (it ends in the copy, which is followed by a zero)
+static const char *snapshot_string(const unsigned char *base, size_t len, uint32_t off)
+{
+    return (off == 0 || off >= len ? NULL : (const char *)base + off);
+}
+
+/**
+ * \brief Copies the snapshot in a slot into the private buffer of the client
+ *
+ * The snapshot can be overwritten while it's copied: the caller checks the sequence number
+ * of the slot afterwards, and only then reads the copy (see view_snapshot())
+ * \param [in,out] attach The client (its segment is mapped again if the slot is beyond the mapping)
+ * \param [in] i The slot
+ * \return Returns the size of the snapshot copied, or 0 if the slot is not consistent
+ */
+static size_t copy_snapshot(Attach_t *attach, uint32_t i)
+{
+    const struct shm_header *hdr = (const struct shm_header *)attach->map;
+    uint64_t offset = hdr->slot[i].offset, cap = hdr->slot[i].cap, len = hdr->slot[i].len;
+    if (offset > attach->map_len || cap > attach->map_len - offset)
+    {
+        // the daemon grew the segment
+        size_t map_len;
+        const unsigned char *map = map_segment(attach->fd, &map_len);
+        if (map == NULL)
+        {
+            return 0;
+        }
+        replace_mapping(attach, attach->fd, map, map_len);
+        if (offset > attach->map_len || cap > attach->map_len - offset)
+        {
+            return 0;
+        }
+    }
+    if (len < sizeof(struct shm_snapshot) || len >= cap)
+    {
+        return 0;
+    }
+    if (len + 1 > attach->copy_cap)
+    {
+        unsigned char *grown = realloc(attach->copy, len + 1);
+        if (grown == NULL)
+        {
+            return 0;
+        }
+        attach->copy = grown;
+        attach->copy_cap = len + 1;
+    }
+    memcpy(attach->copy, attach->map + offset, len);
+    attach->copy[len] = '\0';
+    return len;
+}
+
+/**
+ * \brief Points the view of the client to the copy of a snapshot
+ *
+ * Nothing is copied again but the fixed fields of the processes: the arrays and the strings
+ * of the view point into the copy. Everything the snapshot refers to is checked to be in it,
+ * since a snapshot written by a broken daemon could point anywhere
+ * \param [in,out] attach The client, with the copy of a snapshot
+ * \param [in] len The size of the copy
+ * \return Returns false if the snapshot is not consistent
+ */
+static bool view_snapshot(Attach_t *attach, size_t len)
+{
+    const unsigned char *base = attach->copy;
+    const struct shm_snapshot *snap = (const struct shm_snapshot *)base;
+    int num_cores = snap->num_cores;
+    uint32_t num_tasks = snap->num_tasks, perc_off = snap->perc_off, online_off = snap->online_off,
+             tasks_off = snap->tasks_off;
+    if (num_cores < 0 || num_cores > 1 << 16 || perc_off % 8 != 0 || tasks_off % 8 != 0 ||
+        perc_off + (num_cores + 1) * CPU_NFIELDS * sizeof(int64_t) > len || (uint64_t)online_off + num_cores > len ||
+        (uint64_t)tasks_off + (uint64_t)num_tasks * sizeof(struct shm_task) > len)
+    {
+        return false;
+    }
+    struct rec_state *v = &attach->view;
+    v->time_ms = snap->time_ms;
+    memcpy(v->mem, snap->mem, sizeof(v->mem));
+    v->procs_running = snap->procs_running;
+    v->procs_blocked = snap->procs_blocked;
+    v->ctxt = snap->ctxt;
+    v->intr = snap->intr;
+    v->forks = snap->forks;
+    v->num_cores = num_cores;
+    v->perc = (long long *)(base + perc_off);
+    v->online = (bool *)(base + online_off);
+    v->model = (char *)snapshot_string(base, len, snap->model_off);
+    g_array_set_size(v->tasks, num_tasks);
+    const struct shm_task *tasks = (const struct shm_task *)(base + tasks_off);
+    for (uint32_t k = 0; k < num_tasks; k++)
+    {
+        struct rec_task *t = &g_array_index(v->tasks, struct rec_task, k);
+        t->pid = tasks[k].pid;
+        t->ppid = tasks[k].ppid;
+        t->state = tasks[k].state;
+        t->cpu = tasks[k].cpu;
+        t->nice = tasks[k].nice;
+        t->num_threads = tasks[k].num_threads;
+        t->virt_size_bytes = tasks[k].virt_size_bytes;
+        t->resident_set = tasks[k].resident_set;
+        t->start_time = tasks[k].start_time;
+        t->uid = tasks[k].uid;
+        t->username = snapshot_string(base, len, tasks[k].username_off);
+        t->command = (char *)snapshot_string(base, len, tasks[k].command_off);
+    }
+    return true;
+}
+
+// attaches to the segment of a daemon started again with the same name (false if there's none yet)
+static bool reattach(Attach_t *attach)
+{
+    int fd = shm_open(attach->name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1)
+    {
+        return false;
+    }
+    struct stat old, cur;
+    size_t len;
+    const unsigned char *map = NULL;
+    if (fstat(attach->fd, &old) == 0 && fstat(fd, &cur) == 0 && old.st_ino != cur.st_ino)
+    {
+        map = map_segment(fd, &len);
+    }
+    if (map == NULL)
+    {
+        close(fd);
+        return false;
+    }
+    replace_mapping(attach, fd, map, len);
+    return true;
+}
+
+/**
+ * \brief This is the function executed by the thread that reads the snapshots of the daemon
+ *
+ * It waits for the generation counter to change, then copies the current snapshot, copying
+ * it again if the daemon overwrote it meanwhile, and only then applies it to the data
+ * structures of the windows, which copies it a second time (once per snapshot). The
+ * windows are not drawn from the segment: the sequence number can validate only a copy
+ * taken before it's read again. If the daemon stops, it waits for one to be started again
+ * with the same name
+ */
+void *attach_thread(void *all_ds)
+{
+    struct taskmgr_data_t *ds = (struct taskmgr_data_t *)all_ds;
+    Attach_t *attach = ds->attach;
+    uint32_t seen = 0;
+    bool reset = true; // the histories restart with the first snapshot of a daemon
+
+    while (1)
+    {
+        pthread_mutex_lock(&attach->mux_memdata);
+        bool stop = attach->stop;
+        pthread_mutex_unlock(&attach->mux_memdata);
+        if (stop == true)
+        {
+            return (void *)0;
+        }
+        const struct shm_header *hdr = (const struct shm_header *)attach->map;
+        uint32_t gen = atomic_load_explicit(&hdr->generation, memory_order_acquire);
+        if (gen == seen)
+        {
+            struct timespec timeout = {SHM_WAIT, 0};
+            if (futex(&hdr->generation, FUTEX_WAIT, gen, &timeout) == -1 && errno == ETIMEDOUT &&
+                kill(attach->writer_pid, 0) == -1 && errno == ESRCH && reattach(attach) == true)
+            {
+                seen = 0;
+                reset = true;
+            }
+            continue;
+        }
+        for (int tries = 0; tries < SHM_RETRIES; tries++)
+        {
+            hdr = (const struct shm_header *)attach->map;
+            uint32_t i = atomic_load_explicit(&hdr->current, memory_order_acquire) & 1;
+            uint64_t seq = atomic_load_explicit(&hdr->slot[i].seq, memory_order_acquire);
+            if (seq % 2 == 1)
+            {
+                // the daemon is writing the current slot: it published another snapshot while this one was read
+                sched_yield();
+                continue;
+            }
+            size_t len = copy_snapshot(attach, i);
+            atomic_thread_fence(memory_order_acquire);
+            hdr = (const struct shm_header *)attach->map;
+            // the copy is used only if the daemon didn't write the slot meanwhile: a torn one is never shown
+            if (len > 0 && atomic_load_explicit(&hdr->slot[i].seq, memory_order_relaxed) == seq &&
+                view_snapshot(attach, len) == true)
+            {
+                rec_apply_state(ds, &attach->view, reset);
+                reset = false;
+                pthread_mutex_lock(&attach->mux_memdata);
+                attach->shown_gen = gen;
+                attach->shown_ms = attach->view.time_ms;
+                pthread_mutex_unlock(&attach->mux_memdata);
+                break;
+            }
+        }
+        // after SHM_RETRIES the snapshot is skipped: the next one is read
+        seen = gen;
+    }
+    return (void *)0;
+}
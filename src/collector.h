@@ -0,0 +1,145 @@
+/**
+ * \file collector.h
+ * \brief Collector daemon publishing snapshots in shared memory, and the TUI clients attached to it
+ *
+ * The daemon scans /proc once per interval and publishes a snapshot in a POSIX shared memory
+ * segment; any number of TUIs attach to it read-only, so the scan is paid once however many
+ * viewers there are. The segment starts with a header followed by the regions of two slots:
+ * the daemon writes each snapshot in the slot not being published and then switches to it.
+ * Each slot has a sequence number, odd while the slot is being written (a seqlock): a client
+ * copies the snapshot and copies it again if the number changed meanwhile, so that only a
+ * consistent copy is shown. The clients are not zero-copy: the private copy is then applied
+ * to the data structures of the windows, so each snapshot is copied twice by each client
+ */
+#ifndef COLLECTOR_INCLUDED
+#define COLLECTOR_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+#include "main.h"
+#include "record.h"
+
+// the bytes a segment starts with
+#define SHM_MAGIC "SUMSHM1\n"
+#define SHM_MAGICLEN 8
+// the prefix of the names of the segments (they are in /dev/shm)
+#define SHM_PREFIX "/summer."
+// times a client reads a snapshot again when the daemon overwrites it meanwhile, before waiting for the next one
+#define SHM_RETRIES 8
+// seconds a client waits for a snapshot before checking whether the daemon is still running
+#define SHM_WAIT 1
+// the mode the segment is created with, less the umask: the owner's group can attach (see --shm-mode)
+#define SHM_MODE 0640
+
+// a slot of the segment, where a snapshot is written
+struct shm_slot
+{
+    _Atomic uint64_t seq; ///< odd while the snapshot is being written
+    uint64_t offset;      ///< where the region of the slot starts in the segment
+    uint64_t cap;         ///< the size of the region (its last byte is always zero)
+    uint64_t len;         ///< the size of the snapshot in it
+};
+
+// the start of the segment
+struct shm_header
+{
+    char magic[SHM_MAGICLEN];
+    int32_t writer_pid;           ///< the PID of the daemon
+    _Atomic uint32_t current;     ///< the slot of the last snapshot
+    _Atomic uint32_t generation;  ///< the number of snapshots published (the clients wait on it with a futex)
+    uint32_t interval_ms;         ///< the interval between two snapshots
+    _Atomic uint64_t size;        ///< the size of the segment (it only grows)
+    struct shm_slot slot[2];
+};
+
+/**
+ * \brief The snapshot of a tick, as written in a slot
+ *
+ * It's followed by the CPU percentages (in tenths, as in struct rec_state), the cores online
+ * (a byte each), the processes (struct shm_task, sorted by PID) and the strings. The fields
+ * named *_off are offsets from the start of the snapshot (0 for a missing string)
+ */
+struct shm_snapshot
+{
+    int64_t time_ms;
+    int64_t mem[REC_MEM_FIELDS];
+    int64_t procs_running;
+    int64_t procs_blocked;
+    int64_t ctxt;
+    int64_t intr;
+    int64_t forks;
+    int32_t num_cores;
+    uint32_t num_tasks;
+    uint32_t model_off;
+    uint32_t perc_off;
+    uint32_t online_off;
+    uint32_t tasks_off;
+};
+
+// a process, as written in a snapshot
+struct shm_task
+{
+    uint64_t cpu;
+    int64_t nice;
+    int64_t num_threads;
+    int64_t virt_size_bytes;
+    int64_t resident_set;
+    uint64_t start_time;
+    int32_t pid;
+    int32_t ppid;
+    int32_t uid;
+    uint32_t username_off;
+    uint32_t command_off;
+    char state;
+};
+
+// the options of the daemon, set from the command line
+struct collector_options
+{
+    const char *name; ///< the name of the segment (without SHM_PREFIX)
+    double interval;  ///< the interval between two snapshots (in seconds)
+    int mode;         ///< the permissions of the segment, regardless of the umask (-1 for SHM_MODE less the umask)
+};
+
+/**
+ * \brief A segment a TUI is attached to
+ *
+ * The segment is mapped read-only (and mapped again when the daemon grows it). The attach
+ * thread copies each snapshot into copy, and once the copy is known to be consistent reads
+ * it into view, whose arrays and strings point into the copy
+ */
+typedef struct attach_t
+{
+    char *name;                      ///< the name of the segment (with SHM_PREFIX)
+    int fd;
+    const unsigned char *map;
+    size_t map_len;
+    unsigned char *copy;             ///< the last snapshot copied from the segment (followed by a zero)
+    size_t copy_cap;
+    struct rec_state view;           ///< the snapshot being read (nothing in it is owned but the array of the processes)
+    // the state shown in the status line, protected by mux_memdata
+    pthread_mutex_t mux_memdata;
+    bool stop;
+    uint32_t shown_gen;              ///< the generation of the snapshot in the windows (0 before the first one)
+    long long shown_ms;              ///< its time
+    int writer_pid;
+} Attach_t;
+
+// publishes a snapshot every opts->interval seconds in the segment opts->name, until a stop signal
+int run_collector(struct taskmgr_data_t *data, const struct collector_options *opts);
+
+// maps the segment served by a daemon
+Attach_t *collector_attach(const char *name);
+// stops the attach thread (before it's joined)
+void collector_stop(Attach_t *attach);
+// unmaps the segment and frees the client
+void collector_detach(Attach_t *attach);
+// the thread that copies each snapshot published to the data structures of the windows
+void *attach_thread(void *all_ds);
+
+#endif
@@ -0,0 +1,25 @@
+/**
+ * \file common.h
+ * \brief Definitions shared by the collectors, the windows and the headless modes
+ *
+ * Unlike main.h this header doesn't depend on ncurses, so that the collectors can be built
+ * into libsummer-collect (see collect.h)
+ */
+#ifndef COMMON_H_INCLUDED
+#define COMMON_H_INCLUDED
+
+#include <stdbool.h>
+
+// forward declarations to avoid circular dependencies with the headers where these types are defined
+typedef struct mem_data_t Mem_data_t;
+typedef struct cpu_data_t CPU_data_t;
+typedef struct tasklist TaskList;
+typedef struct psi_data_t PSI_data_t;
+typedef struct cgroup Cgroup;
+typedef struct numa_data_t NUMA_data_t;
+typedef struct net_data_t Net_data_t;
+
+// base buffer size
+#define BUF_BASESZ 128
+
+#endif
@@ -21,107 +21,211 @@ float get_percentage(unsigned long curr, unsigned long prev, unsigned long tot_c
     return (float)(curr - prev) * scale / (tot_curr - tot_prev);
 }
 
-// gets statistics about the cpu usage
-// see man 5 proc at section "/proc/stat"
-bool get_cpu_info(CPU_data_t *cpudata)
+CPU_data_t *cpu_data_new(void)
 {
-    // gets the unit used to express CPU time reported by /proc/stat
-    // usually it's 100, meaning that one needs to scale up by 100 to get the real value
-    unsigned long USER_HZ = sysconf(_SC_CLK_TCK); // runtime constant
-
-    // temp local variables
-    unsigned long usr = 0;
-    unsigned long usr_lowprio = 0; // time spent in user mode with low priority
-    unsigned long sys = 0;
-    unsigned long idle = 0;
-    unsigned long total = 0;
+    CPU_data_t *cpu = calloc(1, sizeof(CPU_data_t));
+    if (cpu == NULL)
+    {
+        return NULL;
+    }
+    // sets the number of cores and the model of the CPU just once at startup, since that's unlikely to change
+    get_cpu_model(&cpu->model, &cpu->num_cores);
+    // initialize the per-core statistics array
+    cpu->percore = calloc(cpu->num_cores, sizeof(struct core_data_t));
+    history_init(&cpu->usage_hist);
+    pthread_mutex_init(&cpu->mux_memdata, NULL);
+    pthread_cond_init(&cpu->cond_updating, NULL);
+    return cpu;
+}
 
-    int running_processes = 0;
+void cpu_data_free(CPU_data_t *cpu)
+{
+    free(cpu->model);
+    procfile_close(&cpu->stat_file);
+    free(cpu->percore);
+    free(cpu);
+}
 
-    FILE *stat_file = NULL;
-    char *buf = malloc(BUF_BASESZ);
-    unsigned long bufsz = BUF_BASESZ;
-    if ((stat_file = fopen(CPU_STATFILE, "r")))
+/**
+ * \brief Updates the statistics of a core (or the whole cpu) from a cpu line of /proc/stat
+ *
+ * The line is parsed from the first field after the "cpuN" label. Kernels that report less
+ * than CPU_NFIELDS fields leave the missing ones to zero. The total time is the sum of all
+ * fields except guest and guest_nice, which are already included in user and nice
+ * \param [in,out] core The statistics to be updated
+ * \param [in] p The line, starting after its label
+ */
+static void update_core(struct core_data_t *core, const char *p)
+{
+    unsigned long curr[CPU_NFIELDS] = {0};
+    unsigned long total = 0;
+    for (int f = 0; f < CPU_NFIELDS && *p != '\n' && *p != '\0'; f++)
     {
-        if (fgets(buf, bufsz, stat_file) == NULL)
+        curr[f] = parse_ull(&p);
+        if (f < CPU_GUEST)
         {
-            return false;
+            total += curr[f];
         }
-        // only the first four fields are relevant: others are just ignored
-        // if the values are not read properly they still can be obtained from the sum of cores
-        if (sscanf(buf, "cpu %lu %lu %lu %lu %*[^\n]\n", &usr, &usr_lowprio, &sys, &idle) == 4)
+    }
+    // no time elapsed since the last read (or counters reset by hotplug): keep the previous percentages
+    if (total > core->prev_total)
+    {
+        for (int f = 0; f < CPU_NFIELDS; f++)
         {
-            // calculate the output values based on the reads
-            total = usr + usr_lowprio + sys + idle;
-            // calculate the new values using deltas
-            // USER_HZ just scales ticks to the original value. It only matters in raw mode
-            float fact = USER_HZ / (float)(total - cpudata->total.prev_total);
-            cpudata->total.perc_usr = (usr - cpudata->total.prev_usr) * fact;
-            cpudata->total.perc_usr_nice = (usr_lowprio - cpudata->total.prev_usr_nice) * fact;
-            cpudata->total.perc_sys = (sys - cpudata->total.prev_sys) * fact;
-            cpudata->total.perc_idle = (idle - cpudata->total.prev_idle) * fact;
-            // update the previous values with the current reads
-            cpudata->total.prev_usr = usr;
-            cpudata->total.prev_usr_nice = usr_lowprio;
-            cpudata->total.prev_sys = sys;
-            cpudata->total.prev_idle = idle;
-            cpudata->total.prev_total = total;
+            core->perc[f] = (curr[f] >= core->prev[f]
+                                 ? get_percentage(curr[f], core->prev[f], total, core->prev_total, 100)
+                                 : 0);
+        }
+    }
+    memcpy(core->prev, curr, sizeof(curr));
+    core->prev_total = total;
+    core->online = true;
+}
 
-            // scan all cores cpu[0,1, ...]
-            for (int i = 0; i < cpudata->num_cores; i++)
+/**
+ * \brief Gets statistics about the cpu usage
+ *
+ * Reads /proc/stat (see man 5 proc) in a single pass: the aggregate cpu line, one line per
+ * online core and the ctxt, intr, processes, procs_running and procs_blocked lines.
+ * The file is kept open and read from the start at each call, and numbers are parsed
+ * in place, so no memory is allocated after the first call
+ * \param [in,out] cpudata The cpu statistics to be updated
+ * \return Returns true iff /proc/stat was read successfully
+ */
+bool get_cpu_info(CPU_data_t *cpudata)
+{
+    char path[BUF_BASESZ];
+    procfs_path(path, BUF_BASESZ, CPU_STATFILE);
+    if (procfile_read(&cpudata->stat_file, path) == false)
+    {
+        return false;
+    }
+    double now = history_now();
+
+    for (int i = 0; i < cpudata->num_cores; i++)
+    {
+        cpudata->percore[i].online = false;
+    }
+    const char *p = cpudata->stat_file.buf;
+    while (*p != '\0')
+    {
+        if (strncmp(p, "cpu", 3) == 0)
+        {
+            p += 3;
+            if (*p == ' ')
+            {
+                update_core(&cpudata->total, p);
+            }
+            else
             {
-                if (fgets(buf, bufsz, stat_file) == NULL)
+                // the label is cpuN, where N is the core's number
+                unsigned long core = parse_ull(&p);
+                if (core < (unsigned long)cpudata->num_cores)
                 {
-                    return false;
+                    update_core(&cpudata->percore[core], p);
                 }
-                sscanf(buf, "cpu%*d %lu %lu %lu %lu %*[^\n]", &usr, &usr_lowprio, &sys, &idle);
-
-                // calculate the output values based on the reads
-                total = usr + usr_lowprio + sys + idle;
-                // calculate the new values using deltas
-                float fact = USER_HZ / (float)(total - cpudata->percore[i].prev_total);
-                cpudata->percore[i].perc_usr = (usr - cpudata->percore[i].prev_usr) * fact;
-                cpudata->percore[i].perc_usr_nice = (usr_lowprio - cpudata->percore[i].prev_usr_nice) * fact;
-                cpudata->percore[i].perc_sys = (sys - cpudata->percore[i].prev_sys) * fact;
-                cpudata->percore[i].perc_idle = (idle - cpudata->percore[i].prev_idle) * fact;
-                // update the previous values with the current reads
-                cpudata->percore[i].prev_usr = usr;
-                cpudata->percore[i].prev_usr_nice = usr_lowprio;
-                cpudata->percore[i].prev_sys = sys;
-                cpudata->percore[i].prev_idle = idle;
-                cpudata->percore[i].prev_total = total;
             }
         }
-        fclose(stat_file);
+        else if (strncmp(p, "intr ", 5) == 0)
+        {
+            // only the first number is needed: the total, followed by the count of each interrupt
+            p += 5;
+            counter_update(&cpudata->intr, parse_ull(&p), now);
+        }
+        else if (strncmp(p, "ctxt ", 5) == 0)
+        {
+            p += 5;
+            counter_update(&cpudata->ctxt, parse_ull(&p), now);
+        }
+        else if (strncmp(p, "processes ", 10) == 0)
+        {
+            p += 10;
+            counter_update(&cpudata->forks, parse_ull(&p), now);
+        }
+        else if (strncmp(p, "procs_running ", 14) == 0)
+        {
+            p += 14;
+            cpudata->procs_running = parse_ull(&p);
+        }
+        else if (strncmp(p, "procs_blocked ", 14) == 0)
+        {
+            p += 14;
+            cpudata->procs_blocked = parse_ull(&p);
+        }
+        p = next_line(p);
     }
-    return (stat_file && buf ? true : false);
+    return true;
 }
 
+/**
+ * \brief Gets the cpu model and the number of cores
+ *
+ * The number of cores is the number of possible cores listed in sysfs, so that cores
+ * that are offline at startup (and may be brought online later) have their slot in the
+ * per-core statistics. If sysfs is not available, the cores listed in /proc/cpuinfo
+ * (the online ones) are counted instead
+ * \param [out] model The cpu model (alloc'd)
+ * \param [out] cores The number of cores
+ * \return Returns true iff the model and the number of cores were found
+ */
 bool get_cpu_model(char **model, int *cores)
 {
     FILE *cpuinfo = NULL;
     char buf[BUF_BASESZ];
     char mod[BUF_BASESZ];
     int found_core = -1;
-    if ((cpuinfo = fopen(CPU_MODELFILE, "r")))
+    procfs_path(buf, BUF_BASESZ, CPU_MODELFILE);
+    if ((cpuinfo = fopen(buf, "r")))
     {
         while (fgets(buf, BUF_BASESZ, cpuinfo))
         {
-            if (sscanf(buf, "model name\t: %[^\n]\n", mod) == 1)
+            if (*model == NULL && sscanf(buf, "model name\t: %[^\n]\n", mod) == 1)
             {
                 *model = strdup(mod);
             }
             sscanf(buf, "processor\t: %d", &found_core);
         }
+        fclose(cpuinfo);
+        int possible = get_possible_cpus();
+        if (possible > found_core + 1)
+        {
+            found_core = possible - 1;
+        }
         if (found_core == -1)
         {
             if (*model)
-                free(model);
+            {
+                free(*model);
+                *model = NULL;
+            }
             return false;
         }
         *cores = found_core + 1; // cores are numbered starting from 0, hence the increment
-
-        fclose(cpuinfo);
     }
     return (cpuinfo ? true : false);
 }
+
+int get_possible_cpus(void)
+{
+    char buf[BUF_BASESZ];
+    const char *p = buf;
+    FILE *fp = fopen(CPU_POSSIBLEFILE, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    if (fgets(buf, BUF_BASESZ, fp) == NULL)
+    {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    // the list is either a single core ("0") or a range ("0-191")
+    unsigned long last = parse_ull(&p);
+    if (*p == '-')
+    {
+        p++;
+        last = parse_ull(&p);
+    }
+    return last + 1;
+}
@@ -5,25 +5,41 @@
 #ifndef CPU_INFO_INCLUDED
 #define CPU_INFO_INCLUDED
 
-#include "main.h"
+#include "common.h"
+#include "history.h"
+#include "procfile.h"
 
-#define CPU_STATFILE "/proc/stat"
-#define CPU_MODELFILE "/proc/cpuinfo" // arch-dependent content
+// the files read, relative to the root of procfs (see procfs_path())
+#define CPU_STATFILE "stat"
+#define CPU_MODELFILE "cpuinfo" // arch-dependent content
+#define CPU_POSSIBLEFILE "/sys/devices/system/cpu/possible"
+#define CPU_ONLINEFILE "/sys/devices/system/cpu/online"
+
+// the fields of a cpu line in /proc/stat, in the order they appear
+enum cpu_field
+{
+    CPU_USER,
+    CPU_NICE,
+    CPU_SYSTEM,
+    CPU_IDLE,
+    CPU_IOWAIT,
+    CPU_IRQ,
+    CPU_SOFTIRQ,
+    CPU_STEAL,
+    CPU_GUEST,      // already accounted in CPU_USER
+    CPU_GUEST_NICE, // already accounted in CPU_NICE
+    CPU_NFIELDS
+};
 
 // defines a structure to hold cpu statistics
 struct core_data_t
 {
-    // previous (unscaled) data points
-    unsigned long int prev_usr;
-    unsigned long int prev_usr_nice;
-    unsigned long int prev_sys;
-    unsigned long int prev_idle;
+    bool online; // false if the core was not listed in the last read of /proc/stat
+    // previous (unscaled) data points, indexed by enum cpu_field
+    unsigned long int prev[CPU_NFIELDS];
     unsigned long int prev_total;
-    // current core usage percentages (calculated on deltas)
-    float perc_usr;
-    float perc_usr_nice;
-    float perc_sys;
-    float perc_idle;
+    // current core usage percentages (calculated on deltas), indexed by enum cpu_field
+    float perc[CPU_NFIELDS];
 };
 
 typedef struct cpu_data_t
@@ -32,15 +48,27 @@ typedef struct cpu_data_t
     int num_cores;               ///< The cpu's number of cores
     struct core_data_t *percore; ///< The per-core usage statistics
     struct core_data_t total;    ///< The usage statistics of the whole CPU
+    History_t usage_hist;        ///< The history of the usage percentage of the whole CPU
+    struct counter ctxt;         ///< Context switches since boot
+    struct counter intr;         ///< Interrupts serviced since boot
+    struct counter forks;        ///< Processes and threads created since boot
+    int procs_running;           ///< Threads currently running or ready to run
+    int procs_blocked;           ///< Threads currently blocked waiting for I/O
+    Procfile_t stat_file;        ///< /proc/stat, kept open across reads
     // syncronization variables
     pthread_mutex_t mux_memdata;
     pthread_cond_t cond_updating;
     bool is_busy;
 } CPU_data_t;
 
+// allocates the cpu statistics, reading the model and the number of cores once
+CPU_data_t *cpu_data_new(void);
+// closes the files of the cpu statistics and frees them
+void cpu_data_free(CPU_data_t *cpu);
 // gets statistics about the cpu usage
-// not reentrant: uses static variables
 bool get_cpu_info(CPU_data_t *cpudata);
 bool get_cpu_model(char **model, int *cores);
+// gets the number of cores that can be brought online (offline ones included), or -1
+int get_possible_cpus(void);
 
 #endif
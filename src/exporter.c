@@ -0,0 +1,658 @@
+/**
+ * \file exporter.c
+ * \brief Implements the exporter: Prometheus metrics served over HTTP from the latest snapshot
+ *
+ * The collector (the main thread) reads /proc every interval and renders the whole HTTP
+ * response once, into a snapshot that replaces the previous one. The server thread answers
+ * every scrape with a reference to the current snapshot, so scrapes never read /proc or
+ * format anything, and any number of scrapers costs one collection per interval. The
+ * connections are non-blocking and served by a poll() loop, so a slow client holds only
+ * its snapshot (which stays valid until it's sent) and never delays the others
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <glib.h>
+
+#include "exporter.h"
+#include "mem_info.h"
+#include "cpu_info.h"
+#include "process_info.h"
+#include "history.h"
+
+// the responses to requests for anything but the metrics
+static const char response_notfound[] = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n"
+                                        "Content-Length: 10\r\nConnection: close\r\n\r\nNot Found\n";
+static const char response_badrequest[] = "HTTP/1.1 400 Bad Request\r\nContent-Type: text/plain\r\n"
+                                          "Content-Length: 12\r\nConnection: close\r\n\r\nBad Request\n";
+
+// set by SIGINT and SIGTERM to stop the exporter
+static volatile sig_atomic_t exporter_stop = 0;
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    exporter_stop = 1;
+}
+
+// a growing buffer where the metrics are rendered (it's reused at each collection)
+struct metrics_buf
+{
+    char *data;
+    size_t len;
+    size_t size;
+    bool failed; ///< flag set if the buffer could not grow
+};
+
+static void mbuf_printf(struct metrics_buf *b, const char *fmt, ...)
+{
+    while (b->failed == false)
+    {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(b->data + b->len, b->size - b->len, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+        {
+            b->failed = true;
+        }
+        else if ((size_t)n < b->size - b->len)
+        {
+            b->len += n;
+            return;
+        }
+        else
+        {
+            size_t size = b->size * 2 + n;
+            char *data = realloc(b->data, size);
+            if (data == NULL)
+            {
+                b->failed = true;
+                return;
+            }
+            b->data = data;
+            b->size = size;
+        }
+    }
+}
+
+// appends s as the value of a label, escaped and cut at EXPORT_LABELMAX bytes (without splitting a UTF-8 character)
+static void mbuf_label(struct metrics_buf *b, const char *s)
+{
+    if (s == NULL)
+    {
+        return;
+    }
+    size_t len = strnlen(s, EXPORT_LABELMAX + 1);
+    if (len > EXPORT_LABELMAX)
+    {
+        // if the first byte left out continues a character, the whole character is left out
+        len = EXPORT_LABELMAX;
+        while (len > 0 && ((unsigned char)s[len] & 0xC0) == 0x80)
+        {
+            len--;
+        }
+    }
+    char value[EXPORT_LABELMAX * 2 + 1];
+    size_t v = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (s[i] == '\\' || s[i] == '"')
+        {
+            value[v++] = '\\';
+            value[v++] = s[i];
+        }
+        else if (s[i] == '\n')
+        {
+            value[v++] = '\\';
+            value[v++] = 'n';
+        }
+        else
+        {
+            value[v++] = s[i];
+        }
+    }
+    value[v] = '\0';
+    mbuf_printf(b, "%s", value);
+}
+
+// the busy share of a core (or the whole CPU)
+static float core_usage(const struct core_data_t *core)
+{
+    return 100.0 - core->perc[CPU_IDLE] - core->perc[CPU_IOWAIT];
+}
+
+// appends the labels of the process h
+static void process_labels(struct metrics_buf *b, TaskList *tasks, guint h)
+{
+    Task *p = task_at(tasks, h);
+    mbuf_printf(b, "{pid=\"%d\",user=\"", tasks->cols.pid[h]);
+    mbuf_label(b, p->username);
+    mbuf_printf(b, "\",command=\"");
+    mbuf_label(b, p->command);
+    mbuf_printf(b, "\"}");
+}
+
+/**
+ * \brief Renders the metrics of the latest collection
+ *
+ * The processes must be sorted by decreasing CPU usage: the first top ones are exported
+ * \param [out] b The buffer where the metrics are written (emptied first)
+ * \param [in] data The data structures filled by the collectors
+ * \param [in] top The number of processes exported
+ * \param [in] duration The time taken by the collection (in seconds)
+ * \param [in] scrapes The number of scrapes served so far
+ */
+static void render_metrics(struct metrics_buf *b, struct taskmgr_data_t *data, long top, double duration,
+                           unsigned long scrapes)
+{
+    const Mem_data_t *mem = data->mem_stats;
+    const CPU_data_t *cpu = data->cpu_stats;
+    TaskList *tasks = data->tasks;
+    b->len = 0;
+
+    mbuf_printf(b, "# HELP summer_memory_bytes Memory and swap from /proc/meminfo.\n"
+                   "# TYPE summer_memory_bytes gauge\n");
+    const char *mem_names[] = {"total", "free", "available", "buff_cache", "swap_total", "swap_free"};
+    unsigned long mem_kb[] = {mem->total_mem, mem->free_mem,  mem->avail_mem,
+                              mem->buffer_cached, mem->swp_tot, mem->swp_free};
+    for (size_t i = 0; i < sizeof(mem_kb) / sizeof(mem_kb[0]); i++)
+    {
+        mbuf_printf(b, "summer_memory_bytes{field=\"%s\"} %llu\n", mem_names[i], mem_kb[i] * 1024ULL);
+    }
+
+    mbuf_printf(b, "# HELP summer_cpu_usage_percent Share of CPU time by mode between the last two collections.\n"
+                   "# TYPE summer_cpu_usage_percent gauge\n");
+    const char *modes[] = {"user", "nice", "system", "idle", "iowait", "irq", "softirq", "steal"};
+    const enum cpu_field fields[] = {CPU_USER, CPU_NICE, CPU_SYSTEM, CPU_IDLE,
+                                     CPU_IOWAIT, CPU_IRQ, CPU_SOFTIRQ, CPU_STEAL};
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        mbuf_printf(b, "summer_cpu_usage_percent{mode=\"%s\"} %.1f\n", modes[i], cpu->total.perc[fields[i]]);
+    }
+    mbuf_printf(b, "# HELP summer_core_busy_percent Busy share (not idle nor waiting for I/O) of each online core.\n"
+                   "# TYPE summer_core_busy_percent gauge\n");
+    for (int c = 0; c < cpu->num_cores; c++)
+    {
+        if (cpu->percore[c].online == true)
+        {
+            mbuf_printf(b, "summer_core_busy_percent{core=\"%d\"} %.1f\n", c, core_usage(&cpu->percore[c]));
+        }
+    }
+    mbuf_printf(b,
+                "# HELP summer_context_switches_total Context switches since boot.\n"
+                "# TYPE summer_context_switches_total counter\n"
+                "summer_context_switches_total %llu\n"
+                "# HELP summer_procs_running Threads running or ready to run.\n"
+                "# TYPE summer_procs_running gauge\n"
+                "summer_procs_running %d\n"
+                "# HELP summer_procs_blocked Threads blocked waiting for I/O.\n"
+                "# TYPE summer_procs_blocked gauge\n"
+                "summer_procs_blocked %d\n"
+                "# HELP summer_processes Processes in the process list.\n"
+                "# TYPE summer_processes gauge\n"
+                "summer_processes %ld\n"
+                "# HELP summer_threads Threads of the processes in the process list.\n"
+                "# TYPE summer_threads gauge\n"
+                "summer_threads %ld\n",
+                cpu->ctxt.curr, cpu->procs_running, cpu->procs_blocked, tasks->num_ps, tasks->num_threads);
+
+    // the top processes, a family of metrics at a time as the format requires
+    long n = (top < tasks->num_ps ? top : tasks->num_ps);
+    mbuf_printf(b, "# HELP summer_process_cpu CPU usage of the processes using more CPU since the previous collection, in percent of one core.\n"
+                   "# TYPE summer_process_cpu gauge\n");
+    for (long i = 0; i < n; i++)
+    {
+        guint h = task_handle(tasks, i);
+        mbuf_printf(b, "summer_process_cpu");
+        process_labels(b, tasks, h);
+        mbuf_printf(b, " %lu\n", tasks->cols.cpu[h]);
+    }
+    mbuf_printf(b, "# HELP summer_process_resident_bytes Resident set of the processes using more CPU.\n"
+                   "# TYPE summer_process_resident_bytes gauge\n");
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (long i = 0; i < n; i++)
+    {
+        guint h = task_handle(tasks, i);
+        mbuf_printf(b, "summer_process_resident_bytes");
+        process_labels(b, tasks, h);
+        mbuf_printf(b, " %ld\n", tasks->cols.resident_set[h] * page_size);
+    }
+    mbuf_printf(b, "# HELP summer_process_threads Threads of the processes using more CPU.\n"
+                   "# TYPE summer_process_threads gauge\n");
+    for (long i = 0; i < n; i++)
+    {
+        guint h = task_handle(tasks, i);
+        mbuf_printf(b, "summer_process_threads");
+        process_labels(b, tasks, h);
+        mbuf_printf(b, " %ld\n", tasks->cols.num_threads[h]);
+    }
+
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    mbuf_printf(b,
+                "# HELP summer_collection_timestamp_seconds Time of the collection these metrics come from.\n"
+                "# TYPE summer_collection_timestamp_seconds gauge\n"
+                "summer_collection_timestamp_seconds %.3f\n"
+                "# HELP summer_collection_duration_seconds Time taken by the collection.\n"
+                "# TYPE summer_collection_duration_seconds gauge\n"
+                "summer_collection_duration_seconds %.6f\n"
+                "# HELP summer_exporter_scrapes_total Scrapes served before this collection.\n"
+                "# TYPE summer_exporter_scrapes_total counter\n"
+                "summer_exporter_scrapes_total %lu\n",
+                wall.tv_sec + wall.tv_nsec / 1e9, duration, scrapes);
+}
+
+// drops a reference to a snapshot, freeing it if it was the last one (call it with the mutex locked)
+static void release_snapshot(struct metrics_snapshot *snap)
+{
+    if (snap != NULL && --snap->refs == 0)
+    {
+        free(snap);
+    }
+}
+
+// makes a snapshot with the HTTP response for the metrics in b and replaces the current one with it
+static bool publish_snapshot(Exporter_t *ex, const struct metrics_buf *b)
+{
+    char headers[160];
+    int hlen = snprintf(headers, sizeof(headers),
+                        "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                        "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                        b->len);
+    struct metrics_snapshot *snap = malloc(sizeof(struct metrics_snapshot) + hlen + b->len);
+    if (snap == NULL)
+    {
+        return false;
+    }
+    snap->refs = 1;
+    snap->len = hlen + b->len;
+    memcpy(snap->data, headers, hlen);
+    memcpy(snap->data + hlen, b->data, b->len);
+
+    pthread_mutex_lock(&ex->mux_memdata);
+    release_snapshot(ex->current);
+    ex->current = snap;
+    pthread_mutex_unlock(&ex->mux_memdata);
+    return true;
+}
+
+// opens the listening socket: a Unix socket if the address has a '/', a port on the loopback interface otherwise
+static bool open_listener(Exporter_t *ex, const char *address)
+{
+    int fd;
+    if (strchr(address, '/') != NULL)
+    {
+        struct sockaddr_un sa = {.sun_family = AF_UNIX};
+        if (strlen(address) >= sizeof(sa.sun_path))
+        {
+            fprintf(stderr, "Socket path too long: %s\n", address);
+            return false;
+        }
+        strcpy(sa.sun_path, address);
+        // a socket left by a previous run is replaced, anything else is not touched
+        struct stat st;
+        if (lstat(address, &st) == 0 && S_ISSOCK(st.st_mode))
+        {
+            unlink(address);
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1 || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1)
+        {
+            perror(address);
+            if (fd != -1)
+                close(fd);
+            return false;
+        }
+        ex->unix_path = address;
+    }
+    else
+    {
+        long port;
+        if (isNumber(address, &port) != 0 || port < 1 || port > 65535)
+        {
+            fprintf(stderr, "Not a port or a socket path: %s\n", address);
+            return false;
+        }
+        struct sockaddr_in sa = {.sin_family = AF_INET, .sin_port = htons(port)};
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd == -1 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == -1 ||
+            bind(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1)
+        {
+            perror(address);
+            if (fd != -1)
+                close(fd);
+            return false;
+        }
+        ex->unix_path = NULL;
+    }
+    if (listen(fd, SOMAXCONN) == -1)
+    {
+        perror("listen");
+        close(fd);
+        return false;
+    }
+    ex->listen_fd = fd;
+    return true;
+}
+
+// closes the connection of the client i, replacing it with the last one
+static void drop_client(Exporter_t *ex, int i)
+{
+    struct export_client *cl = &ex->clients[i];
+    close(cl->fd);
+    if (cl->snap != NULL)
+    {
+        pthread_mutex_lock(&ex->mux_memdata);
+        release_snapshot(cl->snap);
+        pthread_mutex_unlock(&ex->mux_memdata);
+    }
+    ex->num_clients--;
+    if (i != ex->num_clients)
+    {
+        // only the fields in use are copied, not the whole request buffer
+        struct export_client *last = &ex->clients[ex->num_clients];
+        cl->fd = last->fd;
+        cl->since = last->since;
+        cl->snap = last->snap;
+        cl->out = last->out;
+        cl->out_len = last->out_len;
+        cl->sent = last->sent;
+        cl->req_len = last->req_len;
+        memcpy(cl->req, last->req, last->req_len);
+    }
+}
+
+// sends what it can of the response of the client i, returning false once the client is dropped
+static bool send_response(Exporter_t *ex, int i)
+{
+    struct export_client *cl = &ex->clients[i];
+    while (cl->sent < cl->out_len)
+    {
+        ssize_t n = send(cl->fd, cl->out + cl->sent, cl->out_len - cl->sent, MSG_NOSIGNAL);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            break;
+        }
+        cl->sent += n;
+    }
+    if (cl->sent == cl->out_len)
+    {
+        shutdown(cl->fd, SHUT_WR);
+    }
+    drop_client(ex, i);
+    return false;
+}
+
+// picks the response to a complete request: the current snapshot for GET /metrics (or /)
+static void choose_response(Exporter_t *ex, struct export_client *cl)
+{
+    char method[8], target[64];
+    cl->req[cl->req_len] = '\0';
+    if (sscanf(cl->req, "%7s %63s", method, target) != 2)
+    {
+        cl->out = response_badrequest;
+        cl->out_len = sizeof(response_badrequest) - 1;
+        return;
+    }
+    target[strcspn(target, "?")] = '\0';
+    if (strcmp(method, "GET") != 0 || (strcmp(target, "/metrics") != 0 && strcmp(target, "/") != 0))
+    {
+        cl->out = response_notfound;
+        cl->out_len = sizeof(response_notfound) - 1;
+        return;
+    }
+    pthread_mutex_lock(&ex->mux_memdata);
+    cl->snap = ex->current;
+    cl->snap->refs++;
+    ex->scrapes++;
+    pthread_mutex_unlock(&ex->mux_memdata);
+    cl->out = cl->snap->data;
+    cl->out_len = cl->snap->len;
+}
+
+// reads what's available of the request of the client i, returning false once the client is dropped
+static bool read_request(Exporter_t *ex, int i)
+{
+    struct export_client *cl = &ex->clients[i];
+    // a byte is left for the terminator
+    ssize_t n = recv(cl->fd, cl->req + cl->req_len, EXPORT_REQSZ - 1 - cl->req_len, 0);
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        return true;
+    }
+    if (n <= 0)
+    {
+        drop_client(ex, i);
+        return false;
+    }
+    cl->req_len += n;
+    cl->req[cl->req_len] = '\0';
+    // the response is sent once the headers are over, so that no request data is left unread at the close
+    if (strstr(cl->req, "\r\n\r\n") != NULL || strstr(cl->req, "\n\n") != NULL)
+    {
+        choose_response(ex, cl);
+    }
+    else if (cl->req_len == EXPORT_REQSZ - 1)
+    {
+        cl->out = response_badrequest;
+        cl->out_len = sizeof(response_badrequest) - 1;
+    }
+    else
+    {
+        return true;
+    }
+    return send_response(ex, i);
+}
+
+/**
+ * \brief The server thread: accepts the connections and answers them from the current snapshot
+ *
+ * A poll() loop over the listening socket, the wake-up pipe and the connections: a client
+ * is polled for input until its request is complete, then for output until its response
+ * is sent. Clients slower than EXPORT_TIMEOUT are dropped
+ * \param [in,out] arg The Exporter_t
+ * \return Returns NULL
+ */
+static void *serve_metrics(void *arg)
+{
+    Exporter_t *ex = arg;
+    struct pollfd *pfds = malloc((EXPORT_MAXCLIENTS + 2) * sizeof(struct pollfd));
+    if (pfds == NULL)
+    {
+        return NULL;
+    }
+    while (true)
+    {
+        pfds[0] = (struct pollfd){.fd = ex->wake_pipe[0], .events = POLLIN};
+        // new connections wait in the backlog while the clients are too many
+        pfds[1] = (struct pollfd){.fd = ex->listen_fd, .events = (ex->num_clients < EXPORT_MAXCLIENTS ? POLLIN : 0)};
+        for (int i = 0; i < ex->num_clients; i++)
+        {
+            pfds[i + 2] = (struct pollfd){.fd = ex->clients[i].fd,
+                                          .events = (ex->clients[i].out == NULL ? POLLIN : POLLOUT)};
+        }
+        int polled = ex->num_clients;
+        if (poll(pfds, polled + 2, 1000) == -1 && errno != EINTR)
+        {
+            break;
+        }
+        if (pfds[0].revents != 0)
+        {
+            break;
+        }
+        // backwards, so that a dropped client is replaced by one already handled
+        double now = history_now();
+        for (int i = polled - 1; i >= 0; i--)
+        {
+            struct export_client *cl = &ex->clients[i];
+            if (pfds[i + 2].revents & (POLLERR | POLLNVAL))
+            {
+                drop_client(ex, i);
+            }
+            else if (pfds[i + 2].revents != 0)
+            {
+                if (cl->out == NULL)
+                    read_request(ex, i);
+                else
+                    send_response(ex, i);
+            }
+            else if (now - cl->since > EXPORT_TIMEOUT)
+            {
+                drop_client(ex, i);
+            }
+        }
+        if (pfds[1].revents & POLLIN)
+        {
+            while (ex->num_clients < EXPORT_MAXCLIENTS)
+            {
+                int fd = accept4(ex->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd == -1)
+                {
+                    break;
+                }
+                struct export_client *cl = &ex->clients[ex->num_clients++];
+                cl->fd = fd;
+                cl->since = now;
+                cl->snap = NULL;
+                cl->out = NULL;
+                cl->out_len = 0;
+                cl->sent = 0;
+                cl->req_len = 0;
+                // most requests are already there: answering them now saves a poll()
+                read_request(ex, ex->num_clients - 1);
+            }
+        }
+    }
+    while (ex->num_clients > 0)
+    {
+        drop_client(ex, ex->num_clients - 1);
+    }
+    free(pfds);
+    return NULL;
+}
+
+/**
+ * \brief Runs the collectors in a loop, serving their latest data as Prometheus metrics
+ *
+ * The data is collected in this thread (no update thread is started) on absolute times of
+ * the monotonic clock, like the batch mode; the connections are served by another thread.
+ * It runs until SIGINT or SIGTERM
+ * \param [in,out] data The data structures filled by the collectors
+ * \param [in] opts The address, number of processes and interval
+ * \return Returns the exit status of the program: 0, or 1 if the exporter can't start
+ */
+int run_exporter(struct taskmgr_data_t *data, const struct export_options *opts)
+{
+    Exporter_t ex = {.listen_fd = -1, .wake_pipe = {-1, -1}};
+    struct metrics_buf buf = {.size = 65536};
+    buf.data = malloc(buf.size);
+    ex.clients = malloc(EXPORT_MAXCLIENTS * sizeof(struct export_client));
+    if (buf.data == NULL || ex.clients == NULL || open_listener(&ex, opts->address) == false ||
+        pipe2(ex.wake_pipe, O_CLOEXEC) == -1)
+    {
+        free(buf.data);
+        free(ex.clients);
+        if (ex.listen_fd != -1)
+            close(ex.listen_fd);
+        return 1;
+    }
+    pthread_mutex_init(&ex.mux_memdata, NULL);
+
+    struct sigaction sa = {.sa_handler = on_stop_signal};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    long long interval_ns = (long long)(opts->interval * 1e9);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    pthread_t server_th;
+    bool serving = false;
+    int ret = 0;
+    while (exporter_stop == 0)
+    {
+        double start = history_now();
+        get_mem_info(data->mem_stats);
+        get_cpu_info(data->cpu_stats);
+        get_processes_info(data->tasks, data->cpu_stats);
+        g_array_sort_with_data(data->tasks->order, cmp_cpu_decr, data->tasks);
+        // the count of scrapes is read before rendering, without waiting for the lock otherwise
+        pthread_mutex_lock(&ex.mux_memdata);
+        unsigned long scrapes = ex.scrapes;
+        pthread_mutex_unlock(&ex.mux_memdata);
+        render_metrics(&buf, data, opts->top, history_now() - start, scrapes);
+        if (buf.failed == true || publish_snapshot(&ex, &buf) == false)
+        {
+            fprintf(stderr, "Out of memory rendering the metrics\n");
+            ret = 1;
+            break;
+        }
+        if (serving == false)
+        {
+            // the server starts once there is a snapshot, with the stop signals left to this thread
+            sigset_t stop_sigs, old_sigs;
+            sigemptyset(&stop_sigs);
+            sigaddset(&stop_sigs, SIGINT);
+            sigaddset(&stop_sigs, SIGTERM);
+            pthread_sigmask(SIG_BLOCK, &stop_sigs, &old_sigs);
+            serving = (pthread_create(&server_th, NULL, serve_metrics, &ex) == 0);
+            pthread_sigmask(SIG_SETMASK, &old_sigs, NULL);
+            if (serving == false)
+            {
+                ret = 1;
+                break;
+            }
+        }
+
+        long long ns = next.tv_nsec + interval_ns;
+        next.tv_sec += ns / 1000000000LL;
+        next.tv_nsec = ns % 1000000000LL;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec))
+        {
+            next = now;
+        }
+        // interrupted by the stop signals
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    if (serving == true)
+    {
+        // wakes up the server thread to stop it
+        while (write(ex.wake_pipe[1], "", 1) == -1 && errno == EINTR)
+        {
+        }
+        pthread_join(server_th, NULL);
+    }
+    close(ex.listen_fd);
+    if (ex.unix_path != NULL)
+        unlink(ex.unix_path);
+    close(ex.wake_pipe[0]);
+    close(ex.wake_pipe[1]);
+    release_snapshot(ex.current);
+    pthread_mutex_destroy(&ex.mux_memdata);
+    free(ex.clients);
+    free(buf.data);
+    return ret;
+}
@@ -0,0 +1,76 @@
+/**
+ * \file exporter.h
+ * \brief Headless mode that serves the collected data as Prometheus metrics over HTTP
+ */
+#ifndef EXPORTER_INCLUDED
+#define EXPORTER_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <pthread.h>
+
+#include "main.h"
+
+// default number of processes whose metrics are exported (the ones using more CPU)
+#define EXPORT_TOPN 10
+// maximum number of connections served at once (more are left waiting in the backlog)
+#define EXPORT_MAXCLIENTS 256
+// maximum size of a request (the request line and the headers)
+#define EXPORT_REQSZ 2048
+// seconds a client has to send its request and read the response before it's dropped
+#define EXPORT_TIMEOUT 10
+// maximum length of the command label of a process (longer commands are cut)
+#define EXPORT_LABELMAX 128
+
+// the options of the exporter, set from the command line
+struct export_options
+{
+    const char *address; ///< a port on the loopback interface, or the path of a Unix socket (if it has a '/')
+    long top;            ///< the number of processes exported
+    double interval;     ///< the interval between two collections (in seconds)
+};
+
+/**
+ * \brief A rendered response to a scrape, shared by the clients reading it
+ *
+ * A snapshot is never modified once published: the collector publishes a new one and the
+ * old one is freed when the last client sending it is done
+ */
+struct metrics_snapshot
+{
+    unsigned int refs; ///< the number of references (the exporter's, if it's the current one, plus a client's each)
+    size_t len;        ///< the length of the response
+    char data[];       ///< the response: HTTP headers and metrics
+};
+
+// a connection to a client
+struct export_client
+{
+    int fd;
+    double since;                  ///< the time the connection was accepted (monotonic, in seconds)
+    struct metrics_snapshot *snap; ///< the snapshot being sent (NULL for the static responses)
+    const char *out;               ///< the response being sent (NULL while the request is read)
+    size_t out_len;                ///< the length of the response
+    size_t sent;                   ///< the bytes of the response sent so far
+    size_t req_len;                ///< the bytes of the request read so far
+    char req[EXPORT_REQSZ];
+};
+
+// the state shared by the collector and the server thread
+typedef struct exporter_t
+{
+    int listen_fd;
+    int wake_pipe[2];                 ///< written by the collector to stop the server thread
+    const char *unix_path;            ///< the path of the Unix socket, removed at exit (NULL for TCP)
+    pthread_mutex_t mux_memdata;      ///< protects current and the reference counts of the snapshots
+    struct metrics_snapshot *current; ///< the latest snapshot published
+    struct export_client *clients;    ///< the open connections (num_clients of EXPORT_MAXCLIENTS)
+    int num_clients;
+    unsigned long scrapes; ///< the number of responses with metrics started
+} Exporter_t;
+
+// collects the data every opts->interval seconds, serving the latest metrics at opts->address
+int run_exporter(struct taskmgr_data_t *data, const struct export_options *opts);
+
+#endif
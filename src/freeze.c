@@ -0,0 +1,284 @@
+/**
+ * \file freeze.c
+ * \brief Implements the freeze mode and the diff between the frozen and the live processes
+ */
+#include <stdlib.h>
+
+#include <unistd.h>
+
+#include "freeze.h"
+
+Freeze_t *freeze_new(void)
+{
+    Freeze_t *fz = calloc(1, sizeof(Freeze_t));
+    if (fz == NULL)
+    {
+        return NULL;
+    }
+    fz->shown = g_array_new(false, false, sizeof(guint));
+    fz->diff = g_array_new(false, false, sizeof(struct task_diff));
+    fz->handles = g_array_new(false, false, sizeof(guint));
+    pthread_mutex_init(&fz->mux_memdata, NULL);
+    return fz;
+}
+
+void freeze_free(Freeze_t *fz)
+{
+    if (fz == NULL)
+    {
+        return;
+    }
+    snapshot_unref(fz->frozen);
+    snapshot_unref(fz->live);
+    g_array_free(fz->shown, true);
+    g_array_free(fz->diff, true);
+    g_array_free(fz->handles, true);
+    pthread_mutex_destroy(&fz->mux_memdata);
+    free(fz);
+}
+
+void freeze_toggle(Freeze_t *fz)
+{
+    pthread_mutex_lock(&fz->mux_memdata);
+    fz->want_frozen = (fz->want_frozen == true ? false : true);
+    fz->show_diff = false;
+    pthread_mutex_unlock(&fz->mux_memdata);
+}
+
+void freeze_toggle_diff(Freeze_t *fz)
+{
+    pthread_mutex_lock(&fz->mux_memdata);
+    // the diff is shown only while the list is frozen
+    fz->show_diff = (fz->show_diff == false && fz->want_frozen == true);
+    pthread_mutex_unlock(&fz->mux_memdata);
+}
+
+// the index of the process with the given PID in a snapshot, or -1
+static long find_rec_task(const Snapshot_t *snap, int pid)
+{
+    long lo = 0, hi = snap->tasks->len;
+    while (lo < hi)
+    {
+        long mid = lo + (hi - lo) / 2;
+        if (snapshot_task(snap, mid)->pid < pid)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < (long)snap->tasks->len && snapshot_task(snap, lo)->pid == pid)
+    {
+        return lo;
+    }
+    return -1;
+}
+
+/**
+ * \brief Freezes or unfreezes the list as requested by the input, at each refresh of the process window
+ *
+ * Freezing sorts the processes as they are displayed, then takes a snapshot of them with
+ * the order of their PIDs, so that the frozen list is shown as it was on the screen. The
+ * snapshot is the live one too until freeze_update() takes another at the next update,
+ * sharing the processes that didn't change. Unfreezing releases both
+ * \param [in,out] fz The state of the freeze mode
+ * \param [in,out] tasks The processes (locked here while they are read)
+ * \return Returns true if the list is frozen (fz->frozen is set), false if the live list must be shown
+ */
+bool freeze_sync(Freeze_t *fz, TaskList *tasks)
+{
+    pthread_mutex_lock(&fz->mux_memdata);
+    bool want_frozen = fz->want_frozen;
+    pthread_mutex_unlock(&fz->mux_memdata);
+    if (want_frozen == (fz->frozen != NULL))
+    {
+        return want_frozen;
+    }
+
+    if (want_frozen == false)
+    {
+        pthread_mutex_lock(&fz->mux_memdata);
+        fz->active = false;
+        Snapshot_t *live = fz->live;
+        fz->live = NULL;
+        pthread_mutex_unlock(&fz->mux_memdata);
+        // the window may be drawing neither of them: they are freed here, unless a reader still holds them
+        snapshot_unref(live);
+        snapshot_unref(fz->frozen);
+        fz->frozen = NULL;
+        g_array_set_size(fz->shown, 0);
+        g_array_set_size(fz->diff, 0);
+        return false;
+    }
+
+    // about to access shared data: lock
+    pthread_mutex_lock(&tasks->mux_memdata);
+    while (tasks->is_busy == true)
+    {
+        pthread_cond_wait(&tasks->cond_updating, &tasks->mux_memdata);
+    }
+    tasks->is_busy = true;
+    g_array_sort_with_data(tasks->order, tasks->sortfun, tasks);
+    GArray *pids = g_array_sized_new(false, false, sizeof(int), tasks->num_ps);
+    for (long i = 0; i < tasks->num_ps; i++)
+    {
+        g_array_append_val(pids, tasks->cols.pid[task_handle(tasks, i)]);
+    }
+    fz->frozen = snapshot_take(tasks, NULL, fz->handles);
+    tasks->is_busy = false;
+    pthread_cond_signal(&tasks->cond_updating);
+    // shared data is not accessed now: unlock
+    pthread_mutex_unlock(&tasks->mux_memdata);
+
+    if (fz->frozen == NULL)
+    {
+        g_array_free(pids, true);
+        // the list can't be frozen: it stays live
+        pthread_mutex_lock(&fz->mux_memdata);
+        fz->want_frozen = false;
+        fz->show_diff = false;
+        pthread_mutex_unlock(&fz->mux_memdata);
+        return false;
+    }
+    g_array_set_size(fz->shown, 0);
+    for (guint i = 0; i < pids->len; i++)
+    {
+        long idx = find_rec_task(fz->frozen, g_array_index(pids, int, i));
+        if (idx >= 0)
+        {
+            guint u = idx;
+            g_array_append_val(fz->shown, u);
+        }
+    }
+    g_array_free(pids, true);
+    tasks->cursor_start = 0;
+
+    pthread_mutex_lock(&fz->mux_memdata);
+    fz->active = true;
+    // nothing changed yet: the next update shares the processes of the freeze that stay the same
+    fz->live = snapshot_ref(fz->frozen);
+    pthread_mutex_unlock(&fz->mux_memdata);
+    return true;
+}
+
+/**
+ * \brief Takes the snapshot of the processes that the frozen one is compared with
+ *
+ * It's called by the threads updating the TaskList (the collector, the replay or the
+ * attached viewer) at the end of each update, while they still hold its lock. Nothing is
+ * done unless the list is frozen. The snapshot shares the processes that didn't change with
+ * the previous one, which it replaces: that is freed unless the process window is still
+ * reading it
+ * \param [in,out] fz The state of the freeze mode (can be NULL)
+ * \param [in] tasks The processes, locked by the caller
+ */
+void freeze_update(Freeze_t *fz, TaskList *tasks)
+{
+    if (fz == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&fz->mux_memdata);
+    Snapshot_t *prev = (fz->active == true ? snapshot_ref(fz->live) : NULL);
+    pthread_mutex_unlock(&fz->mux_memdata);
+    if (prev == NULL)
+    {
+        return;
+    }
+
+    Snapshot_t *snap = snapshot_take(tasks, prev, fz->handles);
+    snapshot_unref(prev);
+    if (snap == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&fz->mux_memdata);
+    Snapshot_t *old = snap;
+    // the list may have been unfrozen meanwhile: then the new snapshot is dropped
+    if (fz->active == true)
+    {
+        old = fz->live;
+        fz->live = snap;
+    }
+    pthread_mutex_unlock(&fz->mux_memdata);
+    snapshot_unref(old);
+}
+
+Snapshot_t *freeze_get_live(Freeze_t *fz, bool *show_diff)
+{
+    pthread_mutex_lock(&fz->mux_memdata);
+    Snapshot_t *live = (fz->live != NULL ? snapshot_ref(fz->live) : NULL);
+    if (show_diff != NULL)
+    {
+        *show_diff = fz->show_diff;
+    }
+    pthread_mutex_unlock(&fz->mux_memdata);
+    return live;
+}
+
+// tells whether a process changed between two states by more than the thresholds of the diff view
+static bool task_changed(const struct rec_task *a, const struct rec_task *b, long page_kb)
+{
+    long dcpu = (long)b->cpu - (long)a->cpu;
+    long drss = (b->resident_set - a->resident_set) * page_kb;
+    long dthreads = b->num_threads - a->num_threads;
+    return (labs(dcpu) > DIFF_CPU_THRESHOLD || labs(drss) > DIFF_RSS_THRESHOLD_KB ||
+            labs(dthreads) > DIFF_THREADS_THRESHOLD);
+}
+
+/**
+ * \brief Lists the processes that differ between two states
+ *
+ * Both lists are sorted by PID, so they are merged in a single pass: a PID found only in
+ * before is a process that exited, one found only in after a process that appeared. A PID
+ * found in both with different start times was reused, so it's listed as both. A process
+ * shared by the snapshots didn't change. The rows are in PID order, and point to the
+ * processes of the snapshots (they are valid as long as the snapshots are)
+ * \param [out] rows The processes that differ (struct task_diff), replacing its contents
+ * \param [in] before The processes at the freeze
+ * \param [in] after The processes at the latest update
+ */
+void freeze_diff(GArray *rows, const Snapshot_t *before, const Snapshot_t *after)
+{
+    long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    g_array_set_size(rows, 0);
+    guint i = 0, j = 0;
+    while (i < before->tasks->len || j < after->tasks->len)
+    {
+        const struct rec_task *a = (i < before->tasks->len ? snapshot_task(before, i) : NULL);
+        const struct rec_task *b = (j < after->tasks->len ? snapshot_task(after, j) : NULL);
+        struct task_diff d = {DIFF_CHANGED, NULL, NULL};
+        if (b == NULL || (a != NULL && a->pid < b->pid))
+        {
+            d.kind = DIFF_EXITED;
+            d.before = a;
+            i++;
+        }
+        else if (a == NULL || b->pid < a->pid)
+        {
+            d.kind = DIFF_APPEARED;
+            d.after = b;
+            j++;
+        }
+        else if (a->start_time != b->start_time)
+        {
+            // the PID was reused: the process of the freeze exited, the one with its PID appeared
+            struct task_diff gone = {DIFF_EXITED, a, NULL};
+            g_array_append_val(rows, gone);
+            d.kind = DIFF_APPEARED;
+            d.after = b;
+            i++;
+            j++;
+        }
+        else
+        {
+            i++;
+            j++;
+            if (a == b || task_changed(a, b, page_kb) == false)
+            {
+                continue;
+            }
+            d.before = a;
+            d.after = b;
+        }
+        g_array_append_val(rows, d);
+    }
+}
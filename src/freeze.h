@@ -0,0 +1,78 @@
+/**
+ * \file freeze.h
+ * \brief The freeze mode: the process list shown is pinned while the data is still collected
+ *
+ * Freezing takes a snapshot of the processes (see snapshot.h) with the order they are shown
+ * in, and the process window draws it until the list is unfrozen. Meanwhile the threads
+ * updating the TaskList take a snapshot after each update, replacing the previous one and
+ * sharing with it the processes that didn't change: the diff view merges it with the frozen
+ * one, to mark the processes that appeared, exited or changed since the freeze. The window
+ * holds a reference to each snapshot while drawing, so neither the updates nor an unfreeze
+ * wait for it
+ */
+#ifndef FREEZE_INCLUDED
+#define FREEZE_INCLUDED
+
+#include <stdbool.h>
+
+#include <glib.h>
+#include <pthread.h>
+
+#include "snapshot.h"
+#include "process_info.h"
+
+// the changes since the freeze that mark a process as changed in the diff view (they must be exceeded)
+#define DIFF_CPU_THRESHOLD 5       // CPU usage over the last interval, in percent of one core
+#define DIFF_RSS_THRESHOLD_KB 8192 // resident set
+#define DIFF_THREADS_THRESHOLD 0   // threads (any change)
+
+// how a process differs between the freeze and the latest update
+enum diff_kind
+{
+    DIFF_APPEARED, ///< it started after the freeze (reusing the PID of a process that exited, maybe)
+    DIFF_EXITED,   ///< it exited after the freeze
+    DIFF_CHANGED   ///< its CPU usage, resident set or threads changed by more than the thresholds
+};
+
+// a row of the diff view
+struct task_diff
+{
+    enum diff_kind kind;
+    const struct rec_task *before; ///< the process at the freeze (NULL if it appeared)
+    const struct rec_task *after;  ///< the process at the latest update (NULL if it exited)
+};
+
+typedef struct freeze_t
+{
+    // drawn by the process window, and only touched by the thread drawing it
+    Snapshot_t *frozen; ///< the processes at the freeze (NULL while the list is live)
+    GArray *shown;      ///< the indexes (guint) of the processes of frozen in the order they were shown
+    GArray *diff;       ///< the rows of the diff view (struct task_diff), merged again at each refresh
+    // shared with the input and with the threads updating the TaskList
+    bool want_frozen;   ///< flag toggled by the input: the list is frozen or unfrozen at the next refresh
+    bool show_diff;     ///< flag set to show the differences from the frozen list instead of it
+    bool active;        ///< flag set while the list is frozen: each update takes a snapshot
+    Snapshot_t *live;   ///< the processes at the latest update since the freeze (the frozen ones until the first)
+    pthread_mutex_t mux_memdata;
+    // used with the TaskList locked, by the thread freezing the list or updating it
+    GArray *handles; ///< the handles (guint) of the TaskList sorted by PID, for each snapshot
+} Freeze_t;
+
+// allocates the state of a list that's not frozen
+Freeze_t *freeze_new(void);
+// frees it, with its snapshots
+void freeze_free(Freeze_t *fz);
+// freezes the list at the next refresh, or unfreezes it
+void freeze_toggle(Freeze_t *fz);
+// shows or hides the differences from the frozen list
+void freeze_toggle_diff(Freeze_t *fz);
+// called by the process window at each refresh: freezes or unfreezes the list as requested, telling whether it's frozen
+bool freeze_sync(Freeze_t *fz, TaskList *tasks);
+// called after each update of the TaskList (with its lock held): takes the snapshot compared with the frozen one
+void freeze_update(Freeze_t *fz, TaskList *tasks);
+// takes a reference to the snapshot of the latest update (NULL if there's none), telling whether the diff is shown
+Snapshot_t *freeze_get_live(Freeze_t *fz, bool *show_diff);
+// merges the processes of two snapshots, filling rows with those that differ
+void freeze_diff(GArray *rows, const Snapshot_t *before, const Snapshot_t *after);
+
+#endif
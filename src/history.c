@@ -0,0 +1,151 @@
+/**
+ * \file history.c
+ * \brief Implements a bounded history of samples with min/max/avg downsampling
+ *
+ * Each metric keeps HISTORY_LEN buckets for each of the resolutions below, so its memory
+ * footprint doesn't depend on how long the program has been running. A sample is
+ * accumulated into the current bucket of every resolution, and a bucket is moved into
+ * its ring only when a sample falls in the next time interval
+ */
+#include <string.h>
+#include <time.h>
+
+#include "history.h"
+
+// the time interval (in seconds) summarized by a bucket at each resolution
+static const int history_resolutions[HISTORY_LEVELS] = {1, 10, 60};
+static const char *history_names[HISTORY_LEVELS] = {"1s", "10s", "1min"};
+
+void history_init(History_t *h)
+{
+    memset(h, 0, sizeof(History_t));
+    for (int l = 0; l < HISTORY_LEVELS; l++)
+    {
+        h->levels[l].acc_id = -1;
+    }
+}
+
+/**
+ * \brief Adds a sample to the history
+ *
+ * The sample is added to the bucket being filled at each resolution. If the sample
+ * belongs to a later time interval than that bucket, the bucket is first stored in the
+ * ring (overwriting the oldest one when the ring is full). Intervals without samples
+ * are not stored, so a gap in sampling doesn't cost more than a single sample
+ * \param [in,out] h The history of the metric
+ * \param [in] value The sample
+ * \param [in] now The time the sample was taken, in seconds (see history_now())
+ */
+void history_append(History_t *h, float value, double now)
+{
+    for (int l = 0; l < HISTORY_LEVELS; l++)
+    {
+        struct history_level *lvl = &h->levels[l];
+        long id = (long)(now / history_resolutions[l]);
+        if (id != lvl->acc_id)
+        {
+            if (lvl->acc.count > 0)
+            {
+                lvl->ring[lvl->head] = lvl->acc;
+                lvl->head = (lvl->head + 1) % HISTORY_LEN;
+                if (lvl->filled < HISTORY_LEN)
+                {
+                    lvl->filled++;
+                }
+            }
+            lvl->acc_id = id;
+            lvl->acc.count = 0;
+            lvl->acc.sum = 0;
+            lvl->acc.min = value;
+            lvl->acc.max = value;
+        }
+        if (value < lvl->acc.min)
+            lvl->acc.min = value;
+        if (value > lvl->acc.max)
+            lvl->acc.max = value;
+        lvl->acc.sum += value;
+        lvl->acc.count++;
+    }
+}
+
+/**
+ * \brief Gets a bucket from the history
+ *
+ * The bucket still being filled is at age 0, so that the latest samples are always
+ * included, followed by the completed ones from the newest to the oldest
+ * \param [in] h The history of the metric
+ * \param [in] level The resolution (0 to HISTORY_LEVELS - 1)
+ * \param [in] age The position of the bucket, starting from the latest
+ * \return Returns a pointer to the bucket, or NULL if there is no such bucket
+ */
+const struct history_bucket *history_get(const History_t *h, int level, int age)
+{
+    if (level < 0 || level >= HISTORY_LEVELS || age < 0)
+    {
+        return NULL;
+    }
+    const struct history_level *lvl = &h->levels[level];
+    if (lvl->acc.count > 0)
+    {
+        if (age == 0)
+        {
+            return &lvl->acc;
+        }
+        age--;
+    }
+    if (age >= lvl->filled)
+    {
+        return NULL;
+    }
+    return &lvl->ring[(lvl->head - 1 - age + HISTORY_LEN) % HISTORY_LEN];
+}
+
+/**
+ * \brief Draws a sparkline of the history as a string
+ *
+ * Each character represents the average of a bucket, picked from HISTORY_GLYPHS by
+ * assuming that samples range from 0 to 100. The latest bucket is the rightmost one
+ * and the line is padded on the left with blanks if there are less than width buckets
+ * \param [in] h The history of the metric
+ * \param [in] level The resolution whose buckets are drawn
+ * \param [out] out The buffer that holds the result (at least width + 1 characters)
+ * \param [in] width The number of buckets to draw
+ * \return Returns the number of characters written to out (not including the terminator)
+ */
+int history_sparkline(const History_t *h, int level, char *out, int width)
+{
+    int nglyphs = strlen(HISTORY_GLYPHS);
+    if (width < 0)
+    {
+        width = 0;
+    }
+    for (int i = 0; i < width; i++)
+    {
+        const struct history_bucket *b = history_get(h, level, width - 1 - i);
+        if (b == NULL)
+        {
+            out[i] = ' ';
+            continue;
+        }
+        int g = (int)((b->sum / b->count) * (nglyphs - 1) / 100 + 0.5);
+        if (g < 0)
+            g = 0;
+        if (g >= nglyphs)
+            g = nglyphs - 1;
+        out[i] = HISTORY_GLYPHS[g];
+    }
+    out[width] = '\0';
+    return width;
+}
+
+const char *history_level_name(int level)
+{
+    return (level >= 0 && level < HISTORY_LEVELS ? history_names[level] : "");
+}
+
+double history_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
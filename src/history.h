@@ -0,0 +1,52 @@
+/**
+ * \file history.h
+ * \brief Fixed-size history of a metric, kept at several time resolutions
+ */
+#ifndef HISTORY_INCLUDED
+#define HISTORY_INCLUDED
+
+// number of buckets kept at each resolution
+#define HISTORY_LEN 120
+// number of resolutions (see history_resolutions in history.c: 1s, 10s and 1 min)
+#define HISTORY_LEVELS 3
+// glyphs used to draw sparklines, from 0% to 100% in steps of 10%
+#define HISTORY_GLYPHS " _.,-:=+*#@"
+
+// summary of the samples that fall in the same time interval
+struct history_bucket
+{
+    float min;
+    float max;
+    float sum;
+    unsigned int count;
+};
+
+// the buckets of a single resolution, stored in a ring
+struct history_level
+{
+    struct history_bucket ring[HISTORY_LEN]; ///< completed buckets (the oldest are overwritten)
+    int head;                                ///< the slot that will hold the next completed bucket
+    int filled;                              ///< the number of valid slots in ring
+    struct history_bucket acc;               ///< the bucket being filled by the current samples
+    long acc_id;                             ///< the time interval covered by acc (timestamp / resolution)
+};
+
+typedef struct history_t
+{
+    struct history_level levels[HISTORY_LEVELS];
+} History_t;
+
+// resets the history to contain no samples
+void history_init(History_t *h);
+// adds the sample value taken at time now (in seconds) to every resolution in O(1)
+void history_append(History_t *h, float value, double now);
+// gets the bucket at position age (0 is the latest) of the given resolution
+const struct history_bucket *history_get(const History_t *h, int level, int age);
+// writes in out (at least width + 1 bytes) a sparkline of the latest width buckets of level
+int history_sparkline(const History_t *h, int level, char *out, int width);
+// gets the label of a resolution (such as "10s")
+const char *history_level_name(int level);
+// gets the current time (in seconds) on the clock used to timestamp samples
+double history_now(void);
+
+#endif
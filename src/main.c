@@ -6,6 +6,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <signal.h>
+#include <getopt.h>
+#include <limits.h>
 
 #include <glib.h>
 #include <pthread.h>
@@ -16,8 +18,18 @@
 #include "mem_info.h"
 #include "cpu_info.h"
 #include "process_info.h"
+#include "psi_info.h"
+#include "cgroup_info.h"
+#include "numa_info.h"
+#include "net_info.h"
 #include "update_threads.h"
 #include "windows.h"
+#include "history.h"
+#include "batch.h"
+#include "exporter.h"
+#include "record.h"
+#include "collector.h"
+#include "freeze.h"
 
 #include "main.h"
 
@@ -26,6 +38,211 @@
  */
 int main(int argc, char **argv)
 {
+    // parses the command line options
+    static const struct option long_options[] = {
+        {"cmdline-cap", required_argument, NULL, 'c'},
+        {"batch", no_argument, NULL, 'b'},
+        {"format", required_argument, NULL, 'F'},
+        {"interval", required_argument, NULL, 'd'},
+        {"count", required_argument, NULL, 'n'},
+        {"export", required_argument, NULL, 'e'},
+        {"top", required_argument, NULL, 't'},
+        {"record", required_argument, NULL, 'R'},
+        {"replay", required_argument, NULL, 'P'},
+        {"daemon", required_argument, NULL, 'D'},
+        {"attach", required_argument, NULL, 'A'},
+        {"shm-mode", required_argument, NULL, 'M'},
+        {"proc-root", required_argument, NULL, 'p'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    long cmdline_cap = CMDLINE_DISPLAY_CAP;
+    struct batch_options batch_opts = {false, BATCH_NDJSON, BATCH_INTERVAL, 0};
+    struct export_options export_opts = {NULL, EXPORT_TOPN, BATCH_INTERVAL};
+    struct record_options record_opts = {NULL, BATCH_INTERVAL, 0};
+    const char *replay_path = NULL;
+    struct collector_options collector_opts = {NULL, BATCH_INTERVAL, -1};
+    const char *attach_name = NULL;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:bF:d:n:e:t:R:P:D:A:M:p:h", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            // the number of characters of the command lines displayed (0 for no limit)
+            if (isNumber(optarg, &cmdline_cap) != 0 || cmdline_cap < 0 || cmdline_cap > INT_MAX)
+            {
+                fprintf(stderr, "Not a valid number of characters: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'b':
+            batch_opts.enabled = true;
+            break;
+        case 'F':
+            if (batch_parse_format(optarg, &batch_opts.format) == false)
+            {
+                fprintf(stderr, "Unknown format: %s (ndjson or csv)\n", optarg);
+                return 1;
+            }
+            break;
+        case 'd':
+        {
+            // the interval between two ticks of the batch mode, in seconds (fractions allowed)
+            char *end;
+            batch_opts.interval = strtod(optarg, &end);
+            if (end == optarg || *end != '\0' || !(batch_opts.interval > 0 && batch_opts.interval < 86400))
+            {
+                fprintf(stderr, "Not a valid interval: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'n':
+            // the number of ticks of the batch mode (0 to run until killed)
+            if (isNumber(optarg, &batch_opts.count) != 0 || batch_opts.count < 0)
+            {
+                fprintf(stderr, "Not a valid count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'e':
+            export_opts.address = optarg;
+            break;
+        case 't':
+            // the number of processes exported
+            if (isNumber(optarg, &export_opts.top) != 0 || export_opts.top < 0)
+            {
+                fprintf(stderr, "Not a valid number of processes: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'R':
+            record_opts.path = optarg;
+            break;
+        case 'P':
+            replay_path = optarg;
+            break;
+        case 'D':
+        case 'A':
+            // the name of the shared memory segment, which must be a single path component
+            if (*optarg == '\0' || strchr(optarg, '/') != NULL || strlen(optarg) > NAME_MAX - sizeof(SHM_PREFIX))
+            {
+                fprintf(stderr, "Not a valid collector name: %s\n", optarg);
+                return 1;
+            }
+            if (opt == 'D')
+                collector_opts.name = optarg;
+            else
+                attach_name = optarg;
+            break;
+        case 'M':
+        {
+            // the permissions of the segment of the daemon, in octal (such as 0644 to let every user attach)
+            char *end;
+            long mode = strtol(optarg, &end, 8);
+            if (end == optarg || *end != '\0' || mode < 0 || mode > 0777)
+            {
+                fprintf(stderr, "Not a valid mode: %s\n", optarg);
+                return 1;
+            }
+            collector_opts.mode = mode;
+            break;
+        }
+        case 'p':
+            // where procfs is read from (a copy of it, or the fixtures of the benchmarks)
+            if (procfs_set_root(optarg) == false)
+            {
+                fprintf(stderr, "Not a valid procfs root: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [-c|--cmdline-cap CHARS]\n"
+                    "       %s -b|--batch [-F|--format ndjson|csv] [-d|--interval SECONDS] [-n|--count N]\n"
+                    "       %s -e|--export PORT|SOCKET_PATH [-t|--top N] [-d|--interval SECONDS]\n"
+                    "       %s -R|--record FILE [-d|--interval SECONDS] [-n|--count N]\n"
+                    "       %s -P|--replay FILE\n"
+                    "       %s -D|--daemon NAME [-d|--interval SECONDS] [-M|--shm-mode MODE]\n"
+                    "       %s -A|--attach NAME\n"
+                    "Any mode reads procfs from /proc, or from the directory given by -p|--proc-root DIR\n",
+                    argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+            return (opt == 'h' ? 0 : 1);
+        }
+    }
+
+    if ((batch_opts.enabled == true) + (export_opts.address != NULL) + (record_opts.path != NULL) +
+            (replay_path != NULL) + (collector_opts.name != NULL) + (attach_name != NULL) > 1)
+    {
+        fprintf(stderr, "Only one of the batch, export, record, replay, daemon and attach modes can run at a time\n");
+        return 1;
+    }
+    // in batch mode the data is written to stdout: no menus, windows or update threads
+    if (batch_opts.enabled == true)
+    {
+        struct taskmgr_data_t batch_data;
+        init_shared_data(&batch_data, cmdline_cap);
+        batch_data.tasks->skip_smaps = true;
+        int ret = run_batch(&batch_data, &batch_opts);
+        free_shared_data(&batch_data);
+        return ret;
+    }
+    // the exporter too runs without the terminal, serving the data it collects
+    if (export_opts.address != NULL)
+    {
+        export_opts.interval = batch_opts.interval;
+        struct taskmgr_data_t export_data;
+        init_shared_data(&export_data, cmdline_cap);
+        export_data.tasks->skip_smaps = true;
+        int ret = run_exporter(&export_data, &export_opts);
+        free_shared_data(&export_data);
+        return ret;
+    }
+    // and so does the recorder, appending the data to a log for a later replay
+    if (record_opts.path != NULL)
+    {
+        record_opts.interval = batch_opts.interval;
+        record_opts.count = batch_opts.count;
+        struct taskmgr_data_t record_data;
+        init_shared_data(&record_data, cmdline_cap);
+        record_data.tasks->skip_smaps = true;
+        // a command or owner changing during the life of a process is not worth reading them at each tick
+        record_data.tasks->details_once = true;
+        int ret = run_record(&record_data, &record_opts);
+        free_shared_data(&record_data);
+        return ret;
+    }
+    // the collector daemon publishes the data for the TUIs attached to it
+    if (collector_opts.name != NULL)
+    {
+        collector_opts.interval = batch_opts.interval;
+        struct taskmgr_data_t collector_data;
+        init_shared_data(&collector_data, cmdline_cap);
+        collector_data.tasks->skip_smaps = true;
+        int ret = run_collector(&collector_data, &collector_opts);
+        free_shared_data(&collector_data);
+        return ret;
+    }
+    // the log to replay (or the daemon to attach to) is opened before the terminal is taken, to report errors
+    Replay_t *replay = NULL;
+    if (replay_path != NULL)
+    {
+        replay = replay_open(replay_path);
+        if (replay == NULL)
+        {
+            return 1;
+        }
+    }
+    Attach_t *attach = NULL;
+    if (attach_name != NULL)
+    {
+        attach = collector_attach(attach_name);
+        if (attach == NULL)
+        {
+            return 1;
+        }
+    }
+
     // loads menus descriptions from the json file menus.json
     json_error_t err;
     json_t *menus_descr = json_load_file(JSON_MENUFILE, 0, &err);
@@ -86,13 +303,17 @@ int main(int argc, char **argv)
         i++;
     }
     // initialize the array of function pointers with all the modes defined in process_info.h
-    int (**sorting_modes)(const void *, const void *) = malloc(sortmenu_sz * sizeof(*sorting_modes));
+    int (**sorting_modes)(const void *, const void *, void *) = malloc(sortmenu_sz * sizeof(*sorting_modes));
     sorting_modes[0] = cmp_commands;
     sorting_modes[1] = cmp_usernames;
     sorting_modes[2] = cmp_pid_incr;
     sorting_modes[3] = cmp_pid_decr;
     sorting_modes[4] = cmp_nthreads_inc;
     sorting_modes[5] = cmp_nthreads_decr;
+    sorting_modes[6] = cmp_io_write_decr;
+    sorting_modes[7] = cmp_pss_decr;
+    sorting_modes[8] = cmp_fds_decr;
+    sorting_modes[9] = cmp_conns_decr;
 
     // creates a timer that generates SIGALRM each interval
     // this timer is used to periodically refresh the windows displaying data
@@ -105,42 +326,35 @@ int main(int argc, char **argv)
     pthread_sigmask(SIG_BLOCK, &masked_sigs, NULL);
 
     struct taskmgr_data_t shared_data;
-    // scaling is activated by default
-    shared_data.rawdata = 1;
-
-    // Initialize the memory data structure
-    shared_data.mem_stats = calloc(1, sizeof(Mem_data_t));
-    pthread_mutex_init(&(shared_data.mem_stats->mux_memdata), NULL);
-    pthread_cond_init(&(shared_data.mem_stats->cond_updating), NULL);
-
-    // Does the same for CPU
-    shared_data.cpu_stats = calloc(1, sizeof(CPU_data_t));
-    // sets the number of cores and the model of the CPU just once at startup, since that's unlikely to change
-    get_cpu_model(&(shared_data.cpu_stats->model), &(shared_data.cpu_stats->num_cores));
-    // initialize the per-core statistics array
-    shared_data.cpu_stats->percore = calloc(shared_data.cpu_stats->num_cores, sizeof(struct core_data_t));
-    pthread_mutex_init(&(shared_data.cpu_stats->mux_memdata), NULL);
-    pthread_cond_init(&(shared_data.cpu_stats->cond_updating), NULL);
-
-    // And for processes
-    shared_data.tasks = calloc(1, sizeof(TaskList));
-    shared_data.tasks->ps = g_array_new(false, false, sizeof(Task));
-    g_array_set_clear_func(shared_data.tasks->ps, clear_task);
-    shared_data.tasks->num_ps = 0;
-    shared_data.tasks->num_threads = 0;
-    // default process sorting criteria: lexicographical order of command lines
-    shared_data.tasks->sortfun = cmp_commands;
-    shared_data.tasks->cursor_start = 0; // the cursor starts at the first process
-    pthread_mutex_init(&shared_data.tasks->mux_memdata, NULL);
-    pthread_cond_init(&shared_data.tasks->cond_updating, NULL);
+    init_shared_data(&shared_data, cmdline_cap);
+    shared_data.refresh_timer = alarm;
+    shared_data.replay = replay;
+    shared_data.attach = attach;
 
     // creates the threads that handle data update
-    pthread_t update_th[4];
+    pthread_t update_th[6];
     pthread_create(&update_th[0], NULL, signal_thread, &shared_data);
-    pthread_create(&update_th[1], NULL, update_mem, shared_data.mem_stats);
-    pthread_create(&update_th[2], NULL, update_cpu, shared_data.cpu_stats);
-    // this thread needs data from the memory and the CPU
-    pthread_create(&update_th[3], NULL, update_proc, &shared_data);
+    if (replay != NULL)
+    {
+        // the data comes from the recording: the replay thread replaces the update threads
+        pthread_create(&update_th[1], NULL, replay_thread, &shared_data);
+    }
+    else if (attach != NULL)
+    {
+        // and the attach thread when the data comes from a collector daemon
+        pthread_create(&update_th[1], NULL, attach_thread, &shared_data);
+    }
+    else
+    {
+        pthread_create(&update_th[1], NULL, update_mem, shared_data.mem_stats);
+        pthread_create(&update_th[2], NULL, update_cpu, shared_data.cpu_stats);
+        // this thread needs data from the memory and the CPU
+        pthread_create(&update_th[3], NULL, update_proc, &shared_data);
+        // this one needs the refresh timer as well
+        pthread_create(&update_th[4], NULL, update_psi, &shared_data);
+        // this one needs the per-core statistics
+        pthread_create(&update_th[5], NULL, update_numa, &shared_data);
+    }
 
     // inititalize ncurses with some useful additions
     initscr();
@@ -154,11 +368,17 @@ int main(int argc, char **argv)
     // define a green on black color pair
     short green_on_black = 1;
     init_pair(green_on_black, COLOR_GREEN, COLOR_BLACK);
+    // and those of the cells of the compact cpu grid
+    init_pair(CPU_HEAT_LOW_PAIR, COLOR_GREEN, COLOR_BLACK);
+    init_pair(CPU_HEAT_MID_PAIR, COLOR_YELLOW, COLOR_BLACK);
+    init_pair(CPU_HEAT_HIGH_PAIR, COLOR_RED, COLOR_BLACK);
 
     // create three indipendent windows to handle memory, cpu and process display
-    // The first two occupy each a quarter of the screen, while the third fills the rest
+    // The first two occupy each a quarter of the screen, while the third fills the rest.
+    // The pressure line takes the first row of the cpu's quarter, between memory and cpu
     shared_data.memwin = newwin(LINES / 4, COLS, 0, 0);
-    shared_data.cpuwin = newwin(LINES / 4, COLS, LINES / 4, 0);
+    shared_data.psiwin = newwin(1, COLS, LINES / 4, 0);
+    shared_data.cpuwin = newwin(LINES / 4 - 1, COLS, LINES / 4 + 1, 0);
     shared_data.procwin = newwin(LINES / 2, COLS, LINES / 2 - 1, 0);
 
     // declare the timer interval and starting offset
@@ -210,8 +430,15 @@ int main(int argc, char **argv)
             }
             break;
         }
-        case 'i':
-            // unimplemented
+        case 'i': // freezes/unfreezes the process list (the data is still collected)
+            freeze_toggle(shared_data.freeze);
+            shared_data.tasks->cursor_start = 0;
+            kill(getpid(), SIGALRM);
+            break;
+        case 'u': // shows/hides the differences between the frozen list and the live one
+            freeze_toggle_diff(shared_data.freeze);
+            shared_data.tasks->cursor_start = 0;
+            kill(getpid(), SIGALRM);
             break;
         case 'f':
         {
@@ -220,7 +447,7 @@ int main(int argc, char **argv)
                 // 'f' was pressed to quit the search view: reset all highlighted processes to normal
                 for (int i = 0; i < shared_data.tasks->num_ps; i++)
                 {
-                    Task *t = &g_array_index(shared_data.tasks->ps, Task, i);
+                    Task *t = task_at(shared_data.tasks, i);
                     if (t->highlight == true)
                     {
                         t->highlight = false;
@@ -257,6 +484,54 @@ int main(int argc, char **argv)
                 shared_data.rawdata = 0;
             }
             break;
+        case 'g': // shows/hides the processes grouped by cgroup
+            shared_data.tasks->group_by_cgroup = (shared_data.tasks->group_by_cgroup == true ? false : true);
+            shared_data.tasks->cursor_start = 0;
+            break;
+        case 'o': // shows/hides the I/O rates of the processes
+            shared_data.tasks->show_io = (shared_data.tasks->show_io == true ? false : true);
+            break;
+        case 'd': // shows/hides the number of open file descriptors of the processes
+            shared_data.tasks->show_fds = (shared_data.tasks->show_fds == true ? false : true);
+            break;
+        case 'l': // lists the open files of the process under the cursor
+            // the windows are not refreshed while the list is displayed
+            stop_timer(alarm, &spec);
+            show_open_fds(shared_data.tasks);
+            timer_settime(alarm, 0, &spec, NULL);
+            // redraw the windows immediately
+            kill(getpid(), SIGALRM);
+            break;
+        case 'c': // shows/hides the number of sockets of the processes
+            shared_data.tasks->show_conns = (shared_data.tasks->show_conns == true ? false : true);
+            break;
+        case 'w': // lists the sockets of the process under the cursor
+            stop_timer(alarm, &spec);
+            show_sockets(shared_data.tasks);
+            timer_settime(alarm, 0, &spec, NULL);
+            kill(getpid(), SIGALRM);
+            break;
+        case 'p': // finds the processes listening on a port
+            stop_timer(alarm, &spec);
+            find_port_listeners();
+            timer_settime(alarm, 0, &spec, NULL);
+            kill(getpid(), SIGALRM);
+            break;
+        case 'z': // switches between refreshing every process and only those in view
+            shared_data.tasks->viewport_scan = (shared_data.tasks->viewport_scan == true ? false : true);
+            break;
+        case 'n': // shows/hides the cores grouped by NUMA node
+            shared_data.show_numa = (shared_data.show_numa == true ? false : true);
+            break;
+        case 'v': // shows/hides the paging rates
+            shared_data.show_vmstat = (shared_data.show_vmstat == true ? false : true);
+            break;
+        case 'x': // shows/hides the other fields of /proc/meminfo
+            shared_data.show_meminfo = (shared_data.show_meminfo == true ? false : true);
+            break;
+        case 't': // cycles through the resolutions of the sparklines
+            shared_data.history_level = (shared_data.history_level + 1) % HISTORY_LEVELS;
+            break;
         // TODO: experimental
         case 'k': // kill a process
             if (killing == true)
@@ -359,6 +634,31 @@ int main(int argc, char **argv)
             wrefresh(shared_data.procwin);
             break;
         }
+        // the commands of the replay
+        case ' ': // pauses or resumes the replay
+            if (replay != NULL)
+            {
+                replay_toggle_pause(replay);
+                kill(getpid(), SIGALRM);
+            }
+            break;
+        case '[': // halves the replay speed
+        case ']': // doubles it
+            if (replay != NULL)
+            {
+                replay_change_speed(replay, (key == ']' ? 2.0 : 0.5));
+                kill(getpid(), SIGALRM);
+            }
+            break;
+        case '<': // moves the replay back
+        case KEY_LEFT:
+        case '>': // and forward
+        case KEY_RIGHT:
+            if (replay != NULL)
+            {
+                replay_seek(replay, ((key == '<' || key == KEY_LEFT) ? -REC_SEEK_STEP : REC_SEEK_STEP));
+            }
+            break;
         }
 
         // if both the last pressed key and the current are scrolling keys (one of those listed above)
@@ -403,21 +703,30 @@ int main(int argc, char **argv)
     free(menus_descr); // the json_t object used to load the menu
     // frees the sorting modes array
     free(sorting_modes);
+    // the replay thread must stop before the data it writes is freed
+    if (replay != NULL)
+    {
+        pthread_mutex_lock(&replay->mux_memdata);
+        replay->stop = true;
+        pthread_cond_signal(&replay->cond_updating);
+        pthread_mutex_unlock(&replay->mux_memdata);
+        pthread_join(update_th[1], NULL);
+        replay_close(replay);
+    }
+    if (attach != NULL)
+    {
+        collector_stop(attach);
+        pthread_join(update_th[1], NULL);
+        collector_detach(attach);
+    }
     // deletes the alarm timer
     timer_delete(alarm);
     // frees the memory, cpu and process data structures
-    free(shared_data.mem_stats);
-    if (shared_data.cpu_stats->model)
-        free(shared_data.cpu_stats->model);
-    free(shared_data.cpu_stats->percore);
-    free(shared_data.cpu_stats);
-    if (shared_data.tasks->ps)
-        g_array_free(shared_data.tasks->ps, true); // frees data stored inside as well
-    shared_data.tasks->sortfun = NULL;
-    free(shared_data.tasks);
+    free_shared_data(&shared_data);
     // deletes all the WINDOWs and end ncurses mode
     delwin(shared_data.memwin);
     delwin(shared_data.cpuwin);
+    delwin(shared_data.psiwin);
     delwin(shared_data.procwin);
     endwin();
 
@@ -8,42 +8,72 @@
 #include <ncurses.h>
 #include <time.h>
 
-// forward declarations to avoid circular dependencies with the headers where these types are defined
-typedef struct mem_data_t Mem_data_t;
-typedef struct cpu_data_t CPU_data_t;
-typedef struct tasklist TaskList;
+#include "common.h"
+
+// forward declarations of the types of the replay and attach modes
+typedef struct replay_t Replay_t;
+typedef struct attach_t Attach_t;
+// and of the freeze mode
+typedef struct freeze_t Freeze_t;
 
 // json menu description file path
 #define JSON_MENUFILE "menus.json"
-// base buffer size
-#define BUF_BASESZ 128
 
 struct taskmgr_data_t {
     // windows displaying data fetched
     WINDOW *memwin;
     WINDOW *cpuwin;
     WINDOW *procwin;
+    WINDOW *psiwin;
     // data structures holding data to be displayed
     Mem_data_t *mem_stats;
     CPU_data_t *cpu_stats;
     TaskList *tasks;
+    PSI_data_t *psi_stats;
+    NUMA_data_t *numa_stats;
+    // the timer that triggers the refresh of windows
+    timer_t refresh_timer;
     // flag to be set to display raw data reads, instead of scaled ones
     int rawdata;
+    // the resolution of the history shown by sparklines (see history.h)
+    int history_level;
+    // flag set to display every field of /proc/meminfo in the memory window
+    bool show_meminfo;
+    // flag set to display the cores grouped by NUMA node in the cpu window
+    bool show_numa;
+    // flag set to display the paging rates of /proc/vmstat in the memory window
+    bool show_vmstat;
+    // the recording shown instead of the data of /proc (NULL if not replaying)
+    Replay_t *replay;
+    // the collector daemon whose snapshots are shown instead of the data of /proc (NULL if not attached)
+    Attach_t *attach;
+    // the frozen process list and the snapshots it's compared with (see freeze.h)
+    Freeze_t *freeze;
 };
 
+// allocates and initializes the data structures filled by the collectors (see shared_data.c)
+void init_shared_data(struct taskmgr_data_t *sd, long cmdline_cap);
+// closes the files and frees the data structures allocated by init_shared_data()
+void free_shared_data(struct taskmgr_data_t *sd);
+
 // Utility functions: see utilities.c
 
 // stops the given timer and saves the settings in oldval
 void stop_timer(timer_t timerid, struct itimerspec *oldval);
 // prints the menu with supplied keybindings, items and descriptions
 int print_menu(int *keybinds, char **items, char **descriptions, const int nitems);
-int isNumber(const char* s, long* n);
 // reads a pattern from the window win at the location supplied with a prompt
 char* read_pattern(WINDOW *win, const int row, const int col, const char *prompt);
 // read and find a pattern in the tasklist
 void find_pattern(TaskList *tasks);
 // read the PID and try to kill a process in the tasklist
 void kill_process(TaskList *tasks);
+// show the open files of the process under the cursor
+void show_open_fds(TaskList *tasks);
+// show the sockets of the process under the cursor
+void show_sockets(TaskList *tasks);
+// read a port and show the processes listening on it
+void find_port_listeners(void);
 
 // thread handling signals
 void *signal_thread(void *param);
@@ -1,48 +1,215 @@
+/**
+ * \file mem_info.c
+ * \brief File containing functions that query the system for updated memory information
+ */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "mem_info.h"
+#include "history.h"
 
-// gets statistics about the memory usage
-// see man 5 proc at section "/proc/meminfo"
+// the table mapping the names of the fields used by the summary to their keys
+static const char *meminfo_keys[MEMINFO_NKEYS] = {
+    [MEMINFO_MEMTOTAL] = "MemTotal",
+    [MEMINFO_MEMFREE] = "MemFree",
+    [MEMINFO_MEMAVAILABLE] = "MemAvailable",
+    [MEMINFO_BUFFERS] = "Buffers",
+    [MEMINFO_CACHED] = "Cached",
+    [MEMINFO_SWAPTOTAL] = "SwapTotal",
+    [MEMINFO_SWAPFREE] = "SwapFree",
+};
+
+// looks up the key of a field's name in the table above: returns -1 if it's not there
+static int meminfo_key_lookup(const char *name, int len)
+{
+    for (int k = 0; k < MEMINFO_NKEYS; k++)
+    {
+        if (strncmp(meminfo_keys[k], name, len) == 0 && meminfo_keys[k][len] == '\0')
+        {
+            return k;
+        }
+    }
+    return -1;
+}
+
+Mem_data_t *mem_data_new(void)
+{
+    Mem_data_t *mem = calloc(1, sizeof(Mem_data_t));
+    if (mem == NULL)
+    {
+        return NULL;
+    }
+    history_init(&mem->ram_hist);
+    history_init(&mem->swp_hist);
+    pthread_mutex_init(&mem->mux_memdata, NULL);
+    pthread_cond_init(&mem->cond_updating, NULL);
+    return mem;
+}
+
+void mem_data_free(Mem_data_t *mem)
+{
+    procfile_close(&mem->stat_file);
+    procfile_close(&mem->vmstat_file);
+    free(mem);
+}
+
+/**
+ * \brief Gets statistics about the memory usage
+ *
+ * Reads /proc/meminfo (see man 5 proc) in a single pass, storing every field in the
+ * order it appears in the file. Since the kernel always lists the fields in the same
+ * order, the layout is learned on the first read: the following reads only compare
+ * the name of each line with the one at the same position and store its value.
+ * The name table is rebuilt only if a line doesn't match (which shouldn't happen)
+ * \param [in,out] mem_usage The memory statistics to be updated
+ * \return Returns true iff /proc/meminfo was read successfully
+ */
 bool get_mem_info(Mem_data_t *mem_usage)
 {
+    char path[BUF_BASESZ];
+    procfs_path(path, BUF_BASESZ, MEM_STATFILE);
+    if (procfile_read(&mem_usage->stat_file, path) == false)
+    {
+        return false;
+    }
+    unsigned long summary[MEMINFO_NKEYS] = {0};
+    int nfields = 0;
+    const char *line = mem_usage->stat_file.buf;
+    while (*line != '\0' && nfields < MEMINFO_MAXFIELDS)
+    {
+        const char *colon = strchr(line, ':');
+        if (colon == NULL)
+        {
+            break;
+        }
+        // a name longer than the field holds is stored, and compared, up to MEMINFO_NAMELEN - 1 characters
+        int len = colon - line;
+        if (len >= MEMINFO_NAMELEN)
+        {
+            len = MEMINFO_NAMELEN - 1;
+        }
+        struct meminfo_field *field = &mem_usage->fields[nfields];
+        // if the line doesn't match the learned layout, learn its name and key
+        if (nfields >= mem_usage->num_fields || field->name_len != len || memcmp(field->name, line, len) != 0)
+        {
+            memcpy(field->name, line, len);
+            field->name[len] = '\0';
+            field->name_len = len;
+            field->key = meminfo_key_lookup(line, colon - line);
+        }
+        const char *p = colon + 1;
+        field->value = parse_ull(&p);
+        field->in_kb = (strncmp(p, " kB", 3) == 0);
+        if (field->key >= 0)
+        {
+            summary[field->key] = field->value;
+        }
+        nfields++;
+        line = next_line(p);
+    }
+    mem_usage->num_fields = nfields;
+
+    if (summary[MEMINFO_MEMAVAILABLE] == 0)
+    {
+        // older kernels don't report MemAvailable: estimate it
+        summary[MEMINFO_MEMAVAILABLE] = summary[MEMINFO_MEMFREE] + summary[MEMINFO_BUFFERS] + summary[MEMINFO_CACHED];
+    }
+    mem_usage->total_mem = summary[MEMINFO_MEMTOTAL];
+    mem_usage->free_mem = summary[MEMINFO_MEMFREE];
+    mem_usage->avail_mem = summary[MEMINFO_MEMAVAILABLE];
+    mem_usage->buffer_cached = summary[MEMINFO_BUFFERS] + summary[MEMINFO_CACHED];
+    mem_usage->swp_tot = summary[MEMINFO_SWAPTOTAL];
+    mem_usage->swp_free = summary[MEMINFO_SWAPFREE];
+    return true;
+}
 
-    // temp local variables
-    unsigned long mtot = 0;
-    unsigned long mfree = 0;
-    unsigned long mavail = 0;
-    unsigned long mbuffer = 0;
-    unsigned long mcached = 0;
-    unsigned long mswp_tot = 0;
-    unsigned long mswp_free = 0;
+// looks up the key of a line of /proc/vmstat: returns -1 if its rate is not displayed
+static int vmstat_key_lookup(const char *name, int len)
+{
+    static const struct
+    {
+        const char *name;
+        int key;
+        bool prefix; ///< true if the name is followed by a zone (older kernels) or by nothing
+    } keys[] = {
+        {"pgfault", VMSTAT_PGFAULT, false},
+        {"pgmajfault", VMSTAT_PGMAJFAULT, false},
+        {"pswpin", VMSTAT_PSWPIN, false},
+        {"pswpout", VMSTAT_PSWPOUT, false},
+        {"pgscan_kswapd", VMSTAT_PGSCAN, true},
+        {"pgscan_direct", VMSTAT_PGSCAN, true},
+        {"pgscan_khugepaged", VMSTAT_PGSCAN, false},
+        {"pgscan_proactive", VMSTAT_PGSCAN, false},
+    };
+    // pgscan_direct_throttle counts throttling events, not pages
+    if (len == 22 && strncmp(name, "pgscan_direct_throttle", len) == 0)
+    {
+        return -1;
+    }
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++)
+    {
+        int klen = strlen(keys[k].name);
+        if ((len == klen || (keys[k].prefix == true && len > klen && name[klen] == '_')) &&
+            strncmp(keys[k].name, name, klen) == 0)
+        {
+            return keys[k].key;
+        }
+    }
+    return -1;
+}
 
-    FILE *stat_file = NULL;
-    char *buf = malloc(BUF_BASESZ);
-    unsigned long bufsz = BUF_BASESZ;
-    if ((stat_file = fopen(MEM_STATFILE, "r")) && buf)
+/**
+ * \brief Gets the paging counters of /proc/vmstat
+ *
+ * Reads /proc/vmstat through the same persistent file descriptor and in-place parser
+ * used for /proc/stat and /proc/meminfo. As for the latter, the layout is learned on
+ * the first read: the following reads look the key of a line up again only if the length
+ * of its name changed, or if the line is one of the few that are displayed.
+ * The rate of each counter is then given by counter_rate()
+ * \param [in,out] mem_usage The memory statistics to be updated
+ * \return Returns true iff /proc/vmstat was read successfully
+ */
+bool get_vmstat_info(Mem_data_t *mem_usage)
+{
+    char path[BUF_BASESZ];
+    procfs_path(path, BUF_BASESZ, VMSTAT_FILE);
+    if (procfile_read(&mem_usage->vmstat_file, path) == false)
     {
-        while (fgets(buf, bufsz, stat_file))
+        return false;
+    }
+    double now = history_now();
+    unsigned long long values[VMSTAT_NKEYS] = {0};
+    int nfields = 0;
+    const char *line = mem_usage->vmstat_file.buf;
+    while (*line != '\0' && nfields < VMSTAT_MAXFIELDS)
+    {
+        const char *space = strchr(line, ' ');
+        if (space == NULL)
+        {
+            break;
+        }
+        int len = space - line;
+        if (nfields >= mem_usage->vmstat_nfields || mem_usage->vmstat_namelen[nfields] != len ||
+            mem_usage->vmstat_keys[nfields] >= 0)
         {
-            sscanf(buf, "MemTotal:%*[^0-9]%lu", &mtot);
-            sscanf(buf, "MemFree:%*[^0-9]%lu", &mfree);
-            sscanf(buf, "MemAvailable:%*[^0-9]%lu", &mavail);
-            sscanf(buf, "Buffers:%*[^0-9]%lu", &mbuffer);
-            sscanf(buf, "Cached:%*[^0-9]%lu", &mcached);
-            sscanf(buf, "SwapTotal:%*[^0-9]%lu", &mswp_tot);
-            sscanf(buf, "SwapFree:%*[^0-9]%lu", &mswp_free);
+            mem_usage->vmstat_namelen[nfields] = len;
+            mem_usage->vmstat_keys[nfields] = vmstat_key_lookup(line, len);
         }
-        if (mavail == 0)
+        const char *p = space;
+        int key = mem_usage->vmstat_keys[nfields];
+        if (key >= 0)
         {
-            mavail = mfree + mbuffer + mcached;
+            values[key] += parse_ull(&p);
         }
+        nfields++;
+        line = next_line(p);
+    }
+    mem_usage->vmstat_nfields = nfields;
 
-        mem_usage->total_mem = mtot;
-        mem_usage->free_mem = mfree;
-        mem_usage->avail_mem = mavail;
-        mem_usage->buffer_cached = mbuffer + mcached;
-        mem_usage->swp_tot = mswp_tot;
-        mem_usage->swp_free = mswp_free;
+    for (int k = 0; k < VMSTAT_NKEYS; k++)
+    {
+        counter_update(&mem_usage->vmstat[k], values[k], now);
     }
-    return (stat_file && buf ? true : false);
+    return true;
 }
@@ -7,9 +7,53 @@
 
 #include <pthread.h>
 
-#include "main.h"
+#include "common.h"
+#include "history.h"
+#include "procfile.h"
 
-#define MEM_STATFILE "/proc/meminfo"
+// the files read, relative to the root of procfs (see procfs_path())
+#define MEM_STATFILE "meminfo"
+// maximum number of fields read from /proc/meminfo (current kernels have about 60)
+#define MEMINFO_MAXFIELDS 128
+// maximum length of a field's name (the longest ones are about 20 characters)
+#define MEMINFO_NAMELEN 32
+#define VMSTAT_FILE "vmstat"
+// maximum number of lines read from /proc/vmstat (current kernels have about 180)
+#define VMSTAT_MAXFIELDS 256
+
+// the fields of /proc/meminfo used by the summary, looked up in the table of mem_info.c
+enum meminfo_key
+{
+    MEMINFO_MEMTOTAL,
+    MEMINFO_MEMFREE,
+    MEMINFO_MEMAVAILABLE,
+    MEMINFO_BUFFERS,
+    MEMINFO_CACHED,
+    MEMINFO_SWAPTOTAL,
+    MEMINFO_SWAPFREE,
+    MEMINFO_NKEYS
+};
+
+// the counters of /proc/vmstat whose rates are displayed, looked up in the table of mem_info.c
+enum vmstat_key
+{
+    VMSTAT_PGFAULT,
+    VMSTAT_PGMAJFAULT,
+    VMSTAT_PSWPIN,
+    VMSTAT_PSWPOUT,
+    VMSTAT_PGSCAN, ///< the sum of the pages scanned by kswapd, by direct and proactive reclaim and by khugepaged
+    VMSTAT_NKEYS
+};
+
+// a line of /proc/meminfo
+struct meminfo_field
+{
+    char name[MEMINFO_NAMELEN]; ///< the field's name (without the colon)
+    int name_len;               ///< the length of name (truncated with it)
+    int key;                    ///< the field's enum meminfo_key, or -1 if it's not in the summary
+    bool in_kb;                 ///< false for fields that are counts (such as HugePages_Total)
+    unsigned long value;
+};
 
 typedef struct mem_data_t
 {
@@ -19,12 +63,27 @@ typedef struct mem_data_t
     unsigned long buffer_cached;
     unsigned long swp_tot;
     unsigned long swp_free;
+    History_t ram_hist; ///< history of the percentage of memory in use
+    History_t swp_hist; ///< history of the percentage of swap in use
+    struct meminfo_field fields[MEMINFO_MAXFIELDS]; ///< every field of /proc/meminfo, in the file's order
+    int num_fields;                                 ///< the number of valid entries in fields
+    Procfile_t stat_file;                           ///< /proc/meminfo, kept open across reads
+    struct counter vmstat[VMSTAT_NKEYS];            ///< the paging counters of /proc/vmstat
+    short vmstat_namelen[VMSTAT_MAXFIELDS];         ///< the length of the name of each line of /proc/vmstat
+    signed char vmstat_keys[VMSTAT_MAXFIELDS];      ///< the enum vmstat_key of each line, or -1
+    int vmstat_nfields;                             ///< the number of lines of /proc/vmstat learned
+    Procfile_t vmstat_file;                         ///< /proc/vmstat, kept open across reads
     // syncronization variables
     pthread_mutex_t mux_memdata;
     pthread_cond_t cond_updating;
     bool is_busy;
 } Mem_data_t;
 
+// allocates the memory statistics, with their histories and locks
+Mem_data_t *mem_data_new(void);
+// closes the files of the memory statistics and frees them
+void mem_data_free(Mem_data_t *mem);
 bool get_mem_info(Mem_data_t *mem_usage);
+bool get_vmstat_info(Mem_data_t *mem_usage);
 
 #endif
@@ -0,0 +1,428 @@
+/**
+ * \file net_info.c
+ * \brief Joins the sockets listed in /proc/net with the processes that own them
+ *
+ * The sockets of the TCP and UDP tables are identified by inode, the same number found in
+ * the links socket:[inode] in /proc/[pid]/fd. The tables are read once per refresh into an
+ * array indexed by a hash table on the inode, so that each link of each process is looked
+ * up in constant time instead of being compared with every socket.
+ *
+ * The tables are dumped through sock_diag, as ss does, whenever procfs is the real one:
+ * the kernel generates the files in /proc/net a page per read and walks its table of
+ * sockets again from the start at each page, so reading them takes time quadratic in the
+ * number of sockets (half a minute with 100k sockets), while a dump is linear. The files
+ * are read instead if sock_diag is not available for a table (or procfs is a fake tree)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+
+#include "net_info.h"
+#include "process_info.h"
+
+static const char *net_files[NET_NPROTOS] = {
+    [NET_TCP] = NET_TCP_FILE,
+    [NET_TCP6] = NET_TCP6_FILE,
+    [NET_UDP] = NET_UDP_FILE,
+    [NET_UDP6] = NET_UDP6_FILE,
+};
+
+void net_init(Net_data_t *net)
+{
+    for (int f = 0; f < NET_NPROTOS; f++)
+    {
+        net->files[f].fd = -1;
+        net->files[f].buf = NULL;
+    }
+    net->diag_fd = -1;
+    net->diag_buf = NULL;
+    net->sockets = g_array_new(false, false, sizeof(struct socket_entry));
+    net->by_inode = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+void net_close(Net_data_t *net)
+{
+    for (int f = 0; f < NET_NPROTOS; f++)
+    {
+        procfile_close(&net->files[f]);
+    }
+    if (net->diag_fd != -1)
+    {
+        close(net->diag_fd);
+    }
+    free(net->diag_buf);
+    g_array_free(net->sockets, true);
+    g_hash_table_destroy(net->by_inode);
+}
+
+// parses a hexadecimal number of at most maxdigits digits at *p and advances *p past it
+static unsigned long parse_hex(const char **p, int maxdigits)
+{
+    const char *s = *p;
+    unsigned long val = 0;
+    for (int d = 0; d < maxdigits; d++, s++)
+    {
+        if (*s >= '0' && *s <= '9')
+            val = (val << 4) | (*s - '0');
+        else if (*s >= 'A' && *s <= 'F')
+            val = (val << 4) | (*s - 'A' + 10);
+        else if (*s >= 'a' && *s <= 'f')
+            val = (val << 4) | (*s - 'a' + 10);
+        else
+            break;
+    }
+    *p = s;
+    return val;
+}
+
+// parses an address:port pair of a socket table: the address is printed as words of
+// 32 bits in host byte order, so copying each word yields the address in network byte order
+static void parse_addr(const char **p, unsigned char *addr, int nwords, unsigned short *port)
+{
+    while (**p == ' ')
+    {
+        (*p)++;
+    }
+    for (int w = 0; w < nwords; w++)
+    {
+        uint32_t word = parse_hex(p, 8);
+        memcpy(addr + 4 * w, &word, 4);
+    }
+    if (**p == ':')
+    {
+        (*p)++;
+    }
+    *port = parse_hex(p, 4);
+}
+
+// skips the blanks at *p and then the field following them
+static void skip_field(const char **p)
+{
+    while (**p == ' ')
+    {
+        (*p)++;
+    }
+    while (**p != ' ' && **p != '\n' && **p != '\0')
+    {
+        (*p)++;
+    }
+}
+
+// appends a socket to the array and indexes it (sockets without an inode, such as those
+// in TIME_WAIT, belong to no process and are skipped)
+static void add_socket(Net_data_t *net, const struct socket_entry *s)
+{
+    if (s->inode != 0)
+    {
+        g_array_append_val(net->sockets, *s);
+        g_hash_table_insert(net->by_inode, GSIZE_TO_POINTER(s->inode), GSIZE_TO_POINTER(net->sockets->len));
+    }
+}
+
+// removes the sockets appended after the first len ones
+static void drop_sockets(Net_data_t *net, guint len)
+{
+    for (guint i = len; i < net->sockets->len; i++)
+    {
+        g_hash_table_remove(net->by_inode, GSIZE_TO_POINTER(g_array_index(net->sockets, struct socket_entry, i).inode));
+    }
+    g_array_set_size(net->sockets, len);
+}
+
+/**
+ * \brief Dumps a socket table through sock_diag
+ *
+ * The netlink socket and its buffer are opened on the first dump and kept open.
+ * If the dump fails (for example because the kernel has no module for the UDP
+ * tables), the sockets already received are dropped and the socket is closed,
+ * so that it is opened again by the next dump
+ * \param [in,out] net The sockets, to which those of the table are appended
+ * \param [in] proto The table (enum net_proto)
+ * \return Returns true iff the whole table was received
+ */
+static bool dump_sockets(Net_data_t *net, int proto)
+{
+    if (net->diag_fd == -1)
+    {
+        net->diag_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+        if (net->diag_fd == -1)
+        {
+            return false;
+        }
+        if (net->diag_buf == NULL)
+        {
+            net->diag_buf = malloc(NET_DIAG_BUFSZ);
+        }
+    }
+    struct
+    {
+        struct nlmsghdr nlh;
+        struct inet_diag_req_v2 req;
+    } msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.nlh.nlmsg_len = sizeof(msg);
+    msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    bool ipv6 = (proto == NET_TCP6 || proto == NET_UDP6);
+    msg.req.sdiag_family = (ipv6 ? AF_INET6 : AF_INET);
+    msg.req.sdiag_protocol = (proto == NET_TCP || proto == NET_TCP6 ? IPPROTO_TCP : IPPROTO_UDP);
+    // every state, as in /proc/net
+    msg.req.idiag_states = ~0U;
+    struct sockaddr_nl kernel = {.nl_family = AF_NETLINK};
+    guint len = net->sockets->len;
+    if (net->diag_buf != NULL &&
+        sendto(net->diag_fd, &msg, sizeof(msg), 0, (struct sockaddr *)&kernel, sizeof(kernel)) == sizeof(msg))
+    {
+        while (true)
+        {
+            ssize_t nread = recv(net->diag_fd, net->diag_buf, NET_DIAG_BUFSZ, 0);
+            if (nread < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (nread <= 0)
+            {
+                break;
+            }
+            int left = nread;
+            for (struct nlmsghdr *h = (struct nlmsghdr *)net->diag_buf; NLMSG_OK(h, left); h = NLMSG_NEXT(h, left))
+            {
+                if (h->nlmsg_type == NLMSG_DONE)
+                {
+                    return true;
+                }
+                if (h->nlmsg_type != SOCK_DIAG_BY_FAMILY)
+                {
+                    // NLMSG_ERROR, the only other reply to a dump
+                    goto failed;
+                }
+                const struct inet_diag_msg *d = NLMSG_DATA(h);
+                struct socket_entry s;
+                memset(&s, 0, sizeof(s));
+                s.inode = d->idiag_inode;
+                s.proto = proto;
+                // the addresses are in network byte order, as in the array
+                memcpy(s.local, d->id.idiag_src, (ipv6 ? 16 : 4));
+                memcpy(s.remote, d->id.idiag_dst, (ipv6 ? 16 : 4));
+                s.local_port = ntohs(d->id.idiag_sport);
+                s.remote_port = ntohs(d->id.idiag_dport);
+                s.state = d->idiag_state;
+                add_socket(net, &s);
+            }
+        }
+    }
+failed:
+    drop_sockets(net, len);
+    close(net->diag_fd);
+    net->diag_fd = -1;
+    return false;
+}
+
+// parses a socket table of /proc/net
+static bool read_sockets(Net_data_t *net, int proto)
+{
+    char path[BUF_BASESZ];
+    procfs_path(path, BUF_BASESZ, "%s", net_files[proto]);
+    // the IPv6 tables are missing if IPv6 is disabled
+    if (procfile_read_all(&net->files[proto], path) == false)
+    {
+        return false;
+    }
+    int nwords = (proto == NET_TCP6 || proto == NET_UDP6 ? 4 : 1);
+    // the first line is the header
+    const char *line = next_line(net->files[proto].buf);
+    while (*line != '\0')
+    {
+        struct socket_entry s;
+        memset(&s, 0, sizeof(s));
+        s.proto = proto;
+        const char *p = strchr(line, ':');
+        if (p == NULL)
+        {
+            break;
+        }
+        p++;
+        parse_addr(&p, s.local, nwords, &s.local_port);
+        parse_addr(&p, s.remote, nwords, &s.remote_port);
+        while (*p == ' ')
+        {
+            p++;
+        }
+        s.state = parse_hex(&p, 2);
+        // skip tx_queue:rx_queue, tr:tm->when, retrnsmt, uid and timeout
+        for (int i = 0; i < 5; i++)
+        {
+            skip_field(&p);
+        }
+        s.inode = parse_ull(&p);
+        add_socket(net, &s);
+        line = next_line(p);
+    }
+    return true;
+}
+
+/**
+ * \brief Reads the TCP and UDP socket tables and indexes their sockets by inode
+ *
+ * The array of sockets and its index are emptied and filled again without being
+ * freed, so that they only grow with the number of sockets. Each table is dumped
+ * through sock_diag if procfs is the real one, and read from /proc/net otherwise
+ * (or if the dump fails)
+ * \param [in,out] net The sockets to be updated
+ * \return Returns true iff at least one of the tables was read
+ */
+bool get_sockets(Net_data_t *net)
+{
+    bool read = false;
+    bool diag = (strcmp(procfs_root(), PROCFS_ROOT) == 0);
+    g_array_set_size(net->sockets, 0);
+    g_hash_table_remove_all(net->by_inode);
+    for (int f = 0; f < NET_NPROTOS; f++)
+    {
+        if ((diag && dump_sockets(net, f)) || read_sockets(net, f))
+        {
+            read = true;
+        }
+    }
+    return read;
+}
+
+struct socket_entry *socket_lookup(Net_data_t *net, unsigned long inode)
+{
+    gsize pos = GPOINTER_TO_SIZE(g_hash_table_lookup(net->by_inode, GSIZE_TO_POINTER(inode)));
+    return (pos > 0 ? &g_array_index(net->sockets, struct socket_entry, pos - 1) : NULL);
+}
+
+/**
+ * \brief Finds the sockets of a process
+ *
+ * Reads the links in /proc/[pid]/fd (with getdents64, as get_open_fd() does) and
+ * looks up the inode of each link to a socket in the index built by get_sockets().
+ * The process is recorded as the owner of the sockets that have none yet
+ * \param [in,out] net The sockets, indexed by get_sockets()
+ * \param [in] pid The PID of the process
+ * \param [out] found If not NULL, the positions in net->sockets of the sockets found are appended to it
+ * \return Returns the number of sockets of the process found in the tables, or -1 if
+ * its open files can't be read
+ */
+long int get_task_sockets(Net_data_t *net, int pid, GArray *found)
+{
+    char buf[FD_DENTS_BUFSZ];
+    // only links to sockets are of interest, so a short buffer is enough
+    char target[BUF_BASESZ];
+    procfs_path(target, BUF_BASESZ, "%d/fd", pid);
+    int dirfd = open(target, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd == -1)
+    {
+        return -1;
+    }
+    long int count = 0;
+    long nread;
+    while ((nread = syscall(SYS_getdents64, dirfd, buf, FD_DENTS_BUFSZ)) > 0)
+    {
+        for (long off = 0; off < nread;)
+        {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            if (d->d_name[0] == '.')
+            {
+                continue;
+            }
+            ssize_t len = readlinkat(dirfd, d->d_name, target, BUF_BASESZ - 1);
+            if (len < 8 || strncmp(target, "socket:[", 8) != 0)
+            {
+                continue;
+            }
+            target[len] = '\0';
+            const char *p = target + 8;
+            struct socket_entry *s = socket_lookup(net, parse_ull(&p));
+            if (s == NULL)
+            {
+                // a socket of another family (such as a unix socket)
+                continue;
+            }
+            if (s->pid == 0)
+            {
+                s->pid = pid;
+            }
+            if (found != NULL)
+            {
+                guint pos = s - (struct socket_entry *)net->sockets->data;
+                g_array_append_val(found, pos);
+            }
+            count++;
+        }
+    }
+    close(dirfd);
+    return count;
+}
+
+void find_socket_owners(Net_data_t *net)
+{
+    DIR *proc_dir = opendir(procfs_root());
+    if (proc_dir == NULL)
+    {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(proc_dir)))
+    {
+        long int pid;
+        if (entry->d_type == DT_DIR && isNumber(entry->d_name, &pid) == 0)
+        {
+            get_task_sockets(net, pid, NULL);
+        }
+    }
+    closedir(proc_dir);
+}
+
+void find_listeners(Net_data_t *net, unsigned short port, GArray *found)
+{
+    for (guint i = 0; i < net->sockets->len; i++)
+    {
+        struct socket_entry *s = &g_array_index(net->sockets, struct socket_entry, i);
+        bool tcp = (s->proto == NET_TCP || s->proto == NET_TCP6);
+        if (s->local_port == port && s->state == (tcp ? NET_TCP_LISTEN : NET_UDP_UNCONN))
+        {
+            g_array_append_val(found, i);
+        }
+    }
+}
+
+void socket_format_addr(const struct socket_entry *s, bool remote, char *buf, size_t len)
+{
+    char addr[INET6_ADDRSTRLEN];
+    bool ipv6 = (s->proto == NET_TCP6 || s->proto == NET_UDP6);
+    inet_ntop((ipv6 ? AF_INET6 : AF_INET), (remote ? s->remote : s->local), addr, INET6_ADDRSTRLEN);
+    snprintf(buf, len, (ipv6 ? "[%s]:%u" : "%s:%u"), addr, (remote ? s->remote_port : s->local_port));
+}
+
+const char *socket_proto_name(const struct socket_entry *s)
+{
+    static const char *names[NET_NPROTOS] = {"tcp", "tcp6", "udp", "udp6"};
+    return names[s->proto];
+}
+
+const char *socket_state_name(const struct socket_entry *s)
+{
+    // the states of the kernel's include/net/tcp_states.h (UDP sockets use two of them)
+    static const char *tcp_states[] = {"?", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2",
+                                       "TIME_WAIT", "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING",
+                                       "NEW_SYN_RECV"};
+    if (s->proto == NET_UDP || s->proto == NET_UDP6)
+    {
+        return (s->state == NET_UDP_UNCONN ? "UNCONN" : "ESTAB");
+    }
+    return (s->state < sizeof(tcp_states) / sizeof(tcp_states[0]) ? tcp_states[s->state] : "?");
+}
@@ -0,0 +1,80 @@
+/**
+ * \file net_info.h
+ * \brief Data structures and functions related to the sockets of processes
+ */
+#ifndef NET_INFO_INCLUDED
+#define NET_INFO_INCLUDED
+
+#include <glib.h>
+#include <netinet/in.h>
+
+#include "common.h"
+#include "procfile.h"
+
+// the socket tables, relative to the root of procfs (see procfs_path())
+#define NET_TCP_FILE "net/tcp"
+#define NET_TCP6_FILE "net/tcp6"
+#define NET_UDP_FILE "net/udp"
+#define NET_UDP6_FILE "net/udp6"
+// length of a socket's address formatted by socket_format_addr() ("[IPv6]:port")
+#define NET_ADDRLEN (INET6_ADDRSTRLEN + 8)
+// state of listening TCP sockets in /proc/net/tcp (TCP_LISTEN in the kernel)
+#define NET_TCP_LISTEN 0x0A
+// state of unconnected UDP sockets in /proc/net/udp (TCP_CLOSE in the kernel)
+#define NET_UDP_UNCONN 0x07
+// size of the buffer receiving the messages of sock_diag (as recommended by netlink(7))
+#define NET_DIAG_BUFSZ 32768
+
+// the socket tables read from /proc/net
+enum net_proto
+{
+    NET_TCP,
+    NET_TCP6,
+    NET_UDP,
+    NET_UDP6,
+    NET_NPROTOS
+};
+
+// a line of one of the socket tables
+struct socket_entry
+{
+    unsigned long inode;
+    int proto;                   ///< the table the socket was read from (enum net_proto)
+    unsigned char local[16];     ///< the local address, in network byte order (4 bytes for IPv4)
+    unsigned char remote[16];    ///< the remote address, in network byte order (4 bytes for IPv4)
+    unsigned short local_port;
+    unsigned short remote_port;
+    unsigned char state;         ///< the state (as in the kernel's enum of TCP states)
+    int pid;                     ///< a process owning the socket (0 until the sockets are joined with the processes)
+};
+
+typedef struct net_data_t
+{
+    Procfile_t files[NET_NPROTOS]; ///< the socket tables, kept open across reads
+    int diag_fd;                   ///< the netlink socket asking sock_diag for the tables (-1 until opened)
+    char *diag_buf;                ///< the buffer receiving its messages (allocated with the socket)
+    GArray *sockets;               ///< the sockets of every table (struct socket_entry)
+    GHashTable *by_inode;          ///< index of sockets: inode -> position in sockets + 1
+} Net_data_t;
+
+// initializes the (empty) tables of sockets
+void net_init(Net_data_t *net);
+// closes the socket tables and frees the index
+void net_close(Net_data_t *net);
+// reads the socket tables (through sock_diag, or from /proc/net) and builds the index of sockets by inode
+bool get_sockets(Net_data_t *net);
+// finds a socket by inode (NULL if it's not in the tables)
+struct socket_entry *socket_lookup(Net_data_t *net, unsigned long inode);
+// counts the sockets of process pid found in the index (appending their positions to found if not NULL)
+long int get_task_sockets(Net_data_t *net, int pid, GArray *found);
+// sets the owner of every socket in the index, scanning the open files of every process
+void find_socket_owners(Net_data_t *net);
+// appends to found the positions of the sockets listening on port (TCP) or bound to it (UDP)
+void find_listeners(Net_data_t *net, unsigned short port, GArray *found);
+// formats a socket's address and port in buf
+void socket_format_addr(const struct socket_entry *s, bool remote, char *buf, size_t len);
+// gets the name of a socket's protocol and of its state
+const char *socket_proto_name(const struct socket_entry *s);
+const char *socket_state_name(const struct socket_entry *s);
+
+#endif
@@ -0,0 +1,323 @@
+/**
+ * \file numa_info.c
+ * \brief Implements functions that read the NUMA topology and per-node statistics
+ *
+ * The topology (which nodes exist and which cores belong to each of them) is read from
+ * sysfs once at startup. It's read again only when the kernel reports that a core, a
+ * memory block or a node went online or offline: such events are received on a netlink
+ * socket listening to kernel uevents, which is checked without blocking at each refresh
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "numa_info.h"
+
+/**
+ * \brief Parses a list of cores in the kernel's format (such as "0-3,8,10-11")
+ * \param [in] list The list to be parsed
+ * \param [out] cpus If not NULL, the array that receives the cores (at least max_cpus long)
+ * \param [in] max_cpus The maximum number of cores stored in cpus
+ * \return Returns the number of cores in the list, or the highest core + 1 if cpus is NULL
+ */
+int parse_cpulist(const char *list, int *cpus, int max_cpus)
+{
+    int count = 0, highest = -1;
+    const char *p = list;
+    while (*p >= '0' && *p <= '9')
+    {
+        int first = parse_ull(&p);
+        int last = first;
+        if (*p == '-')
+        {
+            p++;
+            last = parse_ull(&p);
+        }
+        for (int c = first; c <= last; c++)
+        {
+            if (cpus && count < max_cpus)
+            {
+                cpus[count] = c;
+            }
+            count++;
+        }
+        highest = last;
+        if (*p == ',')
+        {
+            p++;
+        }
+    }
+    return (cpus ? count : highest + 1);
+}
+
+// reads a small sysfs file whole into buf (null-terminated, without the final newline)
+bool read_sysfs_line(const char *path, char *buf, size_t bufsz)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return false;
+    }
+    ssize_t nread = read(fd, buf, bufsz - 1);
+    close(fd);
+    if (nread < 0)
+    {
+        return false;
+    }
+    buf[nread] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return true;
+}
+
+// sorts nodes by increasing id
+static int cmp_nodes(const void *a, const void *b)
+{
+    return ((struct numa_node *)a)->id - ((struct numa_node *)b)->id;
+}
+
+/**
+ * \brief Reads the NUMA topology
+ *
+ * Each directory nodeN in NODE_DIR is a node, whose cores are listed in its cpulist file.
+ * Only online cores are kept, so that offline ones don't weigh on the node's usage.
+ * Systems without NUMA support (no NODE_DIR) are described as a single node with all
+ * the online cores
+ * \param [in,out] numa The topology to be filled (the previous one is freed)
+ * \return Returns true iff at least a node was found
+ */
+bool numa_topology_init(NUMA_data_t *numa)
+{
+    char path[BUF_BASESZ];
+    char online_list[BUF_BASESZ] = "";
+    read_sysfs_line(CPU_ONLINEFILE, online_list, BUF_BASESZ);
+    // arrays indexed by core are sized on the possible cores, which include the offline ones
+    int max_cpus = get_possible_cpus();
+    if (max_cpus < parse_cpulist(online_list, NULL, 0))
+    {
+        max_cpus = parse_cpulist(online_list, NULL, 0);
+    }
+    // cores online in the whole system, indexed by core
+    bool *online = calloc(max_cpus > 0 ? max_cpus : 1, sizeof(bool));
+    int *list = malloc((max_cpus > 0 ? max_cpus : 1) * sizeof(int));
+    if (!online || !list)
+    {
+        free(online);
+        free(list);
+        return false;
+    }
+    int nonline = parse_cpulist(online_list, list, max_cpus);
+    for (int i = 0; i < nonline && i < max_cpus; i++)
+    {
+        online[list[i]] = true;
+    }
+
+    // discard the previous topology
+    int uevent_fd = numa->uevent_fd;
+    for (int n = 0; n < numa->num_nodes; n++)
+    {
+        free(numa->nodes[n].cpus);
+        procfile_close(&numa->nodes[n].meminfo);
+    }
+    free(numa->nodes);
+    numa->nodes = NULL;
+    numa->num_nodes = 0;
+    numa->uevent_fd = uevent_fd;
+
+    DIR *node_dir = opendir(NODE_DIR);
+    struct dirent *entry;
+    while (node_dir && (entry = readdir(node_dir)))
+    {
+        long id;
+        if (strncmp(entry->d_name, "node", 4) != 0 || isNumber(entry->d_name + 4, &id) != 0)
+        {
+            continue;
+        }
+        struct numa_node *tmp = realloc(numa->nodes, (numa->num_nodes + 1) * sizeof(struct numa_node));
+        if (tmp == NULL)
+        {
+            break;
+        }
+        numa->nodes = tmp;
+        struct numa_node *node = &numa->nodes[numa->num_nodes++];
+        memset(node, 0, sizeof(struct numa_node));
+        node->id = id;
+        node->meminfo.fd = -1;
+        snprintf(path, BUF_BASESZ, "%s/node%ld/cpulist", NODE_DIR, id);
+        read_sysfs_line(path, node->cpulist, BUF_BASESZ);
+    }
+    if (node_dir)
+    {
+        closedir(node_dir);
+    }
+    if (numa->num_nodes == 0)
+    {
+        // no NUMA support: a single node holding every core
+        if ((numa->nodes = calloc(1, sizeof(struct numa_node))) != NULL)
+        {
+            numa->num_nodes = 1;
+            numa->nodes[0].meminfo.fd = -1;
+            snprintf(numa->nodes[0].cpulist, BUF_BASESZ, "%s", online_list);
+        }
+    }
+    qsort(numa->nodes, numa->num_nodes, sizeof(struct numa_node), cmp_nodes);
+
+    // keep only the online cores of each node
+    for (int n = 0; n < numa->num_nodes; n++)
+    {
+        struct numa_node *node = &numa->nodes[n];
+        int ncpus = parse_cpulist(node->cpulist, list, max_cpus);
+        node->cpus = malloc((ncpus > 0 ? ncpus : 1) * sizeof(int));
+        for (int i = 0; i < ncpus && i < max_cpus && node->cpus; i++)
+        {
+            if (list[i] < max_cpus && online[list[i]] == true)
+            {
+                node->cpus[node->num_cpus++] = list[i];
+            }
+        }
+    }
+    free(online);
+    free(list);
+    return (numa->num_nodes > 0);
+}
+
+bool numa_hotplug_open(NUMA_data_t *numa)
+{
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_pid = 0;    // let the kernel pick the address
+    addr.nl_groups = 1; // the group of kernel uevents
+    numa->uevent_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (numa->uevent_fd != -1 && bind(numa->uevent_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        close(numa->uevent_fd);
+        numa->uevent_fd = -1;
+    }
+    return (numa->uevent_fd != -1);
+}
+
+/**
+ * \brief Checks if the topology may have changed
+ *
+ * Drains the uevents received since the last call, without blocking. Each uevent is a
+ * sequence of null-terminated "KEY=value" strings: the topology changes only for
+ * events whose SUBSYSTEM is cpu, memory or node
+ * \param [in,out] numa The topology, holding the uevent socket
+ * \return Returns true iff a relevant event was received
+ */
+bool numa_hotplug_pending(NUMA_data_t *numa)
+{
+    char buf[PROCFILE_BUFSZ];
+    bool pending = false;
+    ssize_t len;
+    if (numa->uevent_fd == -1)
+    {
+        return false;
+    }
+    while ((len = recv(numa->uevent_fd, buf, sizeof(buf) - 1, 0)) > 0)
+    {
+        buf[len] = '\0';
+        for (char *field = buf; field < buf + len; field += strlen(field) + 1)
+        {
+            if (strcmp(field, "SUBSYSTEM=cpu") == 0 || strcmp(field, "SUBSYSTEM=memory") == 0 ||
+                strcmp(field, "SUBSYSTEM=node") == 0)
+            {
+                pending = true;
+            }
+        }
+    }
+    return pending;
+}
+
+/**
+ * \brief Reads the statistics of each node
+ *
+ * The memory comes from the node's meminfo file ("Node N MemTotal: x kB" lines).
+ * The cpu usage of a node is the average of the usage of its online cores, as
+ * calculated from /proc/stat by get_cpu_info()
+ * \param [in,out] numa The topology whose statistics are updated
+ * \param [in] percore The per-core statistics (see CPU_data_t)
+ * \param [in] num_cores The length of percore
+ * \return Returns true iff the statistics of every node were read
+ */
+bool get_numa_info(NUMA_data_t *numa, const struct core_data_t *percore, int num_cores)
+{
+    char path[BUF_BASESZ];
+    bool ret = true;
+    for (int n = 0; n < numa->num_nodes; n++)
+    {
+        struct numa_node *node = &numa->nodes[n];
+        snprintf(path, BUF_BASESZ, "%s/node%d/meminfo", NODE_DIR, node->id);
+        if (procfile_read(&node->meminfo, path) == true)
+        {
+            const char *line = node->meminfo.buf;
+            while (*line != '\0')
+            {
+                // skip the "Node N " prefix
+                const char *p = strchr(line, ' ');
+                p = (p ? strchr(p + 1, ' ') : NULL);
+                if (p == NULL)
+                {
+                    break;
+                }
+                p++;
+                if (strncmp(p, "MemTotal:", 9) == 0)
+                {
+                    p += 9;
+                    node->mem_total = parse_ull(&p);
+                }
+                else if (strncmp(p, "MemFree:", 8) == 0)
+                {
+                    p += 8;
+                    node->mem_free = parse_ull(&p);
+                }
+                line = next_line(p);
+            }
+            node->mem_used = node->mem_total - node->mem_free;
+        }
+        else if (numa->num_nodes > 1)
+        {
+            ret = false;
+        }
+
+        float usage = 0, iowait = 0;
+        int counted = 0;
+        for (int i = 0; i < node->num_cpus; i++)
+        {
+            int c = node->cpus[i];
+            if (c < num_cores && percore[c].online == true)
+            {
+                usage += 100.0 - percore[c].perc[CPU_IDLE] - percore[c].perc[CPU_IOWAIT];
+                iowait += percore[c].perc[CPU_IOWAIT];
+                counted++;
+            }
+        }
+        node->cpu_usage = (counted > 0 ? usage / counted : 0);
+        node->cpu_iowait = (counted > 0 ? iowait / counted : 0);
+    }
+    return ret;
+}
+
+void numa_close(NUMA_data_t *numa)
+{
+    for (int n = 0; n < numa->num_nodes; n++)
+    {
+        free(numa->nodes[n].cpus);
+        procfile_close(&numa->nodes[n].meminfo);
+    }
+    free(numa->nodes);
+    numa->nodes = NULL;
+    numa->num_nodes = 0;
+    if (numa->uevent_fd != -1)
+    {
+        close(numa->uevent_fd);
+        numa->uevent_fd = -1;
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ * \file numa_info.h
+ * \brief Data structures and functions related to the NUMA topology of the system
+ */
+#ifndef NUMA_INFO_INCLUDED
+#define NUMA_INFO_INCLUDED
+
+#include <pthread.h>
+
+#include "common.h"
+#include "procfile.h"
+#include "cpu_info.h"
+
+#define NODE_DIR "/sys/devices/system/node"
+
+// a NUMA node, with the cores and memory attached to it
+struct numa_node
+{
+    int id;                       ///< the node's number (nodeN in NODE_DIR)
+    char cpulist[BUF_BASESZ];     ///< the node's cores, as listed in its cpulist file (such as "0-23,48-71")
+    int *cpus;                    ///< the online cores of the node
+    int num_cpus;                 ///< the length of cpus
+    Procfile_t meminfo;           ///< the node's meminfo file, kept open across reads
+    unsigned long mem_total;      ///< in KiB
+    unsigned long mem_free;       ///< in KiB
+    unsigned long mem_used;       ///< in KiB
+    float cpu_usage;              ///< the average usage of the node's online cores
+    float cpu_iowait;             ///< the average iowait of the node's online cores
+};
+
+typedef struct numa_data_t
+{
+    struct numa_node *nodes;
+    int num_nodes;
+    int uevent_fd; ///< netlink socket receiving hotplug events (-1 if unavailable)
+    // syncronization variables
+    pthread_mutex_t mux_memdata;
+    pthread_cond_t cond_updating;
+    bool is_busy;
+} NUMA_data_t;
+
+// parses a list of cores such as "0-3,8": returns their number (or the highest + 1 if cpus is NULL)
+int parse_cpulist(const char *list, int *cpus, int max_cpus);
+// reads the first line of a sysfs file (without the newline)
+bool read_sysfs_line(const char *path, char *buf, size_t bufsz);
+// reads the nodes and their cores from sysfs (discarding the previous topology, if any)
+bool numa_topology_init(NUMA_data_t *numa);
+// opens the socket receiving hotplug events
+bool numa_hotplug_open(NUMA_data_t *numa);
+// returns true if a cpu, memory or node hotplug event was received since the last call
+bool numa_hotplug_pending(NUMA_data_t *numa);
+// reads the memory of each node and sums the usage of its cores from cpudata
+bool get_numa_info(NUMA_data_t *numa, const struct core_data_t *percore, int num_cores);
+// frees the topology and closes every file
+void numa_close(NUMA_data_t *numa);
+
+#endif
@@ -9,31 +9,358 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <dirent.h>
+#include <limits.h>
 #include <unistd.h>
+#include <sys/syscall.h>
 #include <pwd.h> // to get usernames and user IDs from /etc/passwd
 
 #include <glib.h>
 
 #include "cpu_info.h"
 #include "process_info.h"
-#include "main.h"
+#include "cgroup_info.h"
+#include "net_info.h"
+#include "history.h"
 
-// clears (but does not free) a Task structure (given as a pointer)
+// clears (but does not free) a Task structure (given as a pointer): its command is in the
+// arena of the TaskList and its username in the table of usernames, so nothing is freed here
 void clear_task(void *tp)
 {
     Task *task_ptr = (Task *)tp;
-    if (task_ptr->command)
-        free(task_ptr->command);
-    if (task_ptr->username)
-        free(task_ptr->username);
+    task_ptr->command = NULL;
+    task_ptr->args = NULL;
+    task_ptr->username = NULL;
 }
 
-int compare_PIDs(const void *a, const void *b)
+/**
+ * \brief Gets the rarely needed fields of a process, giving it an entry of the table if it has none
+ *
+ * The entries given back by the processes that ended are reused first, so that the table
+ * grows only with the number of processes whose fields are read at the same time
+ * \param [in,out] tasks The list of processes, holding the table
+ * \param [in,out] t The process (possibly not in the list yet)
+ * \return Returns the fields of the process (moved if the table grows: don't keep them across calls)
+ */
+struct task_extra *task_extra_get(TaskList *tasks, Task *t)
+{
+    if (t->extra == 0)
+    {
+        guint pos;
+        if (tasks->free_extras->len > 0)
+        {
+            pos = g_array_index(tasks->free_extras, guint, tasks->free_extras->len - 1);
+            g_array_set_size(tasks->free_extras, tasks->free_extras->len - 1);
+        }
+        else
+        {
+            pos = tasks->extras->len;
+            g_array_set_size(tasks->extras, pos + 1);
+        }
+        memset(&g_array_index(tasks->extras, struct task_extra, pos), 0, sizeof(struct task_extra));
+        t->extra = pos + 1;
+    }
+    return task_extra(tasks, t);
+}
+
+void task_extra_release(TaskList *tasks, Task *t)
+{
+    if (t->extra > 0)
+    {
+        guint pos = t->extra - 1;
+        g_array_append_val(tasks->free_extras, pos);
+        t->extra = 0;
+    }
+}
+
+bool task_in_view(const TaskList *tasks, const Task *t)
+{
+    // before the first frame every process is considered in view
+    return (tasks->frame == 0 || t->shown_frame == tasks->frame);
+}
+
+// tells whether an expensive field of a process is refreshed by this scan: in viewport mode
+// only the processes in view are refreshed, unless the field is the sorting key
+static bool refresh_field(const TaskList *tasks, bool in_view, int (*sortkey)(const void *, const void *, void *))
+{
+    return (tasks->viewport_scan == false || in_view == true || tasks->sortfun == sortkey);
+}
+
+/**
+ * \brief Reads the command and the owner of a process
+ *
+ * These are the fields read from /proc/[pid]/cmdline (or comm) and /proc/[pid]/status,
+ * which replace the ones the task had. The command is stored in the current generation
+ * of the arena of the TaskList
+ * \param [in,out] tasks The list of processes, holding the arena and the usernames
+ * \param [in,out] t The process, whose pid must be set
+ */
+void get_task_details(TaskList *tasks, Task *t)
+{
+    char path[BUF_BASESZ];
+    // the old strings are not freed: they are reclaimed with their generation
+    t->command = NULL;
+    t->args = NULL;
+    t->username = NULL;
+    // get the full command of this process (with options and args), or its name if it has none
+    procfs_path(path, BUF_BASESZ, "%d/cmdline", t->pid);
+    if (get_cmdline(tasks, t, path) == false)
+    {
+        procfs_path(path, BUF_BASESZ, "%d/comm", t->pid);
+        get_cmdline(tasks, t, path);
+    }
+    // get the username and user id of this process's owner
+    procfs_path(path, BUF_BASESZ, "%d/status", t->pid);
+    get_username(tasks->usernames, t, path);
+    t->details_pending = false;
+}
+
+void free_task_columns(TaskList *tasks)
+{
+    struct task_columns *cols = &tasks->cols;
+    free(cols->pid);
+    free(cols->ppid);
+    free(cols->state);
+    free(cols->cpu);
+    free(cols->cpu_ticks);
+    free(cols->num_threads);
+    free(cols->virt_size_bytes);
+    free(cols->resident_set);
+    memset(cols, 0, sizeof(struct task_columns));
+}
+
+TaskList *tasklist_new(long cmdline_cap)
+{
+    TaskList *tasks = calloc(1, sizeof(TaskList));
+    if (tasks == NULL)
+    {
+        return NULL;
+    }
+    tasks->ps = g_array_new(false, false, sizeof(Task));
+    g_array_set_clear_func(tasks->ps, clear_task);
+    tasks->order = g_array_new(false, false, sizeof(guint));
+    tasks->extras = g_array_new(false, false, sizeof(struct task_extra));
+    tasks->free_extras = g_array_new(false, false, sizeof(guint));
+    str_arena_init(&tasks->strings);
+    tasks->cmdline_file.fd = -1;
+    tasks->cmdline_cap = cmdline_cap;
+    tasks->usernames = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free);
+    tasks->num_ps = 0;
+    tasks->num_threads = 0;
+    // default process sorting criteria: lexicographical order of command lines
+    tasks->sortfun = cmp_commands;
+    tasks->cursor_start = 0; // the cursor starts at the first process
+    tasks->cgroups = cgroup_table_new();
+    tasks->group_by_cgroup = false;
+    tasks->show_io = false;
+    tasks->show_fds = false;
+    tasks->show_conns = false;
+    tasks->viewport_scan = false;
+    tasks->net = calloc(1, sizeof(Net_data_t));
+    net_init(tasks->net);
+    pthread_mutex_init(&tasks->mux_memdata, NULL);
+    pthread_cond_init(&tasks->cond_updating, NULL);
+    return tasks;
+}
+
+void tasklist_free(TaskList *tasks)
+{
+    if (tasks->ps)
+        g_array_free(tasks->ps, true); // frees data stored inside as well
+    g_array_free(tasks->order, true);
+    g_array_free(tasks->extras, true);
+    g_array_free(tasks->free_extras, true);
+    free_task_columns(tasks);
+    str_arena_free(&tasks->strings);
+    procfile_close(&tasks->cmdline_file);
+    g_hash_table_destroy(tasks->usernames);
+    if (tasks->proc_dir)
+        closedir(tasks->proc_dir);
+    if (tasks->newprocs)
+    {
+        g_array_free(tasks->newprocs, true);
+        g_array_free(tasks->newstats, true);
+    }
+    g_hash_table_destroy(tasks->cgroups);
+    net_close(tasks->net);
+    free(tasks->net);
+    readbatch_free(&tasks->stat_batch);
+    free(tasks);
+}
+
+// makes room for n processes in each column (doubling their capacity as needed)
+static bool reserve_task_columns(struct task_columns *cols, long int n)
+{
+    if (n <= cols->capacity)
+    {
+        return true;
+    }
+    long int capacity = (cols->capacity > 0 ? cols->capacity : 256);
+    while (capacity < n)
+    {
+        capacity *= 2;
+    }
+    int *pid = realloc(cols->pid, capacity * sizeof(int));
+    if (pid)
+        cols->pid = pid;
+    int *ppid = realloc(cols->ppid, capacity * sizeof(int));
+    if (ppid)
+        cols->ppid = ppid;
+    char *state = realloc(cols->state, capacity * sizeof(char));
+    if (state)
+        cols->state = state;
+    unsigned long int *cpu = realloc(cols->cpu, capacity * sizeof(unsigned long int));
+    if (cpu)
+        cols->cpu = cpu;
+    unsigned long int *cpu_ticks = realloc(cols->cpu_ticks, capacity * sizeof(unsigned long int));
+    if (cpu_ticks)
+        cols->cpu_ticks = cpu_ticks;
+    long int *num_threads = realloc(cols->num_threads, capacity * sizeof(long int));
+    if (num_threads)
+        cols->num_threads = num_threads;
+    long int *virt_size_bytes = realloc(cols->virt_size_bytes, capacity * sizeof(long int));
+    if (virt_size_bytes)
+        cols->virt_size_bytes = virt_size_bytes;
+    long int *resident_set = realloc(cols->resident_set, capacity * sizeof(long int));
+    if (resident_set)
+        cols->resident_set = resident_set;
+    // the arrays that could grow keep their new size, but the capacity is the one of all of them
+    if (!(pid && ppid && state && cpu && cpu_ticks && num_threads && virt_size_bytes && resident_set))
+    {
+        return false;
+    }
+    cols->capacity = capacity;
+    return true;
+}
+
+// copies the fields read from /proc/[pid]/stat to the columns, at handle h, with the CPU usage computed from them
+static void set_task_columns(TaskList *tasks, long int h, const struct task_stat *st, unsigned long int cpu)
+{
+    struct task_columns *cols = &tasks->cols;
+    cols->pid[h] = st->pid;
+    cols->ppid[h] = st->ppid;
+    cols->state[h] = st->state;
+    cols->cpu[h] = cpu;
+    cols->cpu_ticks[h] = st->cpu;
+    cols->num_threads[h] = st->num_threads;
+    cols->virt_size_bytes[h] = st->virt_size_bytes;
+    cols->resident_set[h] = st->resident_set;
+}
+
+// appends a process to the list (its handle is the number of processes before it)
+static bool append_task(TaskList *tasks, Task *t, const struct task_stat *st, unsigned long int cpu)
+{
+    long int h = tasks->ps->len;
+    if (reserve_task_columns(&tasks->cols, h + 1) == false)
+    {
+        return false;
+    }
+    g_array_append_val(tasks->ps, *t);
+    set_task_columns(tasks, h, st, cpu);
+    return true;
+}
+
+void reset_tasks(TaskList *tasks)
+{
+    g_array_set_size(tasks->ps, 0);
+    g_array_set_size(tasks->order, 0);
+    g_array_set_size(tasks->extras, 0);
+    g_array_set_size(tasks->free_extras, 0);
+    tasks->num_ps = 0;
+    tasks->num_threads = 0;
+}
+
+bool add_task(TaskList *tasks, Task *t, const struct task_stat *st)
+{
+    // the list is not scanned: the CPU usage is given, and there are no ticks to compute it from
+    if (append_task(tasks, t, st, st->cpu) == false)
+    {
+        return false;
+    }
+    guint h = tasks->num_ps++;
+    g_array_append_val(tasks->order, h);
+    tasks->num_threads += st->num_threads;
+    return true;
+}
+
+// removes the process with handle h, giving its entry of the extras back: like
+// g_array_remove_index_fast, the last process takes its handle, both in ps and in the columns
+static void remove_task(TaskList *tasks, long int h)
+{
+    struct task_columns *cols = &tasks->cols;
+    task_extra_release(tasks, task_at(tasks, h));
+    g_array_remove_index_fast(tasks->ps, h);
+    long int last = tasks->ps->len;
+    if (h != last)
+    {
+        cols->pid[h] = cols->pid[last];
+        cols->ppid[h] = cols->ppid[last];
+        cols->state[h] = cols->state[last];
+        cols->cpu[h] = cols->cpu[last];
+        cols->cpu_ticks[h] = cols->cpu_ticks[last];
+        cols->num_threads[h] = cols->num_threads[last];
+        cols->virt_size_bytes[h] = cols->virt_size_bytes[last];
+        cols->resident_set[h] = cols->resident_set[last];
+    }
+}
+
+long int find_task(const TaskList *tasks, int pid)
+{
+    for (long int h = 0; h < tasks->num_ps; h++)
+    {
+        if (tasks->cols.pid[h] == pid)
+        {
+            return h;
+        }
+    }
+    return -1;
+}
+
+// binary search of the process pid, when the handles are sorted by increasing PID
+static long int search_task(const TaskList *tasks, int pid)
+{
+    long int lo = 0, hi = tasks->order->len;
+    while (lo < hi)
+    {
+        long int mid = lo + (hi - lo) / 2;
+        guint h = task_handle(tasks, mid);
+        if (tasks->cols.pid[h] < pid)
+        {
+            lo = mid + 1;
+        }
+        else if (tasks->cols.pid[h] > pid)
+        {
+            hi = mid;
+        }
+        else
+        {
+            return h;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \brief Computes the CPU usage of a process between two scans
+ * \param [in] prev The user plus system time read by the previous scan (in clock ticks)
+ * \param [in] ticks The user plus system time read by this scan
+ * \param [in] elapsed The seconds since the previous scan (0 if there was none)
+ * \param [in] ticks_sec The clock ticks per second
+ * \param [in] cores The number of cores, which bounds the usage
+ * \return Returns the usage in percent of one core (0 if it can't be computed)
+ */
+static unsigned long int cpu_usage(unsigned long int prev, unsigned long int ticks, double elapsed, long ticks_sec,
+                                   int cores)
 {
-    Task *ta = (Task *)a;
-    Task *tb = (Task *)b;
-    return ta->pid - tb->pid;
+    if (elapsed <= 0 || ticks_sec <= 0 || ticks < prev)
+    {
+        return 0;
+    }
+    double perc = (ticks - prev) * 100.0 / (ticks_sec * elapsed);
+    // the ticks are sampled at a slightly different time than the clock: don't exceed every core busy
+    double max = 100.0 * (cores > 0 ? cores : 1);
+    return (unsigned long int)((perc < max ? perc : max) + 0.5);
 }
 
 /**
@@ -42,107 +369,227 @@ int compare_PIDs(const void *a, const void *b)
  * This function updates the TaskList given with information about the processes currently
  * executing on this machine. It does so by reading the contents of /proc to gather
  * command lines, PIDs, etc... Updates are performed based on the difference with the
- * previous list of tasks to improve efficiency
+ * previous list of tasks to improve efficiency. The CPU usage of a process is the time it
+ * ran since the previous scan, in percent of one core: a process found for the first time
+ * (or whose PID was reused) has none until the next scan
  * \param [in,out] tasks The structure holding (among other things) the array of processes in the system
+ * \param [in] cpudata The CPU statistics, for the number of cores
  * \return Returns true iff the update was completed successfully, false otherwise
  */
 bool get_processes_info(TaskList *tasks, CPU_data_t *cpudata)
 {
-    // sort the tasklist by increasing PID (and save the old sorting mode)
-    // this expensive passage is needed to perform a binary search on the array
-    // for each PID in /proc
-    int (*oldsort)(const void *, const void *) = tasks->sortfun;
-    g_array_sort(tasks->ps, cmp_pid_incr);
+    // the buffers the stat files are read into, kept across scans (with a ring, if the kernel supports io_uring)
+    if (tasks->stat_batch.bufs == NULL && readbatch_init(&tasks->stat_batch, STAT_BUFSZ, true) == false)
+    {
+        return false;
+    }
+    // sort the handles by increasing PID, to perform a binary search on them for each PID
+    // in /proc: only the handles move, and the comparisons read just the PID column
+    g_array_sort_with_data(tasks->order, cmp_pid_incr, tasks);
+    // the handles are in PID order now, as needed by the round-robins over smaps_rollup and the sockets
+    update_smaps(tasks);
+    update_conns(tasks);
+    // the commands read (or kept) by this scan are stored in a new generation of the arena
+    str_arena_begin(&tasks->strings);
 
     // reset the number of threads, since each process could have changed its number
     // of threads since the last time the data was updated
     tasks->num_threads = 0;
     // resets the presence flag of each task in the array to mark it as terminated
-    int i;
+    long int i;
     for (i = 0; i < tasks->num_ps; i++)
     {
-        Task *t = &g_array_index(tasks->ps, Task, i);
+        Task *t = task_at(tasks, i);
         t->present = false;
     }
-    // new processes created since the last time the function ran are inserted in this array
-    GArray *newprocs = g_array_new(false, false, sizeof(Task));
+    // new processes created since the last time the function ran are inserted in these arrays
+    // (kept across scans, like the directory stream below, so that a scan allocates no memory)
+    if (tasks->newprocs == NULL)
+    {
+        tasks->newprocs = g_array_new(false, false, sizeof(Task));
+        tasks->newstats = g_array_new(false, false, sizeof(struct task_stat));
+    }
+    GArray *newprocs = tasks->newprocs;
+    GArray *newstats = tasks->newstats;
+    g_array_set_size(newprocs, 0);
+    g_array_set_size(newstats, 0);
     long int newprocs_sz = 0;
+    // /proc/[pid]/io costs an extra open per process: read it only if it's needed
+    bool read_io = tasks_need_io(tasks);
+    bool read_fds = tasks_need_fds(tasks);
+    double now = history_now();
+    // the CPU usage is computed on the clock ticks the processes ran since the previous scan
+    double elapsed = (tasks->cpu_time > 0 ? now - tasks->cpu_time : 0);
+    long ticks_sec = sysconf(_SC_CLK_TCK);
+    // the command and owner of every process are needed to sort by them
+    bool details_sort = (tasks->sortfun == cmp_commands || tasks->sortfun == cmp_usernames);
 
-    // open the directory stream "/proc" containing processes in the system as subdirectories
-    DIR *proc_dir = opendir(PROC_DIR);
-    char path_statfile[BUF_BASESZ]; // this fixed buffer will hold the path to the stat file of each process
+    // open the directory stream of procfs containing processes in the system as subdirectories
+    // (or rewind it: the entries are read again from the kernel)
+    if (tasks->proc_dir == NULL)
+    {
+        tasks->proc_dir = opendir(procfs_root());
+    }
+    else
+    {
+        rewinddir(tasks->proc_dir);
+    }
+    DIR *proc_dir = tasks->proc_dir;
+    char path_statfile[BUF_BASESZ]; // this fixed buffer will hold the path to the other files of each process
+    Readbatch_t *batch = &tasks->stat_batch;
     if (proc_dir)
     {
         struct dirent *entry = NULL;
-        // reset to distinguish read errors from the end of the directory as both situations
-        // make the readdir() function return NULL and thus exit the loop
-        errno = 0;
-        while ((entry = readdir(proc_dir)))
-        {
-            long int pid;
-            // ignore files that are not directories and directories whose name
-            // is not an integer (the complete path must be /proc/pid)
-            if (entry->d_type == DT_DIR && isNumber(entry->d_name, &pid) == 0)
+        bool listed = false, dir_error = false;
+        // the processes are listed READBATCH_MAX at a time: the stat files of a batch are
+        // read at once (with a single system call if io_uring is available), then the
+        // processes of the batch are updated one by one
+        while (listed == false)
+        {
+            int n = 0;
+            // reset to distinguish read errors from the end of the directory as both situations
+            // make the readdir() function return NULL and thus exit the loop
+            for (errno = 0; n < READBATCH_MAX && (entry = readdir(proc_dir)) != NULL; errno = 0)
+            {
+                long int pid;
+                // ignore files that are not directories and directories whose name
+                // is not an integer (the complete path must be /proc/pid)
+                if (entry->d_type == DT_DIR && isNumber(entry->d_name, &pid) == 0)
+                {
+                    procfs_path(batch->paths[n], BUF_BASESZ, "%ld/stat", pid);
+                    n++;
+                }
+            }
+            if (n < READBATCH_MAX)
             {
-                Task newproc;
-                memset(&newproc, 0, sizeof(Task));
-                // get detailed process infos from the file above
-                snprintf(path_statfile, BUF_BASESZ, "/proc/%ld/stat", pid);
-                bool stat_ret = get_stat_details(&newproc, path_statfile);
-                // get the full command of this process (with options and args)
-                snprintf(path_statfile, BUF_BASESZ, "/proc/%ld/comm", pid);
-                bool cmd_ret = get_cmdline(&newproc, path_statfile);
-                // get the username and user id of this process's owner
-                snprintf(path_statfile, BUF_BASESZ, "/proc/%ld/status", pid);
-                bool set_uname = get_username(&newproc, path_statfile);
-
-                unsigned int ps_idx;
+                listed = true;
+                dir_error = (errno != 0);
+            }
+            readbatch_read(batch, n);
+            for (int b = 0; b < n; b++)
+            {
+                struct task_stat newstat;
+                memset(&newstat, 0, sizeof(struct task_stat));
+                if (parse_stat_details(&newstat, readbatch_buf(batch, b), batch->lens[b]) == false)
+                {
+                    // the process ended after its directory was listed: if it was in the array
+                    // it's still marked as not present, so it's removed with the others
+                    continue;
+                }
+                long int pid = newstat.pid;
+                long int h = search_task(tasks, newstat.pid);
                 // If the process was already in the array just update its data
-                if (g_array_binary_search(tasks->ps, &newproc, compare_PIDs, &ps_idx) == true)
+                if (h >= 0)
                 {
-                    Task *process = &g_array_index(tasks->ps, struct task, ps_idx);
-                    // Update the task with new data, but leave PID, visibility and highlighting unchanged
-                    process->ppid = newproc.ppid;
-                    process->userid = newproc.userid;
-                    if (process->username)
+                    Task *process = task_at(tasks, h);
+                    bool reused = (process->start_time != newstat.start_time);
+                    bool in_view = task_in_view(tasks, process);
+                    if (reused == true)
                     {
-                        free(process->username);
+                        // the PID has been reused by another process since the last scan:
+                        // move it to the cgroup of the new process
+                        cgroup_remove_task(tasks->cgroups, process->cgroup, tasks->cols.num_threads[h],
+                                           tasks->cols.resident_set[h]);
+                        process->cgroup = get_task_cgroup(tasks->cgroups, newstat.pid);
+                        cgroup_add_task(process->cgroup, newstat.num_threads, newstat.resident_set);
+                        process->start_time = newstat.start_time;
+                        task_extra_release(tasks, process);
                     }
-                    if (newproc.username)
+                    else
                     {
-                        process->username = strdup(newproc.username);
+                        cgroup_update_task(process->cgroup, newstat.num_threads - tasks->cols.num_threads[h],
+                                           newstat.resident_set - tasks->cols.resident_set[h]);
                     }
-                    if (process->command)
+                    // the command and owner are read again only if they may have changed and are needed
+                    bool read_details = (reused == true);
+                    if (tasks->details_once == false)
                     {
-                        free(process->command);
+                        read_details = (read_details == true || tasks->viewport_scan == false || in_view == true ||
+                                        (process->details_pending == true && details_sort == true));
                     }
-                    if (newproc.command)
+                    if (read_details == true)
                     {
-                        process->command = strdup(newproc.command);
+                        get_task_details(tasks, process);
+                    }
+                    else
+                    {
+                        // the command is the same, but it must survive its generation
+                        process->command = str_arena_carry(&tasks->strings, process->command);
+                        process->args = str_arena_carry_argv(&tasks->strings, process->args);
+                    }
+                    // Update the task with new data, but leave PID, visibility and highlighting unchanged
+                    unsigned long int cpu = (reused == true ? 0 : cpu_usage(tasks->cols.cpu_ticks[h], newstat.cpu,
+                                                                              elapsed, ticks_sec, cpudata->num_cores));
+                    set_task_columns(tasks, h, &newstat, cpu);
+                    process->nice = newstat.nice;
+                    struct task_extra *x = task_extra(tasks, process);
+                    if (read_io == true && (x == NULL || x->io_denied == false) &&
+                        refresh_field(tasks, in_view, cmp_io_write_decr) == true)
+                    {
+                        x = task_extra_get(tasks, process);
+                        procfs_path(path_statfile, BUF_BASESZ, "%ld/io", pid);
+                        get_io_stats(x, path_statfile, now);
+                    }
+                    // the open files are counted again only if the process is in view or its count is old
+                    if (read_fds == true && (x == NULL || (x->fds_denied == false &&
+                                                           (in_view == true || now - x->fds_time >= FDS_MAXAGE))) &&
+                        refresh_field(tasks, in_view, cmp_fds_decr) == true)
+                    {
+                        x = task_extra_get(tasks, process);
+                        procfs_path(path_statfile, BUF_BASESZ, "%ld/fd", pid);
+                        if (get_open_fd(x, path_statfile) == true)
+                        {
+                            x->fds_time = now;
+                        }
                     }
-                    process->state = newproc.state;
-                    process->cpu_usr = newproc.cpu_usr / cpudata->total.prev_total;
-                    process->cpu_sys = newproc.cpu_sys / cpudata->total.prev_total;
-                    process->nice = newproc.nice;
-                    process->num_threads = newproc.num_threads;
-                    process->virt_size_bytes = newproc.virt_size_bytes;
-                    process->resident_set = newproc.resident_set;
                     // mark the updated process as still present in the system
                     process->present = true;
-                    // free fields in the new task since the old one has been updated
-                    clear_task(&newproc);
                 }
                 else
                 {
                     // process not found: insert it at the end of the new processes's array
-                    // add to the process its list of open file decriptors
+                    // and add it to its cgroup (read just this once)
+                    // default flag values are: process present, visible and not highlighted
+                    Task newproc;
+                    memset(&newproc, 0, sizeof(Task));
+                    newproc.present = true;
+                    newproc.visible = true;
+                    newproc.pid = newstat.pid;
+                    newproc.nice = newstat.nice;
+                    newproc.start_time = newstat.start_time;
+                    newproc.cgroup = get_task_cgroup(tasks->cgroups, newproc.pid);
+                    // in viewport mode the command and owner are read when the process comes into view
+                    // (or by this scan, if they are needed to sort)
+                    if (tasks->viewport_scan == false || tasks->frame == 0 || details_sort == true)
+                    {
+                        get_task_details(tasks, &newproc);
+                    }
+                    else
+                    {
+                        newproc.details_pending = true;
+                    }
+                    cgroup_add_task(newproc.cgroup, newstat.num_threads, newstat.resident_set);
+                    if (read_io == true)
+                    {
+                        procfs_path(path_statfile, BUF_BASESZ, "%ld/io", pid);
+                        get_io_stats(task_extra_get(tasks, &newproc), path_statfile, now);
+                    }
+                    if (read_fds == true)
+                    {
+                        struct task_extra *x = task_extra_get(tasks, &newproc);
+                        procfs_path(path_statfile, BUF_BASESZ, "%ld/fd", pid);
+                        if (get_open_fd(x, path_statfile) == true)
+                        {
+                            x->fds_time = now;
+                        }
+                    }
                     g_array_append_val(newprocs, newproc);
+                    g_array_append_val(newstats, newstat);
                     newprocs_sz += 1;
                 }
             }
         }
-        closedir(proc_dir);
-        if (errno != 0)
+        if (dir_error == true)
         {
             // read error because errno changed
             return false;
@@ -152,10 +599,12 @@ bool get_processes_info(TaskList *tasks, CPU_data_t *cpudata)
         i = 0;
         while (i < tasks->num_ps)
         {
-            Task *t = &g_array_index(tasks->ps, Task, i);
+            Task *t = task_at(tasks, i);
             if (t->present == false)
             {
-                g_array_remove_index_fast(tasks->ps, i);
+                cgroup_remove_task(tasks->cgroups, t->cgroup, tasks->cols.num_threads[i],
+                                   tasks->cols.resident_set[i]);
+                remove_task(tasks, i);
                 // because of the implementation of the function above, the last item
                 // in the array is used to fill the freed spot, so it must be examined
                 // by not incrementing i in this iteration
@@ -165,201 +614,636 @@ bool get_processes_info(TaskList *tasks, CPU_data_t *cpudata)
             else
             {
                 // the process is still running, so count its number of threads
-                tasks->num_threads += t->num_threads;
+                tasks->num_threads += tasks->cols.num_threads[i];
                 i++;
             }
         }
         // Now merge the main process array and the one containing newly discovered processes
         for (i = 0; i < newprocs_sz; i++)
         {
-            Task newt = g_array_index(newprocs, Task, i);
-            g_array_append_val(tasks->ps, newt);
-            // add in these threads as well
-            tasks->num_threads += newt.num_threads;
+            Task *newt = &g_array_index(newprocs, Task, i);
+            struct task_stat *st = &g_array_index(newstats, struct task_stat, i);
+            if (append_task(tasks, newt, st, 0) == true)
+            {
+                // add in these threads as well
+                tasks->num_threads += st->num_threads;
+                tasks->num_ps++;
+            }
+            else
+            {
+                cgroup_remove_task(tasks->cgroups, newt->cgroup, st->num_threads, st->resident_set);
+                task_extra_release(tasks, newt);
+                clear_task(newt);
+            }
         }
-        // then update the number of processes
-        tasks->num_ps += newprocs_sz;
-        // the (now empty) new processes array can be freed
-        g_array_free(newprocs, false);
+        // the commands of the processes still running have been copied: the old ones can go
+        str_arena_reclaim(&tasks->strings);
+
+        tasks->cpu_time = now;
 
-        // restore the old sorting criteria (but don't sort)
-        tasks->sortfun = oldsort;
+        // the handles changed with the removals: list them again, to be sorted for display
+        g_array_set_size(tasks->order, tasks->num_ps);
+        for (i = 0; i < tasks->num_ps; i++)
+        {
+            task_handle(tasks, i) = i;
+        }
     }
     return (proc_dir != NULL ? true : false);
 }
 
-bool get_stat_details(Task *proc, const char *stat_filepath)
+bool get_stat_details(struct task_stat *st, const char *stat_filepath)
 {
-    FILE *fp = fopen(stat_filepath, "r");
-    char buf[BUF_BASESZ];
-    long cpu_ticks_sec = sysconf(_SC_CLK_TCK); // get the clock ticks per second
+    char buf[STAT_BUFSZ];
+    int fd = open(stat_filepath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return false;
+    }
+    ssize_t len = read(fd, buf, STAT_BUFSZ - 1);
+    close(fd);
+    if (len > 0)
+    {
+        buf[len] = '\0';
+    }
+    return parse_stat_details(st, buf, len);
+}
 
+bool parse_stat_details(struct task_stat *st, const char *buf, ssize_t len)
+{
     // fields contained in the stat file
     int pid, ppid, exit_status;
     long int nice, nthreads;
     long int rss; // # of pages of this process in real memory (the resident set) [not reliable]
     long unsigned int usr_time, sys_time, vsize;
+    unsigned long long start_time = 0;
     char state;
 
-    if (fp)
+    // the read fails (with ESRCH) if the process has ended since the file was opened
+    if (len <= 0)
     {
-        if (fgets(buf, BUF_BASESZ, fp))
-        {
-            sscanf(buf,
-                   /*
-                    * from /proc/pid/stat's documentation
-                    * 1st row: fields 1 to 18. 2nd row: fiels 19 to 34. 3rd row: fields 35 to 52
-                    */
-                   "%d (%*[^)]%*[)] %c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d\
-	     %ld %ld %*d %*[0-9] %lu %ld %*[0-9] %*u %*u %*u %*u %*u %*u %*u %*u %*u\
+        return false;
+    }
+    // the command name can hold blanks and parentheses: the fields after it follow the last ')'
+    const char *fields = strrchr(buf, ')');
+    if (sscanf(buf, "%d", &pid) != 1 || fields == NULL)
+    {
+        return false;
+    }
+    if (sscanf(fields + 1,
+               /*
+                * from /proc/pid/stat's documentation
+                * 1st row: fields 1 to 18. 2nd row: fiels 19 to 34. 3rd row: fields 35 to 52
+                */
+               " %c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d\
+	     %ld %ld %*d %llu %lu %ld %*[0-9] %*u %*u %*u %*u %*u %*u %*u %*u %*u\
 	     %*u %*u %*u %*d %*d %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %*u %d",
-                   &pid, &state, &ppid, &usr_time, &sys_time, &nice, &nthreads, &vsize, &rss, &exit_status);
-
-            // fill the task structure with reads
-            // default flag values are: process present, visible and not highlighted
-            proc->present = true;
-            proc->visible = true;
-            proc->highlight = false;
-            proc->pid = pid;
-            proc->state = state;
-            proc->ppid = ppid;
-            proc->cpu_usr = usr_time * cpu_ticks_sec;
-            proc->cpu_sys = sys_time * cpu_ticks_sec;
-            proc->nice = nice;
-            proc->num_threads = nthreads;
-            proc->virt_size_bytes = vsize;
-            proc->resident_set = rss;
-        }
-        fclose(fp);
+               &state, &ppid, &usr_time, &sys_time, &nice, &nthreads, &start_time, &vsize, &rss, &exit_status) < 9)
+    {
+        return false;
     }
-    return (fp ? true : false);
+
+    st->pid = pid;
+    st->state = state;
+    st->ppid = ppid;
+    st->cpu = usr_time + sys_time;
+    st->nice = nice;
+    st->num_threads = nthreads;
+    st->virt_size_bytes = vsize;
+    st->resident_set = rss;
+    st->start_time = start_time;
+    return true;
 }
 
 /**
  * \brief Reads the command line of this process
  *
- * Given a process whose PID is x, this function reads the file /proc/x/comm to
- * obtain the command name. If the string read from this file is 16 bytes long then it's
- * likely to have been truncated, so /proc/x/cmdline is used instead
- * command line (with arguments). The command line is truncated at BUF_BASESZ - 1 characters
+ * Given a process whose PID is x, this function reads the file /proc/x/cmdline to obtain
+ * its full command line (with arguments), or /proc/x/comm to obtain just the command name,
+ * which the kernel truncates at 15 characters. The file is read whole into the reusable
+ * buffer of the TaskList, however long it is. The arguments in cmdline are stored in
+ * proc->args, and the command line, with blanks in place of the separators, in
+ * proc->command (both in the arena)
+ * \param [in,out] tasks The list of processes, holding the arena and the buffer
  * \param [in,out] proc The pointer to the Task whose command line should be read
- * \param [in] cmd_filepath The path the the process's cmdline file (/proc/PID/cmdline)
- * \return Returns true iff the command line has been read successfully and is not NULL, false otherwise
+ * \param [in] cmd_filepath The path the the process's cmdline file (/proc/PID/cmdline or /proc/PID/comm)
+ * \return Returns true iff the command line has been read successfully and is not empty, false otherwise
  */
-bool get_cmdline(Task *proc, const char *cmd_filepath)
+bool get_cmdline(TaskList *tasks, Task *proc, const char *cmd_filepath)
 {
-    // open the file containing the command line (either /proc/[pid]/comm or /proc/pid/cmdline)
-    FILE *fp = fopen(cmd_filepath, "r");
-    if (fp)
+    Procfile_t *pf = &tasks->cmdline_file;
+    // kernel threads (and zombies) have an empty cmdline
+    if (procfile_read_file(pf, cmd_filepath) == false || pf->len == 0)
     {
-        char *buf = NULL;
-        if ((buf = calloc(BUF_BASESZ, sizeof(char))) == NULL)
+        return false;
+    }
+    char *buf = pf->buf;
+    size_t len = pf->len;
+    if (strstr(cmd_filepath, "cmdline") == NULL)
+    {
+        // comm holds a single line
+        char *newline = memchr(buf, '\n', len);
+        if (newline)
         {
-            return false;
+            len = newline - buf;
         }
-        // if the process has nothing in /proc/[pid]/comm then fallback to cmdline
-        char *result = fgets(buf, BUF_BASESZ, fp);
-        if (result == NULL)
+    }
+    else
+    {
+        // the command line args are separated by NULLs, and the last one is terminated by a NULL
+        while (len > 0 && buf[len - 1] == '\0')
         {
-            free(buf);
-            return false;
-        }
-        // If the command is shorter than the max lenght (15 + null terminator)
-        // then the comm hasn't been truncated. If a command's lenght is
-        // greater or equal to that, then it's likely to have been truncated.
-        // So, the full command is fetched trough /proc/[pid]/cmdline (if possible)
-        // and it's used instead. If the full command is unavailable the truncated
-        // command name is used instead
-        if ((strlen(buf) >= 15 || result == NULL) && strstr(cmd_filepath, "cmdline") == NULL)
-        {
-            char full_cmdline_path[BUF_BASESZ];
-            snprintf(full_cmdline_path, BUF_BASESZ, "/proc/%d/cmdline", proc->pid);
-            if (get_cmdline(proc, full_cmdline_path) == true)
-            {
-                // the command line args are separated by NULLs. This loop substitutes each
-                // of them with blanks (leaving the string terminator untouched)
-                int i = 1;
-                while (i < strlen(proc->command))
-                {
-                    // two NULLs in a row mean the end of the string
-                    if (proc->command[i - 1] == '\0' && proc->command[i] == '\0')
-                    {
-                        break;
-                    }
-                    // one NULL and then a non-NULL character mean an argument separator
-                    if (proc->command[i - 1] == '\0' && proc->command[i] != '\0')
-                    {
-                        proc->command[i - 1] = ' ';
-                    }
-                    i++;
-                }
-            }
+            len--;
         }
-        // this branch is executed either if the command read from /proc/[pid]/comm
-        // is shorter than 15 characters or is cmd_filepath is /proc/[pid]/cmdline
-        else if (result != NULL)
+        proc->args = str_arena_argv(&tasks->strings, buf, len);
+        // a single pass replaces the separators with blanks
+        for (char *sep = memchr(buf, '\0', len); sep != NULL; sep = memchr(sep, '\0', buf + len - sep))
         {
-            proc->command = strdup(buf);
+            *sep++ = ' ';
         }
-        free(buf);
-        fclose(fp);
     }
-    return (fp ? true : false);
+    proc->command = str_arena_strndup(&tasks->strings, buf, len);
+    return (proc->command ? true : false);
 }
 /**
  * \brief Obtains the username of the user owning the process
  *
  * The process's status file contains the user id of the owner, thus its username can be obtained
- * by parsing the file /etc/passwd. This is accomplished by the library function getpwuid_r()
+ * by parsing the file /etc/passwd. This is accomplished by the library function getpwuid_r(),
+ * which is called once per user id: its result is kept in usernames
+ * \param [in,out] usernames The usernames read so far, indexed by user id
+ * \param [in,out] tp The process whose user id and username are set
+ * \param [in] statusfile The path of the process's status file (/proc/[pid]/status)
+ * \return Returns true iff the user id has been read and has a username
  */
-bool get_username(Task *tp, const char *statusfile)
+bool get_username(GHashTable *usernames, Task *tp, const char *statusfile)
 {
-    FILE *fp = fopen(statusfile, "r");
-    char *buf = calloc(BUF_BASESZ, sizeof(char));
-    if (fp && buf)
+    char buf[2 * STAT_BUFSZ];
+    int fd = open(statusfile, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
     {
-        int uid = -1; // this process owner's (effective) user id
-        while (fgets(buf, BUF_BASESZ, fp))
-        {
-            // parse only the line containing "Uid"
-            if (sscanf(buf, "Uid:\t%*d\t%d\t*d\t%*d", &uid) == 1)
-            {
-                // set the uid field of the task
-                tp->userid = uid;
-                break;
-            }
-        }
-        fclose(fp);
-        // Detect if the user id was actually parsed correctly
-        if (uid == -1)
+        return false;
+    }
+    // the Uid line is among the first ones of the file
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0)
+    {
+        return false;
+    }
+    buf[len] = '\0';
+
+    int uid = -1; // this process owner's (effective) user id
+    const char *line = buf;
+    while (*line != '\0')
+    {
+        // parse only the line containing "Uid" (real, effective, saved and filesystem uid)
+        if (strncmp(line, "Uid:", 4) == 0)
         {
-            return false;
+            const char *p = line + 4;
+            parse_ull(&p);
+            uid = parse_ull(&p);
+            // set the uid field of the task
+            tp->userid = uid;
+            break;
         }
+        line = next_line(line);
+    }
+    // Detect if the user id was actually parsed correctly
+    if (uid == -1)
+    {
+        return false;
+    }
+
+    gpointer username;
+    if (g_hash_table_lookup_extended(usernames, GINT_TO_POINTER(uid), NULL, &username) == false)
+    {
         // obtain the username of the user having this user id
         struct passwd pwd_entry;
-        struct passwd *search_result;
+        struct passwd *search_result = NULL;
         long suggested_size = sysconf(_SC_GETPW_R_SIZE_MAX);
         if (suggested_size == -1)
         {
             suggested_size = 16384; // 2^14, should be plenty
         }
-        buf = realloc(buf, suggested_size);
-        if (getpwuid_r(uid, &pwd_entry, buf, suggested_size, &search_result) == 0)
+        char *pwbuf = malloc(suggested_size);
+        username = NULL;
+        if (pwbuf && getpwuid_r(uid, &pwd_entry, pwbuf, suggested_size, &search_result) == 0 &&
+            search_result != NULL)
+        {
+            // a matching entry in /etc/passwd has been found (and is contained in pwd_entry and *search_result)
+            username = strdup(pwd_entry.pw_name);
+        }
+        free(pwbuf);
+        // a user id without a username is stored as well, so that it's not looked up again
+        g_hash_table_insert(usernames, GINT_TO_POINTER(uid), username);
+    }
+    tp->username = username;
+    return (tp->username ? true : false);
+}
+
+/**
+ * \brief Reads the I/O counters of a process
+ *
+ * Updates the counters of the process with the read_bytes, write_bytes, syscr and syscw
+ * fields of /proc/[pid]/io, so that their rates can be given by counter_rate().
+ * Reading that file requires the same permissions as ptrace: if it fails with EACCES
+ * the process is flagged, so that it's not tried again at each scan
+ * \param [in,out] x The fields of the process whose counters are updated
+ * \param [in] io_filepath The path of the process's io file (/proc/[pid]/io)
+ * \param [in] now The time of the update (in seconds)
+ * \return Returns true iff the counters have been updated
+ */
+bool get_io_stats(struct task_extra *x, const char *io_filepath, double now)
+{
+    static const struct
+    {
+        const char *name;
+        int len;
+        int key;
+    } io_fields[] = {
+        {"syscr: ", 7, TASK_IO_SYSCR},
+        {"syscw: ", 7, TASK_IO_SYSCW},
+        {"read_bytes: ", 12, TASK_IO_READ_BYTES},
+        {"write_bytes: ", 13, TASK_IO_WRITE_BYTES},
+    };
+    char buf[STAT_BUFSZ];
+    int fd = open(io_filepath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        if (errno == EACCES)
+        {
+            x->io_denied = true;
+        }
+        return false;
+    }
+    ssize_t len = read(fd, buf, STAT_BUFSZ - 1);
+    close(fd);
+    if (len <= 0)
+    {
+        // reading fails with EACCES as well if the process changed credentials after the open
+        if (len == -1 && errno == EACCES)
         {
-            if (search_result != NULL)
+            x->io_denied = true;
+        }
+        return false;
+    }
+    buf[len] = '\0';
+
+    const char *line = buf;
+    while (*line != '\0')
+    {
+        for (size_t f = 0; f < sizeof(io_fields) / sizeof(io_fields[0]); f++)
+        {
+            if (strncmp(line, io_fields[f].name, io_fields[f].len) == 0)
             {
-                // a matching entry in /etc/passwd has been found (and is contained in pwd_entry and *search_result)
-                tp->username = strdup(pwd_entry.pw_name);
+                const char *p = line + io_fields[f].len;
+                counter_update(&x->io[io_fields[f].key], parse_ull(&p), now);
+                break;
             }
         }
-        // otherwise some error occurred in getting the username matching uid
-        if (search_result == NULL)
+        line = next_line(line);
+    }
+    return true;
+}
+
+bool tasks_need_io(const TaskList *tasks)
+{
+    return (tasks->show_io == true || tasks->sortfun == cmp_io_write_decr);
+}
+
+/**
+ * \brief Reads the memory of a process from its smaps_rollup file
+ *
+ * /proc/[pid]/smaps_rollup sums the fields of every mapping of the process, so it gives
+ * a precise account of its memory, unlike the resident set in /proc/[pid]/stat. Since
+ * the kernel walks the page tables of the process to generate it, it's expensive for
+ * large processes: see update_smaps() for how often it's read
+ * \param [in,out] x The fields of the process whose memory is updated
+ * \param [in] smaps_filepath The path of the process's file (/proc/[pid]/smaps_rollup)
+ * \param [in] now The time of the update (in seconds)
+ * \return Returns true iff the memory of the process has been updated
+ */
+bool get_smaps_rollup(struct task_extra *x, const char *smaps_filepath, double now)
+{
+    char buf[2 * STAT_BUFSZ];
+    int fd = open(smaps_filepath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        if (errno == EACCES)
+        {
+            x->smaps_denied = true;
+        }
+        return false;
+    }
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len < 0)
+    {
+        if (errno == EACCES)
+        {
+            x->smaps_denied = true;
+        }
+        return false;
+    }
+    buf[len] = '\0';
+
+    // kernel threads have no mappings: their file is empty and every field stays zero
+    unsigned long pss = 0, private_clean = 0, private_dirty = 0, swap = 0;
+    const char *line = buf;
+    while (*line != '\0')
+    {
+        const char *p = line;
+        if (strncmp(line, "Pss:", 4) == 0)
+        {
+            p += 4;
+            pss = parse_ull(&p);
+        }
+        else if (strncmp(line, "Private_Clean:", 14) == 0)
+        {
+            p += 14;
+            private_clean = parse_ull(&p);
+        }
+        else if (strncmp(line, "Private_Dirty:", 14) == 0)
+        {
+            p += 14;
+            private_dirty = parse_ull(&p);
+        }
+        else if (strncmp(line, "Swap:", 5) == 0)
         {
-            // no matching userin /etc/passwd
-            tp->username = NULL;
+            p += 5;
+            swap = parse_ull(&p);
         }
+        line = next_line(p);
+    }
+    x->pss_kb = pss;
+    x->uss_kb = private_clean + private_dirty;
+    x->swap_kb = swap;
+    x->smaps_time = now;
+    return true;
+}
 
-        free(buf);
+// reads smaps_rollup for the process, unless its values are younger than SMAPS_MAXAGE or it can't be read
+static bool refresh_smaps(TaskList *tasks, Task *t, double now)
+{
+    char path[BUF_BASESZ];
+    const struct task_extra *x = task_extra(tasks, t);
+    if (x != NULL && (x->smaps_denied == true || (x->smaps_time > 0 && now - x->smaps_time < SMAPS_MAXAGE)))
+    {
+        return false;
+    }
+    procfs_path(path, BUF_BASESZ, "%d/smaps_rollup", t->pid);
+    get_smaps_rollup(task_extra_get(tasks, t), path, now);
+    return true;
+}
+
+/**
+ * \brief Refreshes the memory of the processes read from smaps_rollup within a time budget
+ *
+ * Reading smaps_rollup for every process at each scan would take too long on a system
+ * with many (or large) processes, so the files are read until SMAPS_BUDGET_SEC has passed.
+ * The processes displayed by the last frame of the process window are refreshed first,
+ * then (when sorting by PSS) the processes never read, so that they are ranked. The time
+ * left is spent in round-robin over the others, resuming from the PID after the last one
+ * read by the previous scan, so that every process is refreshed eventually (in viewport
+ * mode the processes out of view are skipped, unless sorting by PSS)
+ * \param [in,out] tasks The list of processes, whose handles are sorted by increasing PID
+ */
+void update_smaps(TaskList *tasks)
+{
+    if (tasks->skip_smaps == true)
+    {
+        return;
+    }
+    double now = history_now();
+    double deadline = now + SMAPS_BUDGET_SEC;
+    bool by_smaps = (tasks->sortfun == cmp_pss_decr);
+    long int i;
+    for (i = 0; i < tasks->num_ps; i++)
+    {
+        Task *t = task_at(tasks, task_handle(tasks, i));
+        bool shown = (tasks->frame > 0 && t->shown_frame == tasks->frame);
+        const struct task_extra *x = task_extra(tasks, t);
+        if ((shown == true || (by_smaps == true && (x == NULL || x->smaps_time == 0))) &&
+            refresh_smaps(tasks, t, now) == true &&
+            history_now() > deadline)
+        {
+            return;
+        }
+    }
+    if (tasks->viewport_scan == true && by_smaps == false)
+    {
+        return;
+    }
+    // the round-robin starts from the first PID not less than smaps_next_pid
+    long int first = 0;
+    while (first < tasks->num_ps && tasks->cols.pid[task_handle(tasks, first)] < tasks->smaps_next_pid)
+    {
+        first++;
+    }
+    for (i = 0; i < tasks->num_ps; i++)
+    {
+        Task *t = task_at(tasks, task_handle(tasks, (first + i) % tasks->num_ps));
+        if (refresh_smaps(tasks, t, now) == true)
+        {
+            tasks->smaps_next_pid = t->pid + 1;
+            if (history_now() > deadline)
+            {
+                return;
+            }
+        }
+    }
+}
+
+// counts the sockets of a process, unless its open files can't be read: returns false if it was skipped
+static bool refresh_conns(TaskList *tasks, Task *t, double now)
+{
+    struct task_extra *x = task_extra(tasks, t);
+    if (x != NULL && x->fds_denied == true)
+    {
+        return false;
+    }
+    x = task_extra_get(tasks, t);
+    x->num_conns = get_task_sockets(tasks->net, t->pid, NULL);
+    x->conns_time = now;
+    return true;
+}
+
+/**
+ * \brief Counts the sockets of the processes displayed, and of the others within a time budget
+ *
+ * Counting the sockets of a process walks its open file descriptors and reads the link of
+ * each one, which costs too much to do for every process at each scan when there are many
+ * sockets. The socket tables are indexed once, then the processes displayed by the last
+ * frame of the process window are counted (when sorting by sockets they are the ones with
+ * the most). The others are counted only when sorting by sockets, so that they are ranked:
+ * in round-robin until CONNS_BUDGET_SEC has passed, resuming from the PID after the last one
+ * counted by the previous scan. Otherwise a process keeps the count it had when last shown
+ * \param [in,out] tasks The list of processes, whose handles are sorted by increasing PID
+ */
+void update_conns(TaskList *tasks)
+{
+    // the socket tables are indexed once per scan, then each process's sockets are looked up in the index
+    if (tasks_need_conns(tasks) == false || get_sockets(tasks->net) == false)
+    {
+        return;
+    }
+    double now = history_now();
+    double deadline = now + CONNS_BUDGET_SEC;
+    long int i;
+    for (i = 0; i < tasks->num_ps; i++)
+    {
+        Task *t = task_at(tasks, task_handle(tasks, i));
+        if (tasks->frame > 0 && t->shown_frame == tasks->frame)
+        {
+            refresh_conns(tasks, t, now);
+        }
+    }
+    if (tasks->sortfun != cmp_conns_decr)
+    {
+        return;
+    }
+    // the round-robin starts from the first PID not less than conns_next_pid
+    long int first = 0;
+    while (first < tasks->num_ps && tasks->cols.pid[task_handle(tasks, first)] < tasks->conns_next_pid)
+    {
+        first++;
+    }
+    for (i = 0; i < tasks->num_ps && history_now() <= deadline; i++)
+    {
+        Task *t = task_at(tasks, task_handle(tasks, (first + i) % tasks->num_ps));
+        if ((tasks->frame == 0 || t->shown_frame != tasks->frame) && refresh_conns(tasks, t, now) == true)
+        {
+            tasks->conns_next_pid = t->pid + 1;
+        }
+    }
+}
+
+bool tasks_need_fds(const TaskList *tasks)
+{
+    return (tasks->show_fds == true || tasks->sortfun == cmp_fds_decr);
+}
+
+bool tasks_need_conns(const TaskList *tasks)
+{
+    return (tasks->show_conns == true || tasks->sortfun == cmp_conns_decr);
+}
+
+/**
+ * \brief Counts the open file descriptors of a process
+ *
+ * The entries of /proc/[pid]/fd are read in blocks of FD_DENTS_BUFSZ bytes with the raw
+ * getdents64 system call and just counted, without a readdir() per entry nor a stat()
+ * or readlink() of each file, so that processes with hundreds of thousands of open files
+ * take a few system calls. Since Linux 6.2 the size of the directory is the number of
+ * open file descriptors, so a single fstat() is enough where it's available (the size is
+ * zero on older kernels). If the directory can't be opened because of EACCES the process
+ * is flagged, so that it's not tried again
+ * \param [in,out] x The fields of the process whose num_fds is updated
+ * \param [in] fd_dir The path of the process's fd directory (/proc/[pid]/fd)
+ * \return Returns true iff the open file descriptors have been counted
+ */
+bool get_open_fd(struct task_extra *x, const char *fd_dir)
+{
+    char buf[FD_DENTS_BUFSZ];
+    int dirfd = open(fd_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd == -1)
+    {
+        if (errno == EACCES)
+        {
+            x->fds_denied = true;
+        }
+        return false;
+    }
+    struct stat dirstat;
+    if (fstat(dirfd, &dirstat) == 0 && dirstat.st_size > 0)
+    {
+        close(dirfd);
+        x->num_fds = dirstat.st_size;
+        return true;
+    }
+    long int count = 0;
+    long nread;
+    while ((nread = syscall(SYS_getdents64, dirfd, buf, FD_DENTS_BUFSZ)) > 0)
+    {
+        for (long off = 0; off < nread;)
+        {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            // the entries are numbers, except for . and ..
+            if (d->d_name[0] != '.')
+            {
+                count++;
+            }
+            off += d->d_reclen;
+        }
+    }
+    close(dirfd);
+    if (nread == -1)
+    {
+        return false;
+    }
+    x->num_fds = count;
+    return true;
+}
+
+static int cmp_fd_entries(const void *a, const void *b)
+{
+    return ((struct fd_entry *)a)->fd - ((struct fd_entry *)b)->fd;
+}
+
+/**
+ * \brief Lists the open file descriptors of a process with the files they refer to
+ *
+ * This is far more expensive than get_open_fd(), since it takes a readlink() per
+ * file descriptor, so it's meant to be called on demand for a single process
+ * \param [in] pid The PID of the process
+ * \return Returns an array of struct fd_entry sorted by fd (to be freed with free_fd_list()),
+ * or NULL if /proc/[pid]/fd can't be read (errno is set)
+ */
+GArray *get_fd_list(int pid)
+{
+    char buf[FD_DENTS_BUFSZ];
+    char target[PATH_MAX];
+    procfs_path(target, PATH_MAX, "%d/fd", pid);
+    int dirfd = open(target, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd == -1)
+    {
+        return NULL;
+    }
+    GArray *fds = g_array_new(false, false, sizeof(struct fd_entry));
+    long nread;
+    while ((nread = syscall(SYS_getdents64, dirfd, buf, FD_DENTS_BUFSZ)) > 0)
+    {
+        for (long off = 0; off < nread;)
+        {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            if (d->d_name[0] == '.')
+            {
+                continue;
+            }
+            // the file may have been closed since the directory was read: it's skipped
+            ssize_t len = readlinkat(dirfd, d->d_name, target, PATH_MAX - 1);
+            if (len == -1)
+            {
+                continue;
+            }
+            target[len] = '\0';
+            struct fd_entry entry;
+            entry.fd = atoi(d->d_name);
+            entry.target = strdup(target);
+            g_array_append_val(fds, entry);
+        }
+    }
+    close(dirfd);
+    g_array_sort(fds, cmp_fd_entries);
+    return fds;
+}
+
+void free_fd_list(GArray *fds)
+{
+    for (unsigned int i = 0; i < fds->len; i++)
+    {
+        free(g_array_index(fds, struct fd_entry, i).target);
     }
-    return (fp && tp->username ? true : false);
+    g_array_free(fds, true);
 }
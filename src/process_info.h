@@ -6,72 +6,241 @@
 #define PROCESS_INFO_DEFINED
 
 #include <glib.h>
+#include <dirent.h>
 
-#include "main.h"
+#include "common.h"
+#include "procfile.h"
+#include "str_arena.h"
+#include "readbatch.h"
 
-#define PROC_DIR "/proc"
+// default number of characters of a command line displayed (searches use the whole command line)
+#define CMDLINE_DISPLAY_CAP 256
+// size of the buffer holding /proc/[pid]/stat (its 52 fields don't fit in BUF_BASESZ)
+#define STAT_BUFSZ 1024
 
+// time budget of a scan for reading /proc/[pid]/smaps_rollup (in seconds)
+#define SMAPS_BUDGET_SEC 0.02
+// age after which the values read from /proc/[pid]/smaps_rollup are refreshed (in seconds)
+#define SMAPS_MAXAGE 4.0
+
+// size of the buffer filled by each getdents64 call on /proc/[pid]/fd (about 1300 entries)
+#define FD_DENTS_BUFSZ 32768
+// rows above and below the process window whose processes are considered in view
+#define PROC_VIEW_MARGIN 10
+// age after which the open files of a process not displayed are counted again (in seconds)
+#define FDS_MAXAGE 4.0
+// time budget of a scan for counting the sockets of the processes not displayed (in seconds)
+#define CONNS_BUDGET_SEC 0.02
+
+// the counters of /proc/[pid]/io whose rates are displayed
+enum task_io_key
+{
+    TASK_IO_READ_BYTES,  ///< bytes actually fetched from the storage layer
+    TASK_IO_WRITE_BYTES, ///< bytes actually sent to the storage layer
+    TASK_IO_SYSCR,       ///< read system calls
+    TASK_IO_SYSCW,       ///< write system calls
+    TASK_IO_NKEYS
+};
+
+// the fields of a process read only when they are displayed or sorted on: a process gets
+// them (in TaskList.extras) the first time one of them is read, and keeps them while it runs
+struct task_extra
+{
+    struct counter io[TASK_IO_NKEYS]; // the counters of /proc/[pid]/io
+    unsigned long pss_kb;             // proportional set size: private pages plus a share of the shared ones
+    unsigned long uss_kb;             // unique set size: the pages only this process maps
+    unsigned long swap_kb;            // swapped out anonymous memory
+    double smaps_time;                // when pss_kb, uss_kb and swap_kb were read (0 if never)
+    long int num_fds;                 // the number of open file descriptors
+    double fds_time;                  // when num_fds was counted (0 if never)
+    long int num_conns;               // the number of TCP and UDP sockets of the process
+    double conns_time;                // when num_conns was counted (0 if never)
+    bool io_denied;                   // flag set if /proc/[pid]/io can't be read (EACCES): it's not tried again
+    bool smaps_denied;                // flag set if /proc/[pid]/smaps_rollup can't be read (EACCES)
+    bool fds_denied;                  // flag set if /proc/[pid]/fd can't be read (EACCES)
+};
+
+// the fields of a process not read at each scan (those read at each scan are in the columns
+// of the TaskList): the rarely needed ones are in its entry of TaskList.extras, if it has one
 struct task
 {
     bool visible;   // flag used to hide the process from the view
     bool present;   // flag used to indicate that the process was found in the last scan
     bool highlight; // flag used to signal that the process needs to be highlighted
+    bool details_pending; // flag set if the command and owner have not been read yet (viewport mode)
+    int pid;        // copy of the PID column, for the functions reading the files of the process
+    int userid;     // this process owner's user id
+    guint extra;    // the position + 1 of the process's entry in TaskList.extras (0 if it has none)
+    char *username; // this process owner's username (if retrivable by get_username): it's in TaskList.usernames
+    char *command;  // the process' command name (can be NULL) [see man 5 proc at /proc/[pid]/comm]: it's in TaskList.strings
+    char **args;    // the process' arguments (NULL-terminated, NULL if the cmdline is empty): they are in TaskList.strings
+    long int nice; // process priority (nice value): ranges from 19 (low prio) to -20 (high prio)
+    unsigned long long start_time; // the time the process started after boot (in clock ticks): with the PID it identifies the process
+    Cgroup *cgroup;                // the cgroup the process belongs to (read once, when the process is found)
+    unsigned long shown_frame;     // the last frame of the process window that displayed this process
+};
+typedef struct task Task;
+
+// the fields of /proc/[pid]/stat read at each scan (see parse_stat_details)
+struct task_stat
+{
     int pid;
     int ppid;
-    int userid;     // this process owner's user id
-    char *username; // this process owner's username (if retrivable by get_username)
-    char *command;  // the process' command name (dynamic, can be NULL) [see man 5 proc at /proc/[pid]/comm]
-    char **args;    // the process'arguments
     char state;
-    unsigned long int cpu_usr;
-    unsigned long int cpu_sys;
-    long int nice; // process priority (nice value): ranges from 19 (low prio) to -20 (high prio)
+    unsigned long int cpu; // user plus system time since the process started (in clock ticks)
+    long int nice;
     long int num_threads;
-    long int virt_size_bytes; // size of the virtual memory occupied by the process (in bytes)
-    long int resident_set;    // the number of pages of this process in physical memory at the moment (unreliable)
+    long int virt_size_bytes;
+    long int resident_set;
+    unsigned long long start_time;
+};
+
+/**
+ * \brief The hot fields of the processes, stored in parallel arrays
+ *
+ * The element of each array at index h belongs to the process whose Task is at index h
+ * of TaskList.ps (its handle). Scanning and sorting touch only these arrays, so that they
+ * walk a few contiguous bytes per process instead of a whole Task
+ */
+struct task_columns
+{
+    int *pid;
+    int *ppid;
+    char *state;
+    unsigned long int *cpu;       // the CPU usage between the last two scans, in percent of one core
+    unsigned long int *cpu_ticks; // user plus system time read by the last scan (in clock ticks)
+    long int *num_threads;
+    long int *virt_size_bytes;
+    long int *resident_set; // the number of pages of the process in physical memory at the moment (unreliable)
+    long int capacity;      // the number of elements allocated in each array
+};
+
+// an open file descriptor of a process and the file it refers to (see get_fd_list)
+struct fd_entry
+{
+    int fd;
+    char *target; // the target of the link /proc/[pid]/fd/[fd] (such as a path or socket:[inode])
 };
-typedef struct task Task;
 
 struct tasklist
 {
     long int num_ps;
     long int num_threads;
-    GArray *ps;
+    GArray *ps;                // the cold fields (Task) of the processes, indexed by handle
+    struct task_columns cols;  // the hot fields of the processes, indexed by the same handle as ps
+    GArray *order;             // the handles (guint) of the processes in display order
+    GArray *extras;            // the rarely needed fields of the processes (struct task_extra), see Task.extra
+    GArray *free_extras;       // the positions (guint) of the entries of extras no process has
     int procs_running;
     // syncronization variables
     pthread_mutex_t mux_memdata;
     pthread_cond_t cond_updating;
     bool is_busy;
-    int (*sortfun)(const void *, const void *);
+    int (*sortfun)(const void *, const void *, void *); // compares two handles (the TaskList is the data)
     long int cursor_start; // the first process to be displayed (to implement scrolling)
+    GHashTable *cgroups;   // the cgroups of the tasks, indexed by path (see cgroup_info.h)
+    bool group_by_cgroup;  // flag set to display cgroups instead of processes
+    bool show_io;          // flag set to display the I/O rates of the processes
+    bool show_fds;         // flag set to display the number of open file descriptors of the processes
+    bool show_conns;       // flag set to display the number of sockets of the processes
+    Net_data_t *net;       // the sockets, indexed at each scan when their number is needed
+    bool viewport_scan;    // flag set to refresh the expensive fields only of the processes in view
+    unsigned long frame;   // the number of frames of the process window drawn (see Task.shown_frame)
+    double cpu_time;       // when the last scan read the CPU times of the processes (0 before the first)
+    int smaps_next_pid;    // where the round-robin refresh of smaps_rollup resumes
+    int conns_next_pid;    // where the round-robin count of the sockets resumes (when sorting by them)
+    Str_arena_t strings;   // the commands of the processes, a generation per scan
+    Procfile_t cmdline_file; // the buffer the command lines are read into (grown to fit the longest one)
+    int cmdline_cap;       // the number of characters of the command lines displayed (0 for no limit)
+    GHashTable *usernames; // the usernames looked up so far (or NULL if a user id has none), indexed by user id
+    DIR *proc_dir;         // the directory stream of /proc, rewound at each scan
+    GArray *newprocs;      // the processes found by a scan (Task), before they are added to ps
+    GArray *newstats;      // the hot fields of the processes in newprocs (struct task_stat)
+    bool skip_smaps;       // flag set when the values of smaps_rollup are not needed (the headless modes don't output them)
+    bool details_once;     // flag set to read the command and owner of a process only when it's found (the recorder)
+    Readbatch_t stat_batch; // the stat files of the processes, read a batch at a time
 };
 typedef struct tasklist TaskList;
 
+// the handle of the i-th process in display order
+#define task_handle(tasks, i) g_array_index((tasks)->order, guint, (i))
+// the Task of the process with handle h
+#define task_at(tasks, h) (&g_array_index((tasks)->ps, Task, (h)))
+// the rarely needed fields of the Task t (NULL if none of them was read yet)
+#define task_extra(tasks, t) \
+    ((t)->extra > 0 ? &g_array_index((tasks)->extras, struct task_extra, (t)->extra - 1) : NULL)
+
+// allocates an empty list of processes, whose command lines are shown up to cmdline_cap characters
+TaskList *tasklist_new(long cmdline_cap);
+// closes the files of the list and frees it, with its processes
+void tasklist_free(TaskList *tasks);
 // clears (but does not free) a Task structure (given as a pointer)
 void clear_task(void *tp);
+// the rarely needed fields of the Task t, given an entry of TaskList.extras (zeroed) if it has none
+struct task_extra *task_extra_get(TaskList *tasks, Task *t);
+// gives the entry of TaskList.extras of the Task t back (so that its fields are read again from scratch)
+void task_extra_release(TaskList *tasks, Task *t);
+// frees the columns of the hot fields of the processes
+void free_task_columns(TaskList *tasks);
+// empties the list, to fill it with add_task() from something other than /proc (such as a recording)
+void reset_tasks(TaskList *tasks);
+// appends a process, with the hot fields in st, to a list emptied by reset_tasks(): st->cpu is its CPU usage
+bool add_task(TaskList *tasks, Task *t, const struct task_stat *st);
+// the handle of the process pid (-1 if it's not in the list)
+long int find_task(const TaskList *tasks, int pid);
 // switch between sorting modes
-void switch_sortmode(TaskList *tasks, int (*newmode)(const void *, const void *));
-// Process sorting functions
+void switch_sortmode(TaskList *tasks, int (*newmode)(const void *, const void *, void *));
+// Process sorting functions: they compare two handles (guint) of the TaskList given as data
 // lexicographical sorting on the cmdline string
-int cmp_commands(const void *a, const void *b);
+int cmp_commands(const void *a, const void *b, void *tasks);
 // pid increasing sorting
-int cmp_pid_incr(const void *a, const void *b);
+int cmp_pid_incr(const void *a, const void *b, void *tasks);
 // pid decreasing sorting
-int cmp_pid_decr(const void *a, const void *b);
+int cmp_pid_decr(const void *a, const void *b, void *tasks);
 // lexicographical username sorting (NULL usernames last)
-int cmp_usernames(const void *a, const void *b);
+int cmp_usernames(const void *a, const void *b, void *tasks);
 // increasing thread count
-int cmp_nthreads_inc(const void *a, const void *b);
+int cmp_nthreads_inc(const void *a, const void *b, void *tasks);
 // decreasing thread count
-int cmp_nthreads_decr(const void *a, const void *b);
+int cmp_nthreads_decr(const void *a, const void *b, void *tasks);
+// decreasing CPU usage
+int cmp_cpu_decr(const void *a, const void *b, void *tasks);
+// decreasing rate of bytes written to storage (top I/O writers first)
+int cmp_io_write_decr(const void *a, const void *b, void *tasks);
+// decreasing proportional set size
+int cmp_pss_decr(const void *a, const void *b, void *tasks);
+// decreasing number of open file descriptors
+int cmp_fds_decr(const void *a, const void *b, void *tasks);
+// decreasing number of sockets
+int cmp_conns_decr(const void *a, const void *b, void *tasks);
 
 // gets information about the running processes
 bool get_processes_info(TaskList *tasks, CPU_data_t *cpudata);
-bool get_stat_details(Task *proc, const char *stat_filepath);
-bool get_cmdline(Task *proc, const char *cmd_filepath);
-bool get_open_fd(Task *tp, const char *fd_dir);
-bool get_username(Task *tp, const char *statusfile);
-
-int isNumber(const char *s, long *n);
+// reads the stat file of a process: false if the process has ended or the file is malformed
+bool get_stat_details(struct task_stat *st, const char *stat_filepath);
+// parses the contents of a stat file, read with len bytes (or failed with len <= 0) and null-terminated
+bool parse_stat_details(struct task_stat *st, const char *buf, ssize_t len);
+// reads the command and owner of the process
+void get_task_details(TaskList *tasks, Task *t);
+// tells whether the process was displayed (or within PROC_VIEW_MARGIN rows) by the last frame
+bool task_in_view(const TaskList *tasks, const Task *t);
+bool get_cmdline(TaskList *tasks, Task *proc, const char *cmd_filepath);
+bool get_open_fd(struct task_extra *x, const char *fd_dir);
+bool get_username(GHashTable *usernames, Task *tp, const char *statusfile);
+bool get_io_stats(struct task_extra *x, const char *io_filepath, double now);
+bool get_smaps_rollup(struct task_extra *x, const char *smaps_filepath, double now);
+// refreshes the memory of the processes from smaps_rollup within SMAPS_BUDGET_SEC
+void update_smaps(TaskList *tasks);
+// counts the sockets of the processes displayed, and of the others within CONNS_BUDGET_SEC when sorting by them
+void update_conns(TaskList *tasks);
+// tells whether the I/O counters are needed (because they are displayed or sorted on)
+bool tasks_need_io(const TaskList *tasks);
+// tells whether the numbers of open file descriptors are needed
+bool tasks_need_fds(const TaskList *tasks);
+// tells whether the numbers of sockets are needed
+bool tasks_need_conns(const TaskList *tasks);
+// lists the open file descriptors of a process and their targets (sorted by fd)
+GArray *get_fd_list(int pid);
+void free_fd_list(GArray *fds);
 
 #endif
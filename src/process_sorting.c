@@ -2,7 +2,17 @@
 
 #include <string.h>
 
-void switch_sortmode(TaskList *tasks, int (*newmode)(const void *, const void *)) {
+// the handle pointed by the argument of a sorting function
+#define HANDLE(p) (*(const guint *)(p))
+// the Task of the handle pointed by p in the TaskList tl
+#define TASK(tl, p) task_at((const TaskList *)(tl), HANDLE(p))
+// the hot field col of the handle pointed by p in the TaskList tl
+#define COLUMN(tl, col, p) (((const TaskList *)(tl))->cols.col[HANDLE(p)])
+// the rarely needed field of the handle pointed by p in the TaskList tl (none if it was never read)
+#define EXTRA(tl, field, p, none) \
+    (TASK(tl, p)->extra > 0 ? task_extra((const TaskList *)(tl), TASK(tl, p))->field : (none))
+
+void switch_sortmode(TaskList *tasks, int (*newmode)(const void *, const void *, void *)) {
     tasks->sortfun = newmode;
 }
 
@@ -10,9 +20,9 @@ void switch_sortmode(TaskList *tasks, int (*newmode)(const void *, const void *)
 // returns -1 iff process a's cmdline (as read from /proc/[a_pid]/cmdline) is
 // lexicographically less than b's or b's is NULL. It returns 0 if both cmdlines are NULL
 // and 1 if b's is less than a's or a's cmdline is NULL
-int cmp_commands(const void *a, const void *b) {
-    Task *ta = (Task*)a;
-    Task *tb = (Task*)b;
+int cmp_commands(const void *a, const void *b, void *tasks) {
+    Task *ta = TASK(tasks, a);
+    Task *tb = TASK(tasks, b);
     if(!(ta->command || tb->command)) {
         return 0;
     }
@@ -26,25 +36,63 @@ int cmp_commands(const void *a, const void *b) {
     return strcasecmp(ta->command, tb->command);
 }
 // lexicographical username sorting (NULL usernames last)
-int cmp_usernames(const void *a, const void *b) {
-    Task *ta = (Task*)a;
-    Task *tb = (Task*)b;
+int cmp_usernames(const void *a, const void *b, void *tasks) {
+    Task *ta = TASK(tasks, a);
+    Task *tb = TASK(tasks, b);
+    if(!(ta->username || tb->username)) {
+        return 0;
+    }
+    if(!ta->username || !tb->username) {
+        return (ta->username ? -1 : 1);
+    }
     // all usernames are lowercase [verify?], so strcasecmp isn't needed
     return strcmp(ta->username, tb->username);
 }
 // pid increasing sorting
-int cmp_pid_incr(const void *a, const void *b) {
-    return ((Task*)a)->pid - ((Task*)b)->pid;
+int cmp_pid_incr(const void *a, const void *b, void *tasks) {
+    return COLUMN(tasks, pid, a) - COLUMN(tasks, pid, b);
 }
 // pid decreasing sorting
-int cmp_pid_decr(const void *a, const void *b) {
-    return ((Task*)b)->pid - ((Task*)a)->pid;
+int cmp_pid_decr(const void *a, const void *b, void *tasks) {
+    return COLUMN(tasks, pid, b) - COLUMN(tasks, pid, a);
 }
 // increasing thread count
-int cmp_nthreads_inc(const void *a, const void *b) {
-    return ((Task*)a)->num_threads - ((Task*)b)->num_threads;
+int cmp_nthreads_inc(const void *a, const void *b, void *tasks) {
+    return COLUMN(tasks, num_threads, a) - COLUMN(tasks, num_threads, b);
 }
 // decreasing thread count
-int cmp_nthreads_decr(const void *a, const void *b) {
-    return ((Task*)b)->num_threads - ((Task*)a)->num_threads;
+int cmp_nthreads_decr(const void *a, const void *b, void *tasks) {
+    return COLUMN(tasks, num_threads, b) - COLUMN(tasks, num_threads, a);
+}
+// decreasing CPU usage (as shown in the process list)
+int cmp_cpu_decr(const void *a, const void *b, void *tasks) {
+    unsigned long ca = COLUMN(tasks, cpu, a);
+    unsigned long cb = COLUMN(tasks, cpu, b);
+    return (cb > ca) - (cb < ca);
+}
+// decreasing rate of bytes written to storage (top I/O writers first)
+int cmp_io_write_decr(const void *a, const void *b, void *tasks) {
+    const struct task_extra *xa = task_extra((const TaskList *)tasks, TASK(tasks, a));
+    const struct task_extra *xb = task_extra((const TaskList *)tasks, TASK(tasks, b));
+    double wa = (xa != NULL ? counter_rate(&xa->io[TASK_IO_WRITE_BYTES]) : 0);
+    double wb = (xb != NULL ? counter_rate(&xb->io[TASK_IO_WRITE_BYTES]) : 0);
+    return (wb > wa) - (wb < wa);
+}
+// decreasing proportional set size
+int cmp_pss_decr(const void *a, const void *b, void *tasks) {
+    unsigned long pa = EXTRA(tasks, pss_kb, a, 0);
+    unsigned long pb = EXTRA(tasks, pss_kb, b, 0);
+    return (pb > pa) - (pb < pa);
+}
+// decreasing number of open file descriptors
+int cmp_fds_decr(const void *a, const void *b, void *tasks) {
+    long int fa = EXTRA(tasks, num_fds, a, 0);
+    long int fb = EXTRA(tasks, num_fds, b, 0);
+    return (fb > fa) - (fb < fa);
+}
+// decreasing number of sockets
+int cmp_conns_decr(const void *a, const void *b, void *tasks) {
+    long int ca = EXTRA(tasks, num_conns, a, 0);
+    long int cb = EXTRA(tasks, num_conns, b, 0);
+    return (cb > ca) - (cb < ca);
 }
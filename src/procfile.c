@@ -0,0 +1,328 @@
+/**
+ * \file procfile.c
+ * \brief Implements a reader for /proc files that keeps them open and reuses its buffer
+ *
+ * Files like /proc/stat or /proc/meminfo are regenerated by the kernel each time they
+ * are read from offset 0, so there is no need to reopen them at each refresh: a single
+ * pread() on the file descriptor kept open gets the updated contents. The buffer is
+ * allocated when the file is opened and is grown only if the file doesn't fit,
+ * so in steady state a read doesn't allocate anything
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "procfile.h"
+
+// the directory read as procfs (set once at startup, before the threads reading it are created)
+static char procfs_dir[PROCFS_ROOTMAX + 1] = PROCFS_ROOT;
+
+bool procfs_set_root(const char *root)
+{
+    size_t len = strlen(root);
+    // a trailing slash would be doubled in the paths
+    while (len > 1 && root[len - 1] == '/')
+    {
+        len--;
+    }
+    if (len == 0 || len > PROCFS_ROOTMAX)
+    {
+        return false;
+    }
+    memcpy(procfs_dir, root, len);
+    procfs_dir[len] = '\0';
+    return true;
+}
+
+const char *procfs_root(void)
+{
+    return procfs_dir;
+}
+
+bool procfs_path(char *path, size_t size, const char *fmt, ...)
+{
+    int n = snprintf(path, size, "%s/", procfs_dir);
+    if (n < 0 || (size_t)n >= size)
+    {
+        return false;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int m = vsnprintf(path + n, size - n, fmt, args);
+    va_end(args);
+    return (m >= 0 && (size_t)m < size - n);
+}
+
+bool procfile_open(Procfile_t *pf, const char *path)
+{
+    pf->len = 0;
+    if ((pf->fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+    {
+        pf->buf = NULL;
+        pf->bufsz = 0;
+        return false;
+    }
+    if ((pf->buf = malloc(PROCFILE_BUFSZ)) == NULL)
+    {
+        close(pf->fd);
+        pf->fd = -1;
+        return false;
+    }
+    pf->bufsz = PROCFILE_BUFSZ;
+    pf->buf[0] = '\0';
+    return true;
+}
+
+/**
+ * \brief Reads the whole contents of the file
+ *
+ * The file is read with pread() from offset 0, so that the kernel generates its contents
+ * again. If the contents fill up the buffer, the buffer is doubled and the file is read
+ * again, since a partial read of a /proc file cannot be resumed consistently
+ * \param [in,out] pf The file to be read (opened at path if it's not open yet)
+ * \param [in] path The path of the file, used only if pf is not open
+ * \return Returns true iff the file was read successfully
+ */
+bool procfile_read(Procfile_t *pf, const char *path)
+{
+    if (pf->buf == NULL && procfile_open(pf, path) == false)
+    {
+        return false;
+    }
+    while (1)
+    {
+        ssize_t nread = pread(pf->fd, pf->buf, pf->bufsz - 1, 0);
+        if (nread == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        if ((size_t)nread < pf->bufsz - 1)
+        {
+            pf->buf[nread] = '\0';
+            pf->len = nread;
+            return true;
+        }
+        // the buffer is full: the file may be longer, so grow the buffer and retry
+        char *tmp = realloc(pf->buf, pf->bufsz * 2);
+        if (tmp == NULL)
+        {
+            return false;
+        }
+        pf->buf = tmp;
+        pf->bufsz *= 2;
+    }
+}
+
+/**
+ * \brief Reads the whole contents of a file that a single read returns only in part
+ *
+ * Files generated a record at a time, such as the socket tables in /proc/net, return
+ * about a page per read, so the file is read in consecutive parts until the end,
+ * growing the buffer when it's full. The first read is from offset 0, so that the
+ * kernel generates the contents again
+ * \param [in,out] pf The file to be read (opened at path if it's not open yet)
+ * \param [in] path The path of the file, used only if pf is not open
+ * \return Returns true iff the file was read successfully
+ */
+bool procfile_read_all(Procfile_t *pf, const char *path)
+{
+    if (pf->buf == NULL && procfile_open(pf, path) == false)
+    {
+        return false;
+    }
+    size_t len = 0;
+    while (1)
+    {
+        if (len == pf->bufsz - 1)
+        {
+            char *tmp = realloc(pf->buf, pf->bufsz * 2);
+            if (tmp == NULL)
+            {
+                return false;
+            }
+            pf->buf = tmp;
+            pf->bufsz *= 2;
+        }
+        ssize_t nread = pread(pf->fd, pf->buf + len, pf->bufsz - 1 - len, len);
+        if (nread == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        if (nread == 0)
+        {
+            break;
+        }
+        len += nread;
+    }
+    pf->buf[len] = '\0';
+    pf->len = len;
+    return true;
+}
+
+/**
+ * \brief Reads the whole contents of a file that is read once, such as a file of a process
+ *
+ * The file is opened, read in consecutive parts until the end and closed, so that pf
+ * only lends its buffer: the buffer is allocated at the first read and grown when it's
+ * full, then kept for the next file, so a long file costs an allocation just once
+ * \param [in,out] pf The reader whose buffer receives the contents (it's never left open)
+ * \param [in] path The path of the file
+ * \return Returns true iff the file was read successfully
+ */
+bool procfile_read_file(Procfile_t *pf, const char *path)
+{
+    pf->len = 0;
+    pf->fd = -1;
+    if (pf->buf == NULL)
+    {
+        if ((pf->buf = malloc(PROCFILE_BUFSZ)) == NULL)
+        {
+            return false;
+        }
+        pf->bufsz = PROCFILE_BUFSZ;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return false;
+    }
+    size_t len = 0;
+    bool ret = true;
+    while (1)
+    {
+        if (len == pf->bufsz - 1)
+        {
+            char *tmp = realloc(pf->buf, pf->bufsz * 2);
+            if (tmp == NULL)
+            {
+                ret = false;
+                break;
+            }
+            pf->buf = tmp;
+            pf->bufsz *= 2;
+        }
+        ssize_t nread = read(fd, pf->buf + len, pf->bufsz - 1 - len);
+        if (nread == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ret = false;
+            break;
+        }
+        if (nread == 0)
+        {
+            break;
+        }
+        len += nread;
+    }
+    close(fd);
+    pf->buf[len] = '\0';
+    pf->len = len;
+    return ret;
+}
+
+void procfile_close(Procfile_t *pf)
+{
+    if (pf->buf)
+    {
+        close(pf->fd);
+        free(pf->buf);
+    }
+    pf->fd = -1;
+    pf->buf = NULL;
+    pf->bufsz = 0;
+    pf->len = 0;
+}
+
+unsigned long long parse_ull(const char **p)
+{
+    const char *s = *p;
+    while (*s == ' ' || *s == '\t')
+    {
+        s++;
+    }
+    unsigned long long val = 0;
+    while (*s >= '0' && *s <= '9')
+    {
+        val = val * 10 + (*s - '0');
+        s++;
+    }
+    *p = s;
+    return val;
+}
+
+const char *next_line(const char *p)
+{
+    const char *nl = strchr(p, '\n');
+    return (nl ? nl + 1 : p + strlen(p));
+}
+
+void counter_update(struct counter *c, unsigned long long value, double now)
+{
+    // the first update has no previous value: the delta is zero instead of the whole counter
+    if (c->curr_time == 0)
+    {
+        c->curr = value;
+        c->curr_time = now;
+    }
+    c->prev = c->curr;
+    c->prev_time = c->curr_time;
+    c->curr = value;
+    c->curr_time = now;
+}
+
+unsigned long long counter_delta(const struct counter *c)
+{
+    // a counter that went backwards has been reset (or has wrapped around)
+    return (c->curr >= c->prev ? c->curr - c->prev : 0);
+}
+
+double counter_rate(const struct counter *c)
+{
+    double elapsed = c->curr_time - c->prev_time;
+    return (elapsed > 0 ? counter_delta(c) / elapsed : 0);
+}
+
+/**
+ * \brief Utility function to convert a string to long int
+ *
+ * - 0: conversione ok
+ * - 1: non e' un numbero
+ * - 2: overflow/underflow
+ * \param [in] s La stringa da convertire in un intero
+ * \param [out] n Puntatore all'intero risultato della conversione
+ * \return Ritorna un numero corrispondente all'esito della conversione, come riportato nella descrizione
+ */
+int isNumber(const char *s, long *n)
+{
+    if (s == NULL)
+        return 1;
+    if (strlen(s) == 0)
+        return 1;
+    char *e = NULL;
+    errno = 0;
+    long val = strtol(s, &e, 10);
+    if (errno == ERANGE)
+        return 2; // overflow
+    if (e != NULL && *e == (char)0)
+    {
+        *n = val;
+        return 0; // successo
+    }
+    return 1; // non e' un numero
+}
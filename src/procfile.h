@@ -0,0 +1,81 @@
+/**
+ * \file procfile.h
+ * \brief Reader for files in /proc that are read over and over, and counters of their values
+ */
+#ifndef PROCFILE_INCLUDED
+#define PROCFILE_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// the directory read as procfs, unless another one is set with procfs_set_root()
+#define PROCFS_ROOT "/proc"
+// the longest root accepted (the paths of the files of a process must fit in BUF_BASESZ)
+#define PROCFS_ROOTMAX 64
+
+// initial size of the buffer of a Procfile_t (it's doubled when the file does not fit)
+#define PROCFILE_BUFSZ 4096
+
+// a file in /proc kept open across reads
+typedef struct procfile_t
+{
+    int fd;       ///< the file descriptor (-1 if the file is not open)
+    char *buf;    ///< the contents of the file as of the last read (null-terminated)
+    size_t bufsz; ///< the size of buf
+    size_t len;   ///< the number of bytes read by the last read
+} Procfile_t;
+
+// a monotonic counter read from /proc, with its previous value to calculate rates
+struct counter
+{
+    unsigned long long prev; ///< the value at the previous update
+    unsigned long long curr; ///< the value at the latest update
+    double prev_time;        ///< the time of the previous update (in seconds)
+    double curr_time;        ///< the time of the latest update (in seconds)
+};
+
+// an entry returned by the getdents64 system call (see man 2 getdents), used to read
+// directories in /proc without a readdir() per entry
+struct linux_dirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// sets the directory read as procfs (such as a fake tree, for benchmarks): call it before the collectors start
+bool procfs_set_root(const char *root);
+// the directory read as procfs
+const char *procfs_root(void);
+// writes in path the path of a file of procfs, given relative to its root as a printf format ("%d/stat")
+bool procfs_path(char *path, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+// opens the file at path and allocates its buffer
+bool procfile_open(Procfile_t *pf, const char *path);
+// reads the whole file into pf->buf from offset 0 (opening it first if needed)
+bool procfile_read(Procfile_t *pf, const char *path);
+// like procfile_read, but keeps reading until the end of the file (for files that a read returns in parts)
+bool procfile_read_all(Procfile_t *pf, const char *path);
+// reads the whole file at path into pf->buf, closing it afterwards (the buffer is kept)
+bool procfile_read_file(Procfile_t *pf, const char *path);
+// closes the file and frees its buffer
+void procfile_close(Procfile_t *pf);
+
+// parses an unsigned decimal integer at *p (skipping leading blanks) and advances *p past it
+unsigned long long parse_ull(const char **p);
+// returns a pointer to the start of the line following p (or to the terminator)
+const char *next_line(const char *p);
+// converts a whole string to a long int: 0 if done, 1 if it's not a number, 2 if it overflows
+int isNumber(const char *s, long *n);
+
+// records a new value of the counter taken at time now (in seconds)
+void counter_update(struct counter *c, unsigned long long value, double now);
+// gets the increase of the counter between the last two updates
+unsigned long long counter_delta(const struct counter *c);
+// gets the increase per second of the counter between the last two updates
+double counter_rate(const struct counter *c);
+
+#endif
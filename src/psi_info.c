@@ -0,0 +1,192 @@
+/**
+ * \file psi_info.c
+ * \brief Implements functions that read Pressure Stall Information and wait for pressure spikes
+ *
+ * See the kernel's Documentation/accounting/psi.rst: each file in /proc/pressure reports
+ * the share of time tasks were stalled waiting for a resource. Writing a threshold to one
+ * of these files turns its file descriptor into a trigger: poll() reports POLLPRI on it
+ * when the stall time in the given window exceeds the threshold
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "psi_info.h"
+
+static const char *psi_files[PSI_NRESOURCES] = {PSI_CPUFILE, PSI_MEMFILE, PSI_IOFILE};
+
+// true iff key is found in the line that ends at end
+static bool line_has(const char *line, const char *end, const char *key)
+{
+    const char *k = strstr(line, key);
+    return (k != NULL && k < end);
+}
+
+// parses the fields following "some" or "full": avg10=x.xx avg60=x.xx avg300=x.xx total=n
+static void parse_psi_line(struct psi_line *line, const char *p)
+{
+    line->avg10 = strtof(strstr(p, "avg10=") + 6, NULL);
+    line->avg60 = strtof(strstr(p, "avg60=") + 6, NULL);
+    line->avg300 = strtof(strstr(p, "avg300=") + 7, NULL);
+    p = strstr(p, "total=") + 6;
+    line->total = parse_ull(&p);
+}
+
+/**
+ * \brief Reads the pressure averages of cpu, memory and io
+ *
+ * The pressure files are kept open and reread from the start. A line is parsed only if
+ * it contains all the expected fields, so that an unexpected format leaves the
+ * previous values untouched instead of crashing
+ * \param [in,out] psi The pressure data to be updated
+ * \return Returns true iff at least one pressure file could be read
+ */
+bool get_psi_info(PSI_data_t *psi)
+{
+    psi->available = false;
+    for (int r = 0; r < PSI_NRESOURCES; r++)
+    {
+        struct psi_resource_data *res = &psi->res[r];
+        char path[BUF_BASESZ];
+        procfs_path(path, BUF_BASESZ, "%s", psi_files[r]);
+        if (procfile_read(&res->file, path) == false)
+        {
+            continue;
+        }
+        psi->available = true;
+        const char *line = res->file.buf;
+        while (*line != '\0')
+        {
+            const char *end = next_line(line);
+            // the line must hold all the fields, or it's not parsed
+            if (line_has(line, end, "avg10=") && line_has(line, end, "avg60=") &&
+                line_has(line, end, "avg300=") && line_has(line, end, "total="))
+            {
+                if (strncmp(line, "some ", 5) == 0)
+                {
+                    parse_psi_line(&res->some, line);
+                }
+                else if (strncmp(line, "full ", 5) == 0)
+                {
+                    parse_psi_line(&res->full, line);
+                    res->has_full = true;
+                }
+            }
+            line = end;
+        }
+    }
+    return psi->available;
+}
+
+/**
+ * \brief Sets up a trigger on each pressure file
+ *
+ * Each trigger is a new file descriptor on the pressure file, opened for writing,
+ * with "some <stall> <window>" written to it. Triggers that cannot be set up (because
+ * the kernel is too old or the user lacks the permission) are skipped
+ * \param [in,out] psi The pressure data where the triggers' file descriptors are stored
+ * \return Returns true iff at least a trigger was set up
+ */
+bool psi_triggers_open(PSI_data_t *psi)
+{
+    char trigger[BUF_BASESZ];
+    int len = snprintf(trigger, BUF_BASESZ, "some %d %d", PSI_TRIGGER_STALL_US, PSI_TRIGGER_WINDOW_US);
+    psi->has_triggers = false;
+    for (int r = 0; r < PSI_NRESOURCES; r++)
+    {
+        char path[BUF_BASESZ];
+        procfs_path(path, BUF_BASESZ, "%s", psi_files[r]);
+        int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        // the null terminator is written as well, as the kernel expects
+        if (fd != -1 && write(fd, trigger, len + 1) == -1)
+        {
+            close(fd);
+            fd = -1;
+        }
+        psi->res[r].trigger_fd = fd;
+        if (fd != -1)
+        {
+            psi->has_triggers = true;
+        }
+    }
+    return psi->has_triggers;
+}
+
+/**
+ * \brief Waits for pressure on any resource
+ *
+ * Blocks in poll() on the triggers until one of them fires or the timeout expires.
+ * If no trigger is set up it just sleeps for the timeout. A trigger reporting an
+ * error is closed and not waited for anymore: when the last one is closed, has_triggers is
+ * cleared, so that the pressure is detected from the averages again
+ * \param [in,out] psi The pressure data holding the triggers
+ * \param [in] timeout_ms The maximum time to wait, in milliseconds
+ * \return Returns the number of triggers that fired, 0 on timeout or -1 on error
+ */
+int psi_triggers_wait(PSI_data_t *psi, int timeout_ms)
+{
+    struct pollfd fds[PSI_NRESOURCES];
+    int nfds = 0;
+    for (int r = 0; r < PSI_NRESOURCES; r++)
+    {
+        if (psi->res[r].trigger_fd != -1)
+        {
+            fds[nfds].fd = psi->res[r].trigger_fd;
+            fds[nfds].events = POLLPRI;
+            fds[nfds].revents = 0;
+            nfds++;
+        }
+    }
+    int ret = poll(fds, nfds, timeout_ms);
+    if (ret <= 0)
+    {
+        return (ret == -1 && errno != EINTR ? -1 : 0);
+    }
+    int fired = 0;
+    for (int i = 0; i < nfds; i++)
+    {
+        if (fds[i].revents & POLLERR)
+        {
+            for (int r = 0; r < PSI_NRESOURCES; r++)
+            {
+                if (psi->res[r].trigger_fd == fds[i].fd)
+                {
+                    close(fds[i].fd);
+                    psi->res[r].trigger_fd = -1;
+                }
+            }
+        }
+        else if (fds[i].revents & POLLPRI)
+        {
+            fired++;
+        }
+    }
+    psi->has_triggers = false;
+    for (int r = 0; r < PSI_NRESOURCES; r++)
+    {
+        if (psi->res[r].trigger_fd != -1)
+        {
+            psi->has_triggers = true;
+        }
+    }
+    return fired;
+}
+
+void psi_close(PSI_data_t *psi)
+{
+    for (int r = 0; r < PSI_NRESOURCES; r++)
+    {
+        if (psi->res[r].trigger_fd != -1)
+        {
+            close(psi->res[r].trigger_fd);
+            psi->res[r].trigger_fd = -1;
+        }
+        procfile_close(&psi->res[r].file);
+    }
+    psi->has_triggers = false;
+}
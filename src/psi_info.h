@@ -0,0 +1,78 @@
+/**
+ * \file psi_info.h
+ * \brief Data structures and functions related to Pressure Stall Information
+ */
+#ifndef PSI_INFO_INCLUDED
+#define PSI_INFO_INCLUDED
+
+#include <pthread.h>
+
+#include "common.h"
+#include "procfile.h"
+
+// the files read, relative to the root of procfs (see procfs_path())
+#define PSI_CPUFILE "pressure/cpu"
+#define PSI_MEMFILE "pressure/memory"
+#define PSI_IOFILE "pressure/io"
+
+// a trigger fires when tasks are stalled for this long (in microseconds) within the window below
+// (unprivileged users can only use windows that are multiples of 2s)
+#define PSI_TRIGGER_STALL_US 200000
+#define PSI_TRIGGER_WINDOW_US 2000000
+// avg10 (in percent) that is considered pressure when triggers are not available
+#define PSI_AVG_THRESHOLD 10.0
+// seconds without pressure after which the refresh rate goes back to normal
+#define PSI_CALM_SEC 10
+// interval (in milliseconds) between refreshes while under pressure
+#define PSI_FAST_REFRESH_MS 250
+
+// the resources whose pressure is tracked, in the order of psi_files in psi_info.c
+enum psi_resource
+{
+    PSI_CPU,
+    PSI_MEMORY,
+    PSI_IO,
+    PSI_NRESOURCES
+};
+
+// a line of a pressure file: the share of time in which some (or all) tasks were stalled
+struct psi_line
+{
+    float avg10;              ///< percentage over the last 10s
+    float avg60;              ///< percentage over the last 60s
+    float avg300;             ///< percentage over the last 300s
+    unsigned long long total; ///< total stall time in microseconds
+};
+
+struct psi_resource_data
+{
+    struct psi_line some; ///< at least one task stalled on the resource
+    struct psi_line full; ///< all non-idle tasks stalled at the same time
+    bool has_full;        ///< the kernel reports the full line (not for cpu on older kernels)
+    Procfile_t file;      ///< the pressure file, kept open to read averages
+    int trigger_fd;       ///< the pressure file opened with a trigger written to it (-1 if none)
+};
+
+typedef struct psi_data_t
+{
+    struct psi_resource_data res[PSI_NRESOURCES];
+    bool available;    ///< false if the kernel doesn't expose /proc/pressure
+    bool has_triggers; ///< true while at least a trigger is set up (cleared when the last one reports an error)
+    bool under_pressure; ///< true while the refresh rate is increased because of pressure
+    double last_event;   ///< the time of the latest trigger event (see history_now())
+    // syncronization variables
+    pthread_mutex_t mux_memdata;
+    pthread_cond_t cond_updating;
+    bool is_busy;
+} PSI_data_t;
+
+// reads the averages of all pressure files
+bool get_psi_info(PSI_data_t *psi);
+// writes a trigger to each pressure file, so that pressure spikes can be waited for
+bool psi_triggers_open(PSI_data_t *psi);
+// waits up to timeout_ms for a trigger to fire: returns the number of triggers that fired
+int psi_triggers_wait(PSI_data_t *psi, int timeout_ms);
+// closes the triggers and the pressure files
+void psi_close(PSI_data_t *psi);
+
+#endif
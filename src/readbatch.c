@@ -0,0 +1,347 @@
+/**
+ * \file readbatch.c
+ * \brief Implements batched reads of procfs files, with io_uring or one file at a time
+ *
+ * A scan reads the stat file of every process, and each one costs an open, a read and a
+ * close. With io_uring the three are queued for every file of a batch as linked operations:
+ * the open installs the file in a slot of the fixed files of the ring, instead of a
+ * descriptor, the read of the slot follows it into a fixed buffer, and the close of the slot
+ * follows the read even if the read fails or is short. The whole batch is submitted, and its
+ * completions reaped, with a single io_uring_enter(). The ring is set up with raw system
+ * calls (liburing is not needed). If it can't be set up, or a submission fails, the files are
+ * read synchronously from then on
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "readbatch.h"
+
+#ifdef HAVE_IO_URING
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+// the operations queued for each file, in the order they are linked
+enum ring_op
+{
+    RING_OPEN,
+    RING_READ,
+    RING_CLOSE,
+    RING_OPS
+};
+
+// the entries of the submission queue: the operations of a whole batch (rounded up to a power of 2 by the kernel)
+#define RING_ENTRIES (READBATCH_MAX * RING_OPS)
+
+struct readbatch_ring
+{
+    int fd;
+    void *sq_map; ///< the submission queue ring, shared with the kernel
+    size_t sq_mapsz;
+    void *cq_map; ///< the completion queue ring (the same mapping as sq_map if the kernel maps them together)
+    size_t cq_mapsz;
+    struct io_uring_sqe *sqes;
+    size_t sqes_sz;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    bool fixed_bufs;              ///< flag set if the buffers are registered (else the reads use them as plain buffers)
+    int open_res[READBATCH_MAX];  ///< the results of the opens of the last batch
+    int read_res[READBATCH_MAX];  ///< the results of its reads
+};
+
+static void ring_free(struct readbatch_ring *r)
+{
+    if (r->sqes != NULL && r->sqes != MAP_FAILED)
+        munmap(r->sqes, r->sqes_sz);
+    if (r->cq_map != NULL && r->cq_map != MAP_FAILED && r->cq_map != r->sq_map)
+        munmap(r->cq_map, r->cq_mapsz);
+    if (r->sq_map != NULL && r->sq_map != MAP_FAILED)
+        munmap(r->sq_map, r->sq_mapsz);
+    close(r->fd);
+    free(r);
+}
+
+/**
+ * \brief Sets up a ring for the batches of rb
+ *
+ * The read of a file is linked to its open, so its fixed file must be looked up when the
+ * read runs rather than when it's submitted: kernels older than 5.17 (without
+ * IORING_FEAT_LINKED_FILE) are not used. The fixed files are READBATCH_MAX empty slots,
+ * and the buffers of rb are registered as one fixed buffer if the limit of locked memory
+ * allows it
+ * \param [in] rb The batch, whose buffers are allocated
+ * \return Returns the ring, or NULL if io_uring is not available
+ */
+static struct readbatch_ring *ring_setup(Readbatch_t *rb)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(struct io_uring_params));
+    int fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &p);
+    if (fd == -1)
+    {
+        return NULL;
+    }
+    struct readbatch_ring *r = calloc(1, sizeof(struct readbatch_ring));
+    if (r == NULL || (p.features & IORING_FEAT_LINKED_FILE) == 0)
+    {
+        free(r);
+        close(fd);
+        return NULL;
+    }
+    r->fd = fd;
+    r->sq_mapsz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_mapsz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        r->sq_mapsz = r->cq_mapsz = (r->sq_mapsz > r->cq_mapsz ? r->sq_mapsz : r->cq_mapsz);
+    }
+    r->sq_map = mmap(NULL, r->sq_mapsz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sq_map == MAP_FAILED)
+    {
+        ring_free(r);
+        return NULL;
+    }
+    r->cq_map = r->sq_map;
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0)
+    {
+        r->cq_map =
+            mmap(NULL, r->cq_mapsz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (r->cq_map == MAP_FAILED || r->sqes == MAP_FAILED)
+    {
+        ring_free(r);
+        return NULL;
+    }
+    char *sq = r->sq_map, *cq = r->cq_map;
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // a slot per file of the batch, empty (-1) until an open installs a file in it
+    int slots[READBATCH_MAX];
+    for (int i = 0; i < READBATCH_MAX; i++)
+    {
+        slots[i] = -1;
+    }
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_FILES, slots, READBATCH_MAX) == -1)
+    {
+        ring_free(r);
+        return NULL;
+    }
+    struct iovec iov = {rb->bufs, READBATCH_MAX * rb->bufsz};
+    r->fixed_bufs = (syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0);
+    return r;
+}
+
+// takes the next entry of the submission queue, cleared (tail is the local copy of the queue's tail)
+static struct io_uring_sqe *ring_sqe(struct readbatch_ring *r, unsigned *tail)
+{
+    unsigned idx = *tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    r->sq_array[idx] = idx;
+    (*tail)++;
+    return sqe;
+}
+
+// records the results of the completions posted so far, returning their number
+static unsigned ring_reap(struct readbatch_ring *r)
+{
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned count = 0;
+    for (; head != tail; head++, count++)
+    {
+        const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        unsigned i = cqe->user_data / RING_OPS;
+        switch (cqe->user_data % RING_OPS)
+        {
+        case RING_OPEN:
+            r->open_res[i] = cqe->res;
+            break;
+        case RING_READ:
+            r->read_res[i] = cqe->res;
+            break;
+        default:
+            // a close fails only if the open did, and then it's cancelled
+            break;
+        }
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+/**
+ * \brief Reads the first n files of the batch with a submission of the ring
+ *
+ * If the open of a file fails (the process has ended) the read and close linked to it are
+ * cancelled; the close is linked to the read with a hard link, so that it runs after a
+ * failed or short read as well, and the slot is free for the next batch
+ * \param [in,out] rb The batch
+ * \param [in] n The files to read (1 to READBATCH_MAX)
+ * \return Returns false if the batch could not be submitted or reaped whole
+ */
+static bool ring_read(Readbatch_t *rb, int n)
+{
+    struct readbatch_ring *r = rb->ring;
+    unsigned tail = *r->sq_tail;
+    for (int i = 0; i < n; i++)
+    {
+        struct io_uring_sqe *sqe = ring_sqe(r, &tail);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)rb->paths[i];
+        sqe->open_flags = O_RDONLY; // O_CLOEXEC is not allowed with a fixed file (it has no descriptor)
+        sqe->file_index = i + 1;    // the slot is file_index - 1
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = (uint64_t)i * RING_OPS + RING_OPEN;
+
+        sqe = ring_sqe(r, &tail);
+        sqe->opcode = (r->fixed_bufs == true ? IORING_OP_READ_FIXED : IORING_OP_READ);
+        sqe->fd = i;
+        sqe->addr = (uintptr_t)readbatch_buf(rb, i);
+        sqe->len = rb->bufsz - 1;
+        sqe->off = 0;
+        sqe->buf_index = 0;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+        sqe->user_data = (uint64_t)i * RING_OPS + RING_READ;
+
+        sqe = ring_sqe(r, &tail);
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->file_index = i + 1;
+        sqe->user_data = (uint64_t)i * RING_OPS + RING_CLOSE;
+    }
+    __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+
+    unsigned want = n * RING_OPS;
+    long ret;
+    do
+    {
+        ret = syscall(__NR_io_uring_enter, r->fd, want, want, IORING_ENTER_GETEVENTS, NULL, 0);
+        rb->syscalls++;
+    } while (ret == -1 && errno == EINTR);
+    if (ret <= 0)
+    {
+        return false;
+    }
+    // each operation submitted posts a completion (the cancelled ones too): they are all waited
+    // for, even if the batch was submitted in part, since the kernel still writes to the buffers
+    unsigned submitted = ret, done = 0;
+    while ((done += ring_reap(r)) < submitted)
+    {
+        // the wait is interrupted by signals: then it's resumed
+        ret = syscall(__NR_io_uring_enter, r->fd, 0, submitted - done, IORING_ENTER_GETEVENTS, NULL, 0);
+        rb->syscalls++;
+        if (ret == -1 && errno != EINTR)
+        {
+            return false;
+        }
+    }
+    if (submitted < want)
+    {
+        return false;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        rb->lens[i] = (r->open_res[i] < 0 ? r->open_res[i] : r->read_res[i]);
+        if (rb->lens[i] >= 0)
+        {
+            readbatch_buf(rb, i)[rb->lens[i]] = '\0';
+        }
+    }
+    return true;
+}
+#endif
+
+bool readbatch_init(Readbatch_t *rb, size_t bufsz, bool use_uring)
+{
+    memset(rb, 0, sizeof(Readbatch_t));
+    rb->bufsz = bufsz;
+    rb->paths = calloc(READBATCH_MAX, sizeof(*rb->paths));
+    rb->bufs = malloc(READBATCH_MAX * bufsz);
+    if (rb->paths == NULL || rb->bufs == NULL)
+    {
+        readbatch_free(rb);
+        return false;
+    }
+#ifdef HAVE_IO_URING
+    if (use_uring == true)
+    {
+        rb->ring = ring_setup(rb);
+    }
+#else
+    (void)use_uring;
+#endif
+    return true;
+}
+
+void readbatch_free(Readbatch_t *rb)
+{
+#ifdef HAVE_IO_URING
+    if (rb->ring != NULL)
+    {
+        ring_free(rb->ring);
+    }
+#endif
+    free(rb->paths);
+    free(rb->bufs);
+    memset(rb, 0, sizeof(Readbatch_t));
+}
+
+// reads the first n files of the batch one at a time
+static void sync_read(Readbatch_t *rb, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        char *buf = readbatch_buf(rb, i);
+        int fd = open(rb->paths[i], O_RDONLY | O_CLOEXEC);
+        rb->syscalls++;
+        if (fd == -1)
+        {
+            rb->lens[i] = -errno;
+            continue;
+        }
+        ssize_t len = read(fd, buf, rb->bufsz - 1);
+        rb->lens[i] = (len == -1 ? -errno : len);
+        close(fd);
+        rb->syscalls += 2;
+        if (len >= 0)
+        {
+            buf[len] = '\0';
+        }
+    }
+}
+
+bool readbatch_read(Readbatch_t *rb, int n)
+{
+    if (n < 0 || n > READBATCH_MAX)
+    {
+        return false;
+    }
+#ifdef HAVE_IO_URING
+    if (n > 0 && rb->ring != NULL)
+    {
+        if (ring_read(rb, n) == true)
+        {
+            return true;
+        }
+        // io_uring failed: this batch and the next ones are read synchronously
+        ring_free(rb->ring);
+        rb->ring = NULL;
+    }
+#endif
+    sync_read(rb, n);
+    return true;
+}
@@ -0,0 +1,49 @@
+/**
+ * \file readbatch.h
+ * \brief Reads small files of procfs in batches, with a single io_uring submission per batch where possible
+ */
+#ifndef READBATCH_INCLUDED
+#define READBATCH_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "common.h"
+
+// the files read by a batch at most
+#define READBATCH_MAX 256
+
+// the io_uring instance of a batch (see readbatch.c)
+struct readbatch_ring;
+
+/**
+ * \brief A batch of files read into buffers of the same size
+ *
+ * The paths of the files are written in paths, then readbatch_read() reads each one whole
+ * (up to bufsz - 1 bytes) into its buffer. With io_uring the open, read and close of each
+ * file are linked operations on a fixed file, into fixed buffers, and the whole batch takes
+ * one system call; without it (a kernel without io_uring or without linked fixed files, or
+ * a seccomp filter blocking it) each file takes an open, a read and a close
+ */
+typedef struct readbatch_t
+{
+    struct readbatch_ring *ring; ///< NULL if the files are read synchronously
+    char (*paths)[BUF_BASESZ];   ///< the paths of the files of the batch (READBATCH_MAX of them)
+    char *bufs;                  ///< the buffers of the files, bufsz bytes each (see readbatch_buf)
+    size_t bufsz;
+    ssize_t lens[READBATCH_MAX]; ///< the bytes read into each buffer, or -errno if the file could not be read
+    unsigned long syscalls;      ///< the system calls made by the reads so far
+} Readbatch_t;
+
+// the contents of the i-th file of the batch (null-terminated if it was read)
+#define readbatch_buf(rb, i) ((rb)->bufs + (size_t)(i) * (rb)->bufsz)
+
+// allocates the buffers, for files of up to bufsz - 1 bytes, and sets up io_uring if use_uring is true and it's available
+bool readbatch_init(Readbatch_t *rb, size_t bufsz, bool use_uring);
+// frees the buffers and the ring
+void readbatch_free(Readbatch_t *rb);
+// reads the files at the first n paths (up to READBATCH_MAX): false only if n is out of range
+bool readbatch_read(Readbatch_t *rb, int n);
+
+#endif
@@ -0,0 +1,842 @@
+/**
+ * \file record.c
+ * \brief Implements the encoding of the binary log and the record mode
+ *
+ * Most of a tick is the same as the previous one: a process that was idle has the same
+ * fields, and its command never changes. So a frame holds only the differences: a process
+ * costs nothing unless it appeared, disappeared or changed, a number costs a byte when it
+ * changed a little, and a command is written when its process appears (or execs)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "record.h"
+#include "mem_info.h"
+#include "cpu_info.h"
+#include "process_info.h"
+
+// set by SIGINT and SIGTERM to stop the recording
+static volatile sig_atomic_t record_stop = 0;
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    record_stop = 1;
+}
+
+// makes room for n more bytes in the buffer
+static bool buf_reserve(struct rec_buf *b, size_t n)
+{
+    if (b->failed == true)
+    {
+        return false;
+    }
+    if (b->len + n <= b->size)
+    {
+        return true;
+    }
+    size_t size = (b->size > 0 ? b->size : 4096);
+    while (size < b->len + n)
+    {
+        size *= 2;
+    }
+    unsigned char *data = realloc(b->data, size);
+    if (data == NULL)
+    {
+        b->failed = true;
+        return false;
+    }
+    b->data = data;
+    b->size = size;
+    return true;
+}
+
+static void put_bytes(struct rec_buf *b, const void *bytes, size_t n)
+{
+    if (buf_reserve(b, n) == true)
+    {
+        memcpy(b->data + b->len, bytes, n);
+        b->len += n;
+    }
+}
+
+static void put_byte(struct rec_buf *b, unsigned char c)
+{
+    put_bytes(b, &c, 1);
+}
+
+// writes v in groups of 7 bits, the least significant first (the high bit is set on all but the last)
+static void put_varint(struct rec_buf *b, unsigned long long v)
+{
+    unsigned char bytes[10];
+    int n = 0;
+    while (v >= 0x80)
+    {
+        bytes[n++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    bytes[n++] = v;
+    put_bytes(b, bytes, n);
+}
+
+// writes a signed value with zigzag encoding, so that small negative values are short too
+static void put_svarint(struct rec_buf *b, long long v)
+{
+    put_varint(b, ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+}
+
+// writes a string as its length plus one (0 for NULL) followed by its bytes
+static void put_string(struct rec_buf *b, const char *s)
+{
+    if (s == NULL)
+    {
+        put_varint(b, 0);
+        return;
+    }
+    size_t len = strlen(s);
+    put_varint(b, len + 1);
+    put_bytes(b, s, len);
+}
+
+// a frame being decoded
+struct rec_reader
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    bool bad; ///< flag set if the frame ended early or has a value out of range
+};
+
+static unsigned long long get_varint(struct rec_reader *r)
+{
+    unsigned long long v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (r->p == r->end)
+        {
+            r->bad = true;
+            return 0;
+        }
+        unsigned char c = *r->p++;
+        v |= (unsigned long long)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+        {
+            return v;
+        }
+    }
+    r->bad = true;
+    return 0;
+}
+
+static long long get_svarint(struct rec_reader *r)
+{
+    unsigned long long v = get_varint(r);
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+static unsigned char get_byte(struct rec_reader *r)
+{
+    if (r->p == r->end)
+    {
+        r->bad = true;
+        return 0;
+    }
+    return *r->p++;
+}
+
+// reads a string written by put_string into a new allocation (NULL for a NULL string)
+static char *get_string(struct rec_reader *r)
+{
+    unsigned long long len = get_varint(r);
+    if (len == 0 || r->bad == true)
+    {
+        return NULL;
+    }
+    len--;
+    if (len > (unsigned long long)(r->end - r->p))
+    {
+        r->bad = true;
+        return NULL;
+    }
+    char *s = malloc(len + 1);
+    if (s == NULL)
+    {
+        r->bad = true;
+        return NULL;
+    }
+    memcpy(s, r->p, len);
+    s[len] = '\0';
+    r->p += len;
+    return s;
+}
+
+void rec_encoder_init(Rec_encoder_t *enc)
+{
+    memset(enc, 0, sizeof(Rec_encoder_t));
+    rec_state_init(&enc->prev);
+    enc->next = g_array_new(false, false, sizeof(struct rec_task));
+}
+
+void rec_encoder_free(Rec_encoder_t *enc)
+{
+    rec_state_free(&enc->prev);
+    g_array_free(enc->next, true);
+    free(enc->frame.data);
+    free(enc->removed.data);
+    free(enc->added.data);
+    free(enc->changed.data);
+}
+
+// the number of CPU percentages held by a state (none after it's emptied)
+static int state_nperc(const struct rec_state *s)
+{
+    return (s->perc != NULL ? (s->num_cores + 1) * CPU_NFIELDS : 0);
+}
+
+// compares two commands, either of which can be NULL
+static bool same_command(const char *a, const char *b)
+{
+    return (a == NULL || b == NULL ? a == b : strcmp(a, b) == 0);
+}
+
+// appends to enc->changed the fields of t that differ from old (at index idx of the frame)
+static void encode_task(Rec_encoder_t *enc, const struct rec_task *t, const struct rec_task *old, long idx,
+                        long *last_idx, unsigned long *num_changed)
+{
+    unsigned char mask = (t->ppid != old->ppid ? REC_PPID : 0) | (t->state != old->state ? REC_STATE : 0) |
+                         (t->cpu != old->cpu ? REC_CPU : 0) | (t->nice != old->nice ? REC_NICE : 0) |
+                         (t->num_threads != old->num_threads ? REC_THREADS : 0) |
+                         (t->virt_size_bytes != old->virt_size_bytes ? REC_VSIZE : 0) |
+                         (t->resident_set != old->resident_set ? REC_RSS : 0) |
+                         (same_command(t->command, old->command) == false ? REC_COMMAND : 0);
+    if (mask == 0)
+    {
+        return;
+    }
+    struct rec_buf *b = &enc->changed;
+    put_varint(b, idx - *last_idx);
+    *last_idx = idx;
+    put_byte(b, mask);
+    if (mask & REC_PPID)
+        put_svarint(b, (long long)t->ppid - old->ppid);
+    if (mask & REC_STATE)
+        put_byte(b, t->state);
+    if (mask & REC_CPU)
+        put_svarint(b, (long long)(t->cpu - old->cpu));
+    if (mask & REC_NICE)
+        put_svarint(b, t->nice - old->nice);
+    if (mask & REC_THREADS)
+        put_svarint(b, t->num_threads - old->num_threads);
+    if (mask & REC_VSIZE)
+        put_svarint(b, t->virt_size_bytes - old->virt_size_bytes);
+    if (mask & REC_RSS)
+        put_svarint(b, t->resident_set - old->resident_set);
+    if (mask & REC_COMMAND)
+        put_string(b, t->command);
+    (*num_changed)++;
+}
+
+// appends to enc->added a process that appeared (with its username, the first time its uid appears)
+static void encode_added(Rec_encoder_t *enc, const struct rec_task *t, int *last_pid)
+{
+    struct rec_buf *b = &enc->added;
+    put_varint(b, t->pid - *last_pid);
+    *last_pid = t->pid;
+    put_varint(b, t->start_time);
+    put_svarint(b, t->uid);
+    if (g_hash_table_contains(enc->prev.users, GINT_TO_POINTER(t->uid)) == false)
+    {
+        g_hash_table_insert(enc->prev.users, GINT_TO_POINTER(t->uid), NULL);
+        put_byte(b, 1);
+        put_string(b, t->username);
+    }
+    else
+    {
+        put_byte(b, 0);
+    }
+}
+
+// adds to the processes of the next frame a copy of t, taking the command of old if it's the same
+static void keep_task(Rec_encoder_t *enc, const struct rec_task *t, struct rec_task *old)
+{
+    struct rec_task copy = *t;
+    if (old != NULL && same_command(t->command, old->command) == true)
+    {
+        copy.command = old->command;
+        old->command = NULL;
+    }
+    else
+    {
+        copy.command = (t->command != NULL ? strdup(t->command) : NULL);
+    }
+    copy.username = NULL;
+    g_array_append_val(enc->next, copy);
+}
+
+/**
+ * \brief Encodes a tick against the previous one
+ *
+ * The processes of both ticks are merged by PID: the ones only in the previous tick are
+ * removed, the ones only in this tick are added (a PID with another start time is a new
+ * process), and the fields of every process of this tick are compared with the previous
+ * ones (with zeros for the ones added)
+ * \param [in,out] enc The encoder: its previous state becomes cur, and the payload is in enc->frame
+ * \param [in] cur The state of the tick, whose processes are sorted by PID
+ * \param [in] keyframe Flag set to encode against an empty state
+ * \return Returns false if the frame could not be allocated
+ */
+bool rec_encode(Rec_encoder_t *enc, const struct rec_state *cur, bool keyframe)
+{
+    struct rec_state *prev = &enc->prev;
+    if (keyframe == true)
+    {
+        rec_state_clear(prev);
+    }
+    struct rec_buf *b = &enc->frame;
+    b->len = 0;
+    put_svarint(b, cur->time_ms - prev->time_ms);
+    for (int i = 0; i < REC_MEM_FIELDS; i++)
+    {
+        put_svarint(b, cur->mem[i] - prev->mem[i]);
+    }
+    put_varint(b, cur->num_cores);
+    int nperc = (cur->num_cores + 1) * CPU_NFIELDS;
+    int prev_nperc = state_nperc(prev);
+    for (int i = 0; i < nperc; i++)
+    {
+        put_svarint(b, cur->perc[i] - (i < prev_nperc ? prev->perc[i] : 0));
+    }
+    for (int c = 0; c < cur->num_cores; c += 8)
+    {
+        unsigned char bits = 0;
+        for (int k = 0; k < 8 && c + k < cur->num_cores; k++)
+        {
+            bits |= (cur->online[c + k] == true ? 1 << k : 0);
+        }
+        put_byte(b, bits);
+    }
+    put_svarint(b, cur->procs_running - prev->procs_running);
+    put_svarint(b, cur->procs_blocked - prev->procs_blocked);
+    put_svarint(b, cur->ctxt - prev->ctxt);
+    put_svarint(b, cur->intr - prev->intr);
+    put_svarint(b, cur->forks - prev->forks);
+    if (keyframe == true)
+    {
+        put_string(b, cur->model);
+    }
+
+    // the processes: a merge of the previous ones and the current ones by PID
+    enc->removed.len = 0;
+    enc->added.len = 0;
+    enc->changed.len = 0;
+    g_array_set_size(enc->next, 0);
+    unsigned long num_removed = 0, num_added = 0, num_changed = 0;
+    int last_removed = 0, last_added = 0;
+    long last_idx = 0;
+    const struct rec_task zero = {0};
+    guint i = 0, j = 0;
+    while (i < prev->tasks->len || j < cur->tasks->len)
+    {
+        struct rec_task *old = (i < prev->tasks->len ? &g_array_index(prev->tasks, struct rec_task, i) : NULL);
+        const struct rec_task *t = (j < cur->tasks->len ? &g_array_index(cur->tasks, struct rec_task, j) : NULL);
+        if (old != NULL &&
+            (t == NULL || old->pid < t->pid || (old->pid == t->pid && old->start_time != t->start_time)))
+        {
+            // the process ended (if its PID was reused, the new process is added at the next step)
+            put_varint(&enc->removed, old->pid - last_removed);
+            last_removed = old->pid;
+            num_removed++;
+            i++;
+            continue;
+        }
+        if (old != NULL && old->pid == t->pid)
+        {
+            i++;
+        }
+        else
+        {
+            old = NULL;
+            encode_added(enc, t, &last_added);
+            num_added++;
+        }
+        encode_task(enc, t, (old != NULL ? old : &zero), j, &last_idx, &num_changed);
+        keep_task(enc, t, old);
+        j++;
+    }
+    put_varint(b, num_removed);
+    put_bytes(b, enc->removed.data, enc->removed.len);
+    put_varint(b, num_added);
+    put_bytes(b, enc->added.data, enc->added.len);
+    put_varint(b, num_changed);
+    put_bytes(b, enc->changed.data, enc->changed.len);
+
+    // this tick becomes the previous one: the commands not taken by keep_task() are freed
+    for (guint k = 0; k < prev->tasks->len; k++)
+    {
+        free(g_array_index(prev->tasks, struct rec_task, k).command);
+    }
+    GArray *tasks = prev->tasks;
+    prev->tasks = enc->next;
+    enc->next = tasks;
+    prev->time_ms = cur->time_ms;
+    memcpy(prev->mem, cur->mem, sizeof(prev->mem));
+    if (prev_nperc != nperc)
+    {
+        long long *perc = realloc(prev->perc, nperc * sizeof(long long));
+        bool *online = realloc(prev->online, (cur->num_cores > 0 ? cur->num_cores : 1) * sizeof(bool));
+        if (perc)
+            prev->perc = perc;
+        if (online)
+            prev->online = online;
+        if (perc == NULL || online == NULL)
+        {
+            return false;
+        }
+        prev->num_cores = cur->num_cores;
+    }
+    memcpy(prev->perc, cur->perc, nperc * sizeof(long long));
+    memcpy(prev->online, cur->online, cur->num_cores * sizeof(bool));
+    prev->procs_running = cur->procs_running;
+    prev->procs_blocked = cur->procs_blocked;
+    prev->ctxt = cur->ctxt;
+    prev->intr = cur->intr;
+    prev->forks = cur->forks;
+    return (b->failed == false && enc->removed.failed == false && enc->added.failed == false &&
+            enc->changed.failed == false);
+}
+
+/**
+ * \brief Decodes a frame written by rec_encode()
+ *
+ * \param [in,out] s The state of the previous frame, updated to the state of this one
+ * \param [in] payload The payload of the frame
+ * \param [in] len The length of the payload
+ * \param [in] keyframe Flag set if the frame is a keyframe (the state is emptied first)
+ * \return Returns false if the frame is corrupted (the state is then partially updated)
+ */
+bool rec_decode(struct rec_state *s, const unsigned char *payload, size_t len, bool keyframe)
+{
+    struct rec_reader r = {payload, payload + len, false};
+    if (keyframe == true)
+    {
+        rec_state_clear(s);
+    }
+    s->time_ms += get_svarint(&r);
+    for (int i = 0; i < REC_MEM_FIELDS; i++)
+    {
+        s->mem[i] += get_svarint(&r);
+    }
+    unsigned long long num_cores = get_varint(&r);
+    if (num_cores > 1 << 16 || r.bad == true)
+    {
+        return false;
+    }
+    int nperc = (num_cores + 1) * CPU_NFIELDS;
+    int prev_nperc = state_nperc(s);
+    if (prev_nperc != nperc)
+    {
+        long long *perc = realloc(s->perc, nperc * sizeof(long long));
+        bool *online = realloc(s->online, (num_cores > 0 ? num_cores : 1) * sizeof(bool));
+        if (perc)
+            s->perc = perc;
+        if (online)
+            s->online = online;
+        if (perc == NULL || online == NULL)
+        {
+            return false;
+        }
+        if (nperc > prev_nperc)
+        {
+            memset(s->perc + prev_nperc, 0, (nperc - prev_nperc) * sizeof(long long));
+        }
+        s->num_cores = num_cores;
+    }
+    for (int i = 0; i < nperc; i++)
+    {
+        s->perc[i] += get_svarint(&r);
+    }
+    for (int c = 0; c < s->num_cores; c += 8)
+    {
+        unsigned char bits = get_byte(&r);
+        for (int k = 0; k < 8 && c + k < s->num_cores; k++)
+        {
+            s->online[c + k] = (bits & (1 << k)) != 0;
+        }
+    }
+    s->procs_running += get_svarint(&r);
+    s->procs_blocked += get_svarint(&r);
+    s->ctxt += get_svarint(&r);
+    s->intr += get_svarint(&r);
+    s->forks += get_svarint(&r);
+    if (keyframe == true)
+    {
+        s->model = get_string(&r);
+    }
+
+    // the removed processes, by increasing PID
+    unsigned long long n = get_varint(&r);
+    long long removed = -1; // the next PID removed
+    if (n > 0)
+    {
+        removed = get_varint(&r);
+        n--;
+    }
+    guint kept = 0;
+    for (guint i = 0; i < s->tasks->len; i++)
+    {
+        struct rec_task *t = &g_array_index(s->tasks, struct rec_task, i);
+        if (removed == t->pid)
+        {
+            free(t->command);
+            removed = (n > 0 ? removed + (long long)get_varint(&r) : -1);
+            n = (n > 0 ? n - 1 : 0);
+            continue;
+        }
+        g_array_index(s->tasks, struct rec_task, kept++) = *t;
+    }
+    g_array_set_size(s->tasks, kept);
+    // a PID that was not in the list: the frame does not follow the state
+    if (removed != -1 || r.bad == true)
+    {
+        return false;
+    }
+
+    // the added processes, by increasing PID, merged with the others
+    n = get_varint(&r);
+    if (n > (unsigned long long)(r.end - r.p))
+    {
+        return false;
+    }
+    if (n > 0)
+    {
+        guint old_len = s->tasks->len;
+        g_array_set_size(s->tasks, old_len + n);
+        struct rec_task *ts = (struct rec_task *)s->tasks->data;
+        // the added processes are read into the end of the array, then merged from the back
+        long long pid = 0;
+        for (guint k = 0; k < n; k++)
+        {
+            struct rec_task *t = &ts[old_len + k];
+            memset(t, 0, sizeof(struct rec_task));
+            pid += get_varint(&r);
+            t->pid = pid;
+            t->start_time = get_varint(&r);
+            t->uid = get_svarint(&r);
+            if (get_byte(&r) == 1)
+            {
+                // a name is written once per keyframe: another one would leave the processes with a freed name
+                char *name = get_string(&r);
+                if (g_hash_table_contains(s->users, GINT_TO_POINTER(t->uid)) == false)
+                    g_hash_table_insert(s->users, GINT_TO_POINTER(t->uid), name);
+                else
+                    free(name);
+            }
+            t->username = g_hash_table_lookup(s->users, GINT_TO_POINTER(t->uid));
+        }
+        if (r.bad == true)
+        {
+            g_array_set_size(s->tasks, old_len);
+            return false;
+        }
+        struct rec_task *added = malloc(n * sizeof(struct rec_task));
+        if (added == NULL)
+        {
+            g_array_set_size(s->tasks, old_len);
+            return false;
+        }
+        memcpy(added, ts + old_len, n * sizeof(struct rec_task));
+        long a = n - 1, o = (long)old_len - 1;
+        for (long k = old_len + n - 1; k >= 0; k--)
+        {
+            if (a >= 0 && (o < 0 || added[a].pid > ts[o].pid))
+                ts[k] = added[a--];
+            else
+                ts[k] = ts[o--];
+        }
+        free(added);
+    }
+
+    // the fields that changed
+    n = get_varint(&r);
+    long idx = 0;
+    for (unsigned long long k = 0; k < n && r.bad == false; k++)
+    {
+        idx += get_varint(&r);
+        if (idx < 0 || idx >= (long)s->tasks->len)
+        {
+            return false;
+        }
+        struct rec_task *t = &g_array_index(s->tasks, struct rec_task, idx);
+        unsigned char mask = get_byte(&r);
+        if (mask & REC_PPID)
+            t->ppid += get_svarint(&r);
+        if (mask & REC_STATE)
+            t->state = get_byte(&r);
+        if (mask & REC_CPU)
+            t->cpu += get_svarint(&r);
+        if (mask & REC_NICE)
+            t->nice += get_svarint(&r);
+        if (mask & REC_THREADS)
+            t->num_threads += get_svarint(&r);
+        if (mask & REC_VSIZE)
+            t->virt_size_bytes += get_svarint(&r);
+        if (mask & REC_RSS)
+            t->resident_set += get_svarint(&r);
+        if (mask & REC_COMMAND)
+        {
+            free(t->command);
+            t->command = get_string(&r);
+        }
+    }
+    return (r.bad == false);
+}
+
+/**
+ * \brief Reads the header of the frame at r->p and the time delta it starts with
+ *
+ * \param [in,out] r The rest of the log (r->p is moved past the frame)
+ * \param [in] log The start of the log, the offsets of the frames are relative to
+ * \param [out] f The frame (its time is left to the caller)
+ * \param [out] delta The time of the frame, from the previous one (or absolute for a keyframe)
+ * \return Returns false if the frame is damaged or incomplete
+ */
+static bool read_frame(struct rec_reader *r, const unsigned char *log, struct rec_frame *f, long long *delta)
+{
+    unsigned char tag = get_byte(r);
+    unsigned long long payload_len = get_varint(r);
+    if ((tag != REC_KEYFRAME && tag != REC_DELTA) || r->bad == true ||
+        payload_len > (unsigned long long)(r->end - r->p))
+    {
+        return false;
+    }
+    f->offset = r->p - log;
+    f->len = payload_len;
+    f->keyframe = (tag == REC_KEYFRAME);
+    struct rec_reader payload = {r->p, r->p + payload_len, false};
+    *delta = get_svarint(&payload);
+    r->p += payload_len;
+    return (payload.bad == false);
+}
+
+/**
+ * \brief Truncates the log after its last complete frame
+ *
+ * A recording killed while writing a frame (or stopped by a full disk) leaves a partial
+ * frame at the end of the log, and the replay stops at a damaged frame: the frames of the
+ * recordings appended after it would not be reachable. So the damaged tail is cut before
+ * a recording is appended
+ * \param [in] fd The log, opened for writing and locked
+ * \param [in] path The name of the log, for the messages
+ * \param [in] len The size of the log
+ * \return Returns false if the log could not be read or truncated
+ */
+static bool truncate_damaged_tail(int fd, const char *path, size_t len)
+{
+    const unsigned char *log = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    if (log == MAP_FAILED)
+    {
+        perror(path);
+        return false;
+    }
+    struct rec_reader r = {log + REC_MAGICLEN, log + len, false};
+    const unsigned char *complete = r.p;
+    struct rec_frame f;
+    long long delta;
+    while (r.p < r.end && read_frame(&r, log, &f, &delta) == true)
+    {
+        complete = r.p;
+    }
+    size_t end = complete - log;
+    munmap((void *)log, len);
+    if (end == len)
+    {
+        return true;
+    }
+    fprintf(stderr, "%s: removing a damaged frame at the end (%zu bytes)\n", path, len - end);
+    if (ftruncate(fd, end) == -1)
+    {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Opens the log for appending, writing the magic bytes if it's new and checking them otherwise
+ *
+ * The log is locked while it's recorded, since the frames of two recordings interleaved
+ * could not be decoded; a damaged frame left at its end is removed first
+ * \param [in] path The name of the log
+ * \return Returns the file descriptor, or -1 on errors
+ */
+static int open_log(const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    char magic[REC_MAGICLEN];
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1)
+    {
+        fprintf(stderr, "%s is being recorded by another process\n", path);
+    }
+    else if (fstat(fd, &st) == -1)
+    {
+        perror(path);
+    }
+    else if (st.st_size == 0)
+    {
+        if (write(fd, REC_MAGIC, REC_MAGICLEN) == REC_MAGICLEN)
+        {
+            return fd;
+        }
+        perror(path);
+    }
+    else if (pread(fd, magic, REC_MAGICLEN, 0) == REC_MAGICLEN && memcmp(magic, REC_MAGIC, REC_MAGICLEN) == 0)
+    {
+        if (truncate_damaged_tail(fd, path, st.st_size) == true)
+        {
+            return fd;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Not a recording: %s\n", path);
+    }
+    close(fd);
+    return -1;
+}
+
+// appends the frame in enc->frame to the log with a single write (so that a crash leaves at most one partial frame)
+static bool write_frame(int fd, const struct rec_buf *frame, bool keyframe)
+{
+    struct rec_buf header = {0};
+    put_byte(&header, (keyframe == true ? REC_KEYFRAME : REC_DELTA));
+    put_varint(&header, frame->len);
+    if (header.failed == true)
+    {
+        return false;
+    }
+    struct iovec iov[2] = {{header.data, header.len}, {frame->data, frame->len}};
+    ssize_t n;
+    do
+    {
+        n = writev(fd, iov, 2);
+    } while (n == -1 && errno == EINTR);
+    free(header.data);
+    return (n == (ssize_t)(iov[0].iov_len + iov[1].iov_len));
+}
+
+/**
+ * \brief Runs the collectors in a loop, appending a frame per tick to the log
+ *
+ * The data is collected in this thread (no update thread is started) on absolute times of
+ * the monotonic clock, like the batch mode. The recording starts with a keyframe, so that
+ * a log can be appended to by several recordings
+ * \param [in,out] data The data structures filled by the collectors
+ * \param [in] opts The path of the log, the interval and the number of ticks
+ * \return Returns the exit status of the program: 0, or 1 if the log can't be written
+ */
+int run_record(struct taskmgr_data_t *data, const struct record_options *opts)
+{
+    int fd = open_log(opts->path);
+    if (fd == -1)
+    {
+        return 1;
+    }
+    struct sigaction sa = {.sa_handler = on_stop_signal};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    Rec_encoder_t enc;
+    rec_encoder_init(&enc);
+    struct rec_state cur;
+    rec_state_init(&cur);
+    long long interval_ns = (long long)(opts->interval * 1e9);
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    int ret = 0;
+    for (long tick = 0; (opts->count == 0 || tick < opts->count) && record_stop == 0; tick++)
+    {
+        if (tick > 0)
+        {
+            long long ns = next.tv_nsec + interval_ns;
+            next.tv_sec += ns / 1000000000LL;
+            next.tv_nsec = ns % 1000000000LL;
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec))
+            {
+                next = now;
+            }
+            // interrupted by the stop signals
+            if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR && record_stop == 1)
+            {
+                break;
+            }
+        }
+        get_mem_info(data->mem_stats);
+        get_cpu_info(data->cpu_stats);
+        get_processes_info(data->tasks, data->cpu_stats);
+        bool keyframe = (tick % REC_KEYFRAME_TICKS == 0);
+        if (rec_fill_state(&cur, data->mem_stats, data->cpu_stats, data->tasks) == false || rec_encode(&enc, &cur, keyframe) == false ||
+            write_frame(fd, &enc.frame, keyframe) == false)
+        {
+            perror(opts->path);
+            ret = 1;
+            break;
+        }
+    }
+    rec_state_release(&cur);
+    rec_encoder_free(&enc);
+    close(fd);
+    return ret;
+}
+
+/**
+ * \brief Lists the frames of a log
+ *
+ * Only the header of each frame and the first value of its payload (the time) are read.
+ * The frames before the first keyframe can't be decoded and are left out; the listing stops
+ * at the first frame that is damaged or incomplete (such as the last one, if the recording
+ * was killed while writing it: the next recording appended to the log removes it)
+ * \param [in] log The contents of the log, magic bytes included
+ * \param [in] len The length of the log
+ * \return Returns the frames (struct rec_frame), or NULL if the log has the wrong magic bytes
+ */
+GArray *rec_index_frames(const unsigned char *log, size_t len)
+{
+    if (len < REC_MAGICLEN || memcmp(log, REC_MAGIC, REC_MAGICLEN) != 0)
+    {
+        return NULL;
+    }
+    GArray *frames = g_array_new(false, false, sizeof(struct rec_frame));
+    struct rec_reader r = {log + REC_MAGICLEN, log + len, false};
+    long long time_ms = 0;
+    struct rec_frame f;
+    long long delta;
+    while (r.p < r.end && read_frame(&r, log, &f, &delta) == true)
+    {
+        time_ms = (f.keyframe == true ? delta : time_ms + delta);
+        f.time_ms = time_ms;
+        if (f.keyframe == true || frames->len > 0)
+        {
+            g_array_append_val(frames, f);
+        }
+    }
+    return frames;
+}
@@ -0,0 +1,150 @@
+/**
+ * \file record.h
+ * \brief Binary log of the collected data, written by the record mode and read back by the replay mode
+ *
+ * The log starts with REC_MAGIC and is followed by frames, one per tick. A frame is a tag
+ * (REC_KEYFRAME or REC_DELTA), the varint length of its payload and the payload. A delta
+ * frame encodes a tick against the previous one: numbers as zigzag varints of their
+ * difference, and only the processes that appeared, disappeared or changed. A keyframe is
+ * encoded the same way against an empty state, so that a reader can start from it: there is
+ * one every REC_KEYFRAME_TICKS frames and at the start of each recording appended to a log
+ */
+#ifndef RECORD_INCLUDED
+#define RECORD_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <glib.h>
+#include <pthread.h>
+
+#include "main.h"
+#include "snapshot.h"
+
+// the bytes a log starts with
+#define REC_MAGIC "SUMREC1\n"
+#define REC_MAGICLEN 8
+// the tag of a frame encoded against an empty state
+#define REC_KEYFRAME 'K'
+// the tag of a frame encoded against the previous one
+#define REC_DELTA 'D'
+// frames between two keyframes (the replay decodes at most this many frames to seek)
+#define REC_KEYFRAME_TICKS 300
+// longest wait between two frames in replay (a gap in the recording is skipped), in seconds
+#define REC_MAX_GAP 5.0
+// step of the seek keys of the replay, in seconds
+#define REC_SEEK_STEP 60.0
+// the fastest replay speed
+#define REC_MAX_SPEED 64.0
+
+// the flags of the fields of a process that changed since the previous frame
+enum rec_task_field
+{
+    REC_PPID = 1 << 0,
+    REC_STATE = 1 << 1,
+    REC_CPU = 1 << 2,
+    REC_NICE = 1 << 3,
+    REC_THREADS = 1 << 4,
+    REC_VSIZE = 1 << 5,
+    REC_RSS = 1 << 6,
+    REC_COMMAND = 1 << 7
+};
+
+// a byte buffer that grows as needed
+struct rec_buf
+{
+    unsigned char *data;
+    size_t len;
+    size_t size;
+    bool failed; ///< flag set if the buffer could not grow
+};
+
+/**
+ * \brief The state of the writer of a log
+ *
+ * The state being encoded borrows the strings of the TaskList; prev owns copies of the
+ * commands, made only when a process appears or changes its command
+ */
+typedef struct rec_encoder_t
+{
+    struct rec_state prev; ///< the state of the previous frame
+    GArray *next;          ///< the processes of the frame being encoded, with their own commands
+    struct rec_buf frame;  ///< the payload of the frame
+    // the lists of processes removed, added and changed, written to the frame after their lengths
+    struct rec_buf removed, added, changed;
+} Rec_encoder_t;
+
+// the options of the record mode, set from the command line
+struct record_options
+{
+    const char *path; ///< the log the frames are appended to
+    double interval;  ///< the interval between ticks (in seconds)
+    long count;       ///< the number of ticks (0 to run until killed)
+};
+
+// a frame of a log opened for replay
+struct rec_frame
+{
+    size_t offset;  ///< where the payload starts
+    size_t len;     ///< the length of the payload
+    long long time_ms;
+    bool keyframe;
+};
+
+/**
+ * \brief A log being replayed, and the commands of the user
+ *
+ * The log is mapped in memory and its frames are indexed when it's opened. The replay
+ * thread decodes the frames into state and copies it to the data structures of the
+ * windows; the keys pressed change paused, speed and seek_to, under mux_memdata
+ */
+typedef struct replay_t
+{
+    const unsigned char *map; ///< the log, mapped read-only
+    size_t map_len;
+    GArray *frames; ///< struct rec_frame, in file order
+    long pos;       ///< the frame shown (-1 before the first one)
+    struct rec_state state; ///< the state after the frame at pos
+    // commands, protected by mux_memdata
+    pthread_mutex_t mux_memdata;
+    pthread_cond_t cond_updating; ///< signaled when a command is given
+    bool paused;
+    double speed;
+    bool seeking;
+    long long seek_to_ms;
+    bool stop;
+    long shown_pos;     ///< the frame whose data is in the windows (copy of pos for the other threads)
+    long long shown_ms; ///< the time of that frame
+} Replay_t;
+
+// initializes an encoder, whose first frame must be a keyframe
+void rec_encoder_init(Rec_encoder_t *enc);
+void rec_encoder_free(Rec_encoder_t *enc);
+// encodes cur into enc->frame against the previous frame (or an empty state if keyframe)
+bool rec_encode(Rec_encoder_t *enc, const struct rec_state *cur, bool keyframe);
+// decodes a frame, updating the state (which is emptied first for a keyframe)
+bool rec_decode(struct rec_state *s, const unsigned char *payload, size_t len, bool keyframe);
+
+// copies a state to the data structures of the windows (reset restarts the histories and the rates)
+void rec_apply_state(struct taskmgr_data_t *ds, const struct rec_state *s, bool reset);
+
+// lists the complete frames of a log (struct rec_frame) from the first keyframe, stopping at a damaged one
+GArray *rec_index_frames(const unsigned char *log, size_t len);
+
+// appends a frame for every tick to opts->path, until opts->count ticks or a stop signal
+int run_record(struct taskmgr_data_t *data, const struct record_options *opts);
+
+// opens a log and indexes its frames
+Replay_t *replay_open(const char *path);
+// unmaps the log and frees the replay
+void replay_close(Replay_t *replay);
+// the thread that copies the frames to the data structures of the windows as the time passes
+void *replay_thread(void *all_ds);
+// pauses or resumes the replay
+void replay_toggle_pause(Replay_t *replay);
+// multiplies the speed of the replay by factor
+void replay_change_speed(Replay_t *replay, double factor);
+// moves the replay by delta seconds
+void replay_seek(Replay_t *replay, double delta);
+
+#endif
@@ -0,0 +1,410 @@
+/**
+ * \file replay.c
+ * \brief Implements the replay mode: the windows show the data of a recording instead of /proc
+ *
+ * The replay thread takes the place of the update threads: it decodes the frames of the log
+ * as their time comes (scaled by the speed) and copies them to the data structures of the
+ * windows, which are refreshed as usual. Seeking decodes from the closest keyframe before
+ * the target, so it costs at most REC_KEYFRAME_TICKS frames
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "record.h"
+#include "mem_info.h"
+#include "cpu_info.h"
+#include "process_info.h"
+#include "history.h"
+#include "freeze.h"
+
+Replay_t *replay_open(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        perror(path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0)
+    {
+        fprintf(stderr, "Not a recording: %s\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        perror(path);
+        return NULL;
+    }
+    GArray *frames = rec_index_frames(map, st.st_size);
+    if (frames == NULL || frames->len == 0)
+    {
+        fprintf(stderr, (frames == NULL ? "Not a recording: %s\n" : "No frames in %s\n"), path);
+        if (frames)
+            g_array_free(frames, true);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+    Replay_t *replay = calloc(1, sizeof(Replay_t));
+    replay->map = map;
+    replay->map_len = st.st_size;
+    replay->frames = frames;
+    replay->pos = -1;
+    replay->shown_pos = -1;
+    replay->speed = 1.0;
+    rec_state_init(&replay->state);
+    pthread_mutex_init(&replay->mux_memdata, NULL);
+    // the waits for the next frame are on the monotonic clock, like the rest of the timing
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&replay->cond_updating, &attr);
+    pthread_condattr_destroy(&attr);
+    return replay;
+}
+
+void replay_close(Replay_t *replay)
+{
+    rec_state_free(&replay->state);
+    g_array_free(replay->frames, true);
+    munmap((void *)replay->map, replay->map_len);
+    pthread_mutex_destroy(&replay->mux_memdata);
+    pthread_cond_destroy(&replay->cond_updating);
+    free(replay);
+}
+
+// the frame at index i
+#define replay_frame(replay, i) (&g_array_index((replay)->frames, struct rec_frame, (i)))
+
+// the last frame at or before time_ms (the first one if time_ms is before the recording)
+static long find_frame(const Replay_t *replay, long long time_ms)
+{
+    long lo = 0, hi = replay->frames->len;
+    while (lo < hi)
+    {
+        long mid = lo + (hi - lo) / 2;
+        if (replay_frame(replay, mid)->time_ms <= time_ms)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo > 0 ? lo - 1 : 0);
+}
+
+/**
+ * \brief Decodes the frames up to target into the state of the replay
+ *
+ * The frames after the one shown are decoded if there is no keyframe in between, otherwise
+ * the decoding starts from the last keyframe before target. A damaged frame ends the
+ * recording: it and the ones after it are dropped
+ * \param [in,out] replay The replay
+ * \param [in] target The index of the frame to show
+ * \return Returns false if no frame could be decoded
+ */
+static bool goto_frame(Replay_t *replay, long target)
+{
+    long key = target;
+    while (key > 0 && replay_frame(replay, key)->keyframe == false)
+    {
+        key--;
+    }
+    long from = (replay->pos >= key && replay->pos < target ? replay->pos + 1 : key);
+    for (long f = from; f <= target; f++)
+    {
+        const struct rec_frame *frame = replay_frame(replay, f);
+        if (rec_decode(&replay->state, replay->map + frame->offset, frame->len, frame->keyframe) == false)
+        {
+            g_array_set_size(replay->frames, f);
+            replay->pos = -1;
+            return (f > 0 ? goto_frame(replay, f - 1) : false);
+        }
+    }
+    replay->pos = target;
+    return true;
+}
+
+// copies a state (decoded from a recording, or read from a collector) to the data structures of the windows
+void rec_apply_state(struct taskmgr_data_t *ds, const struct rec_state *s, bool reset)
+{
+    double now = s->time_ms / 1000.0;
+
+    Mem_data_t *mem = ds->mem_stats;
+    pthread_mutex_lock(&mem->mux_memdata);
+    while (mem->is_busy == true)
+    {
+        pthread_cond_wait(&mem->cond_updating, &mem->mux_memdata);
+    }
+    mem->is_busy = true;
+    mem->total_mem = s->mem[0];
+    mem->free_mem = s->mem[1];
+    mem->avail_mem = s->mem[2];
+    mem->buffer_cached = s->mem[3];
+    mem->swp_tot = s->mem[4];
+    mem->swp_free = s->mem[5];
+    if (reset == true)
+    {
+        // the sparklines restart from the new position
+        history_init(&mem->ram_hist);
+        history_init(&mem->swp_hist);
+    }
+    if (mem->total_mem > 0)
+    {
+        history_append(&mem->ram_hist, 100.0 - (mem->avail_mem * 100.0) / mem->total_mem, now);
+        history_append(&mem->swp_hist, (mem->swp_tot > 0 ? 100.0 - (mem->swp_free * 100.0) / mem->swp_tot : 0),
+                       now);
+    }
+    mem->is_busy = false;
+    pthread_cond_signal(&mem->cond_updating);
+    pthread_mutex_unlock(&mem->mux_memdata);
+
+    CPU_data_t *cpu = ds->cpu_stats;
+    pthread_mutex_lock(&cpu->mux_memdata);
+    while (cpu->is_busy == true)
+    {
+        pthread_cond_wait(&cpu->cond_updating, &cpu->mux_memdata);
+    }
+    cpu->is_busy = true;
+    if (cpu->num_cores != s->num_cores)
+    {
+        struct core_data_t *percore = realloc(cpu->percore, (s->num_cores > 0 ? s->num_cores : 1) *
+                                                                sizeof(struct core_data_t));
+        if (percore)
+        {
+            cpu->percore = percore;
+            memset(percore, 0, s->num_cores * sizeof(struct core_data_t));
+            cpu->num_cores = s->num_cores;
+        }
+    }
+    if (s->model != NULL && (cpu->model == NULL || strcmp(cpu->model, s->model) != 0))
+    {
+        free(cpu->model);
+        cpu->model = strdup(s->model);
+    }
+    for (int f = 0; f < CPU_NFIELDS; f++)
+    {
+        cpu->total.perc[f] = s->perc[f] / 10.0;
+        for (int c = 0; c < cpu->num_cores; c++)
+        {
+            cpu->percore[c].perc[f] = s->perc[(c + 1) * CPU_NFIELDS + f] / 10.0;
+        }
+    }
+    for (int c = 0; c < cpu->num_cores; c++)
+    {
+        cpu->percore[c].online = s->online[c];
+    }
+    cpu->procs_running = s->procs_running;
+    cpu->procs_blocked = s->procs_blocked;
+    if (reset == true)
+    {
+        // no rate across a seek
+        memset(&cpu->ctxt, 0, sizeof(struct counter));
+        memset(&cpu->intr, 0, sizeof(struct counter));
+        memset(&cpu->forks, 0, sizeof(struct counter));
+        history_init(&cpu->usage_hist);
+    }
+    counter_update(&cpu->ctxt, s->ctxt, now);
+    counter_update(&cpu->intr, s->intr, now);
+    counter_update(&cpu->forks, s->forks, now);
+    history_append(&cpu->usage_hist, 100.0 - cpu->total.perc[CPU_IDLE] - cpu->total.perc[CPU_IOWAIT], now);
+    cpu->is_busy = false;
+    pthread_cond_signal(&cpu->cond_updating);
+    pthread_mutex_unlock(&cpu->mux_memdata);
+
+    TaskList *tasks = ds->tasks;
+    pthread_mutex_lock(&tasks->mux_memdata);
+    while (tasks->is_busy == true)
+    {
+        pthread_cond_wait(&tasks->cond_updating, &tasks->mux_memdata);
+    }
+    tasks->is_busy = true;
+    // the processes highlighted by a search stay highlighted
+    GArray *highlighted = g_array_new(false, false, sizeof(int));
+    for (long h = 0; h < tasks->num_ps; h++)
+    {
+        if (task_at(tasks, h)->highlight == true)
+        {
+            g_array_append_val(highlighted, tasks->cols.pid[h]);
+        }
+    }
+    str_arena_begin(&tasks->strings);
+    reset_tasks(tasks);
+    for (guint i = 0; i < s->tasks->len; i++)
+    {
+        const struct rec_task *rt = &g_array_index(s->tasks, struct rec_task, i);
+        Task t;
+        memset(&t, 0, sizeof(Task));
+        t.visible = true;
+        t.present = true;
+        t.pid = rt->pid;
+        t.userid = rt->uid;
+        t.nice = rt->nice;
+        t.start_time = rt->start_time;
+        // the fields that are not recorded are left unread (t.extra is 0), so they're shown as "-"
+        if (rt->command != NULL)
+        {
+            t.command = str_arena_strdup(&tasks->strings, rt->command);
+        }
+        // the usernames of the recording replace the ones of this machine
+        gpointer name = NULL;
+        if (g_hash_table_lookup_extended(tasks->usernames, GINT_TO_POINTER(rt->uid), NULL, &name) == false ||
+            (name == NULL ? rt->username != NULL : rt->username == NULL || strcmp(name, rt->username) != 0))
+        {
+            name = (rt->username != NULL ? strdup(rt->username) : NULL);
+            g_hash_table_replace(tasks->usernames, GINT_TO_POINTER(rt->uid), name);
+        }
+        t.username = name;
+        struct task_stat st = {rt->pid, rt->ppid, rt->state, rt->cpu, rt->nice, rt->num_threads,
+                               rt->virt_size_bytes, rt->resident_set, rt->start_time};
+        add_task(tasks, &t, &st);
+    }
+    str_arena_reclaim(&tasks->strings);
+    // the processes were added by increasing PID, so their handles are in PID order
+    for (guint i = 0; i < highlighted->len; i++)
+    {
+        int pid = g_array_index(highlighted, int, i);
+        long lo = 0, hi = tasks->num_ps;
+        while (lo < hi)
+        {
+            long mid = lo + (hi - lo) / 2;
+            if (tasks->cols.pid[mid] < pid)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < tasks->num_ps && tasks->cols.pid[lo] == pid)
+        {
+            task_at(tasks, lo)->highlight = true;
+        }
+    }
+    g_array_free(highlighted, true);
+    if (tasks->cursor_start >= tasks->num_ps)
+    {
+        tasks->cursor_start = (tasks->num_ps > 0 ? tasks->num_ps - 1 : 0);
+    }
+    freeze_update(ds->freeze, tasks);
+    tasks->is_busy = false;
+    pthread_cond_signal(&tasks->cond_updating);
+    pthread_mutex_unlock(&tasks->mux_memdata);
+}
+
+/**
+ * \brief This is the function executed by the thread that replays a recording
+ *
+ * It waits for the time of the next frame (the gap between the recorded times, divided by
+ * the speed and capped at REC_MAX_GAP), or for a command of the user, then decodes the frame
+ * and copies it to the data structures of the windows. At the end of the recording, or
+ * while paused, it waits for a command
+ */
+void *replay_thread(void *all_ds)
+{
+    struct taskmgr_data_t *ds = (struct taskmgr_data_t *)all_ds;
+    Replay_t *replay = ds->replay;
+    double last_frame = history_now(); // when the frame shown was applied
+
+    while (1)
+    {
+        long target;
+        bool seek = false;
+        pthread_mutex_lock(&replay->mux_memdata);
+        while (1)
+        {
+            if (replay->stop == true)
+            {
+                pthread_mutex_unlock(&replay->mux_memdata);
+                return (void *)0;
+            }
+            if (replay->seeking == true)
+            {
+                target = find_frame(replay, replay->seek_to_ms);
+                replay->seeking = false;
+                seek = true;
+                break;
+            }
+            if (replay->pos < 0)
+            {
+                target = 0;
+                break;
+            }
+            if (replay->paused == true || replay->pos + 1 >= (long)replay->frames->len)
+            {
+                pthread_cond_wait(&replay->cond_updating, &replay->mux_memdata);
+                continue;
+            }
+            double gap = (replay_frame(replay, replay->pos + 1)->time_ms - replay_frame(replay, replay->pos)->time_ms) /
+                         1000.0;
+            gap = (gap < 0 ? 0 : (gap > REC_MAX_GAP ? REC_MAX_GAP : gap));
+            double due = last_frame + gap / replay->speed;
+            if (history_now() >= due)
+            {
+                target = replay->pos + 1;
+                break;
+            }
+            struct timespec deadline = {(time_t)due, (long)((due - (time_t)due) * 1e9)};
+            pthread_cond_timedwait(&replay->cond_updating, &replay->mux_memdata, &deadline);
+        }
+        pthread_mutex_unlock(&replay->mux_memdata);
+
+        // only this thread moves pos and decodes into the state, so this is done without the lock
+        if (goto_frame(replay, target) == true)
+        {
+            rec_apply_state(ds, &replay->state, (seek == true || target == 0));
+        }
+        last_frame = history_now();
+        pthread_mutex_lock(&replay->mux_memdata);
+        replay->shown_pos = replay->pos;
+        replay->shown_ms = replay->state.time_ms;
+        pthread_mutex_unlock(&replay->mux_memdata);
+
+        // a seek is shown right away, unless the refresh timer is stopped (the menu is shown)
+        struct itimerspec curr;
+        if (seek == true && timer_gettime(ds->refresh_timer, &curr) == 0 &&
+            (curr.it_value.tv_sec != 0 || curr.it_value.tv_nsec != 0))
+        {
+            kill(getpid(), SIGALRM);
+        }
+    }
+    return (void *)0;
+}
+
+void replay_toggle_pause(Replay_t *replay)
+{
+    pthread_mutex_lock(&replay->mux_memdata);
+    replay->paused = (replay->paused == true ? false : true);
+    pthread_cond_signal(&replay->cond_updating);
+    pthread_mutex_unlock(&replay->mux_memdata);
+}
+
+void replay_change_speed(Replay_t *replay, double factor)
+{
+    pthread_mutex_lock(&replay->mux_memdata);
+    replay->speed *= factor;
+    if (replay->speed > REC_MAX_SPEED)
+        replay->speed = REC_MAX_SPEED;
+    if (replay->speed < 1.0 / REC_MAX_SPEED)
+        replay->speed = 1.0 / REC_MAX_SPEED;
+    pthread_cond_signal(&replay->cond_updating);
+    pthread_mutex_unlock(&replay->mux_memdata);
+}
+
+void replay_seek(Replay_t *replay, double delta)
+{
+    pthread_mutex_lock(&replay->mux_memdata);
+    // seeks pressed before the thread got to the previous one add up
+    long long from = (replay->seeking == true ? replay->seek_to_ms : replay->shown_ms);
+    replay->seek_to_ms = from + (long long)(delta * 1000);
+    replay->seeking = true;
+    pthread_cond_signal(&replay->cond_updating);
+    pthread_mutex_unlock(&replay->mux_memdata);
+}
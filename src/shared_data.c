@@ -0,0 +1,70 @@
+/**
+ * \file shared_data.c
+ * \brief Allocates and frees the data structures shared by the collectors and the windows
+ */
+#include <stdlib.h>
+
+#include <pthread.h>
+
+#include "mem_info.h"
+#include "cpu_info.h"
+#include "process_info.h"
+#include "psi_info.h"
+#include "numa_info.h"
+#include "freeze.h"
+
+#include "main.h"
+
+/**
+ * \brief Allocates and initializes the data structures filled by the collectors
+ *
+ * The fields about windows and the refresh timer are left to the caller
+ * \param [out] sd The data shared by the threads
+ * \param [in] cmdline_cap The number of characters of the command lines displayed
+ */
+void init_shared_data(struct taskmgr_data_t *sd, long cmdline_cap)
+{
+    // scaling is activated by default
+    sd->rawdata = 1;
+    // sparklines show the finest resolution by default
+    sd->history_level = 0;
+    // the other fields of /proc/meminfo are hidden by default
+    sd->show_meminfo = false;
+    sd->show_numa = false;
+    sd->show_vmstat = false;
+    sd->replay = NULL;
+    sd->attach = NULL;
+
+    // the data structures of memory, CPU and processes (see libsummer-collect)
+    sd->mem_stats = mem_data_new();
+    sd->cpu_stats = cpu_data_new();
+    sd->tasks = tasklist_new(cmdline_cap);
+    // the process list is live until it's frozen
+    sd->freeze = freeze_new();
+
+    // And for pressure stall information, with its triggers
+    sd->psi_stats = calloc(1, sizeof(PSI_data_t));
+    psi_triggers_open(sd->psi_stats);
+    pthread_mutex_init(&sd->psi_stats->mux_memdata, NULL);
+    pthread_cond_init(&sd->psi_stats->cond_updating, NULL);
+
+    // And for the NUMA topology, read once here and then again only on hotplug events
+    sd->numa_stats = calloc(1, sizeof(NUMA_data_t));
+    numa_hotplug_open(sd->numa_stats);
+    numa_topology_init(sd->numa_stats);
+    pthread_mutex_init(&sd->numa_stats->mux_memdata, NULL);
+    pthread_cond_init(&sd->numa_stats->cond_updating, NULL);
+}
+
+// closes the files and frees the data structures allocated by init_shared_data()
+void free_shared_data(struct taskmgr_data_t *sd)
+{
+    mem_data_free(sd->mem_stats);
+    cpu_data_free(sd->cpu_stats);
+    freeze_free(sd->freeze);
+    tasklist_free(sd->tasks);
+    psi_close(sd->psi_stats);
+    free(sd->psi_stats);
+    numa_close(sd->numa_stats);
+    free(sd->numa_stats);
+}
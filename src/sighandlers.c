@@ -14,6 +14,7 @@
 #include "mem_info.h"
 #include "cpu_info.h"
 #include "process_info.h"
+#include "psi_info.h"
 
 #include "main.h"
 
@@ -24,14 +25,33 @@
  * the calls to the functions that update and display the contents of the memory, cpu
  * and process list windows
  */
-void alarm_handler(WINDOW *memwin, Mem_data_t *mem_stats,
-                   WINDOW *cpuwin, CPU_data_t *cpu_stats,
-                   WINDOW *procwin, TaskList *tasks,
-                   int flag_rawdata)
+void alarm_handler(struct taskmgr_data_t *data)
 {
-    mem_window_update(memwin, mem_stats, flag_rawdata);
-    cpu_window_update(cpuwin, cpu_stats);
-    proc_window_update(procwin, tasks);
+    mem_window_update(data->memwin, data->mem_stats, data->rawdata, data->history_level, data->show_meminfo,
+                      (data->show_vmstat == true ? data->cpu_stats : NULL));
+    if (data->replay != NULL)
+    {
+        replay_window_update(data->psiwin, data->replay);
+    }
+    else if (data->attach != NULL)
+    {
+        attach_window_update(data->psiwin, data->attach);
+    }
+    else
+    {
+        psi_window_update(data->psiwin, data->psi_stats);
+    }
+    cpu_window_update(data->cpuwin, data->cpu_stats, data->history_level,
+                      (data->show_numa == true ? data->numa_stats : NULL));
+    // a frozen list is drawn from its snapshot, while the data is still collected
+    if (freeze_sync(data->freeze, data->tasks) == true)
+    {
+        frozen_window_update(data->procwin, data->freeze, data->tasks);
+    }
+    else
+    {
+        proc_window_update(data->procwin, data->tasks);
+    }
 }
 
 void *signal_thread(void *param)
@@ -53,10 +73,7 @@ void *signal_thread(void *param)
         }
         if (delivered_sig == SIGALRM)
         {
-            alarm_handler(data->memwin, data->mem_stats,
-                          data->cpuwin, data->cpu_stats,
-                          data->procwin, data->tasks,
-                          data->rawdata);
+            alarm_handler(data);
         }
     }
     return (void *)0;
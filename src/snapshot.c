@@ -0,0 +1,299 @@
+/**
+ * \file snapshot.c
+ * \brief Implements the states of the system at a tick
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "snapshot.h"
+#include "mem_info.h"
+#include "cpu_info.h"
+#include "process_info.h"
+
+void rec_state_init(struct rec_state *s)
+{
+    memset(s, 0, sizeof(struct rec_state));
+    s->tasks = g_array_new(false, false, sizeof(struct rec_task));
+    s->users = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free);
+}
+
+void rec_state_clear(struct rec_state *s)
+{
+    for (guint i = 0; i < s->tasks->len; i++)
+    {
+        free(g_array_index(s->tasks, struct rec_task, i).command);
+    }
+    g_array_set_size(s->tasks, 0);
+    g_hash_table_remove_all(s->users);
+    free(s->perc);
+    free(s->online);
+    free(s->model);
+    GArray *tasks = s->tasks;
+    GHashTable *users = s->users;
+    memset(s, 0, sizeof(struct rec_state));
+    s->tasks = tasks;
+    s->users = users;
+}
+
+void rec_state_free(struct rec_state *s)
+{
+    rec_state_clear(s);
+    g_array_free(s->tasks, true);
+    g_hash_table_destroy(s->users);
+}
+
+// copies the processes into a state in PID order (their strings are borrowed from the TaskList)
+static void fill_tasks(struct rec_state *cur, TaskList *tasks)
+{
+    g_array_sort_with_data(tasks->order, cmp_pid_incr, tasks);
+    g_array_set_size(cur->tasks, tasks->num_ps);
+    for (long i = 0; i < tasks->num_ps; i++)
+    {
+        guint h = task_handle(tasks, i);
+        Task *p = task_at(tasks, h);
+        struct rec_task *t = &g_array_index(cur->tasks, struct rec_task, i);
+        t->pid = tasks->cols.pid[h];
+        t->ppid = tasks->cols.ppid[h];
+        t->state = tasks->cols.state[h];
+        t->cpu = tasks->cols.cpu[h];
+        t->nice = p->nice;
+        t->num_threads = tasks->cols.num_threads[h];
+        t->virt_size_bytes = tasks->cols.virt_size_bytes[h];
+        t->resident_set = tasks->cols.resident_set[h];
+        t->start_time = p->start_time;
+        t->uid = p->userid;
+        t->username = p->username;
+        t->command = p->command;
+    }
+}
+
+/**
+ * \brief Copies the data collected at a tick into a state
+ *
+ * The processes are sorted by PID, moving the handles of the TaskList. The commands, the
+ * usernames and the model of the CPU are borrowed: they are valid until the next scan
+ * \param [out] cur The state, whose arrays are reused
+ * \param [in] mem The memory data
+ * \param [in] cpu The CPU data
+ * \param [in,out] tasks The processes
+ * \return Returns false if the arrays of the state could not grow
+ */
+bool rec_fill_state(struct rec_state *cur, const Mem_data_t *mem, const CPU_data_t *cpu, TaskList *tasks)
+{
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    cur->time_ms = wall.tv_sec * 1000LL + wall.tv_nsec / 1000000;
+    cur->mem[0] = mem->total_mem;
+    cur->mem[1] = mem->free_mem;
+    cur->mem[2] = mem->avail_mem;
+    cur->mem[3] = mem->buffer_cached;
+    cur->mem[4] = mem->swp_tot;
+    cur->mem[5] = mem->swp_free;
+
+    if (cur->num_cores != cpu->num_cores)
+    {
+        long long *perc = realloc(cur->perc, (cpu->num_cores + 1) * CPU_NFIELDS * sizeof(long long));
+        bool *online = realloc(cur->online, cpu->num_cores * sizeof(bool));
+        if (perc)
+            cur->perc = perc;
+        if (online)
+            cur->online = online;
+        if (perc == NULL || online == NULL)
+        {
+            return false;
+        }
+        cur->num_cores = cpu->num_cores;
+    }
+    for (int f = 0; f < CPU_NFIELDS; f++)
+    {
+        // tenths of percent, as precise as the windows show them
+        cur->perc[f] = lroundf(cpu->total.perc[f] * 10);
+        for (int c = 0; c < cpu->num_cores; c++)
+        {
+            cur->perc[(c + 1) * CPU_NFIELDS + f] = lroundf(cpu->percore[c].perc[f] * 10);
+        }
+    }
+    for (int c = 0; c < cpu->num_cores; c++)
+    {
+        cur->online[c] = cpu->percore[c].online;
+    }
+    cur->procs_running = cpu->procs_running;
+    cur->procs_blocked = cpu->procs_blocked;
+    cur->ctxt = cpu->ctxt.curr;
+    cur->intr = cpu->intr.curr;
+    cur->forks = cpu->forks.curr;
+    cur->model = cpu->model;
+
+    fill_tasks(cur, tasks);
+    return true;
+}
+
+void rec_state_release(struct rec_state *s)
+{
+    g_array_set_size(s->tasks, 0);
+    s->model = NULL;
+    rec_state_free(s);
+}
+
+// tells whether two strings (either can be NULL) are equal
+static bool same_string(const char *a, const char *b)
+{
+    return (a == NULL || b == NULL ? a == b : strcmp(a, b) == 0);
+}
+
+// tells whether a process of a snapshot is still the one with handle h, unchanged
+static bool same_task(const struct rec_task *t, TaskList *tasks, guint h)
+{
+    const struct task_columns *c = &tasks->cols;
+    const Task *p = task_at(tasks, h);
+    return (t->pid == c->pid[h] && t->start_time == p->start_time && t->ppid == c->ppid[h] && t->state == c->state[h] &&
+            t->cpu == c->cpu[h] && t->nice == p->nice && t->num_threads == c->num_threads[h] &&
+            t->virt_size_bytes == c->virt_size_bytes[h] && t->resident_set == c->resident_set[h] &&
+            t->uid == p->userid && same_string(t->username, p->username) && same_string(t->command, p->command));
+}
+
+// a reference-counted copy of s (can be NULL): the one in old is shared if it's equal
+static char *share_string(char *old, const char *s)
+{
+    if (s == NULL)
+    {
+        return NULL;
+    }
+    return (old != NULL && strcmp(old, s) == 0 ? g_ref_string_acquire(old) : g_ref_string_new(s));
+}
+
+/**
+ * \brief Copies the process with handle h into a new record of a snapshot
+ * \param [in] tasks The processes
+ * \param [in] h The handle of the process
+ * \param [in] old The same process in the previous snapshot, whose strings are shared if they didn't change (can be NULL)
+ * \return Returns the record, with a reference, or NULL if it could not be allocated
+ */
+static struct snapshot_task *new_snapshot_task(TaskList *tasks, guint h, const struct rec_task *old)
+{
+    struct snapshot_task *st = malloc(sizeof(struct snapshot_task));
+    if (st == NULL)
+    {
+        return NULL;
+    }
+    atomic_init(&st->refs, 1);
+    const Task *p = task_at(tasks, h);
+    struct rec_task *t = &st->t;
+    t->pid = tasks->cols.pid[h];
+    t->ppid = tasks->cols.ppid[h];
+    t->state = tasks->cols.state[h];
+    t->cpu = tasks->cols.cpu[h];
+    t->nice = p->nice;
+    t->num_threads = tasks->cols.num_threads[h];
+    t->virt_size_bytes = tasks->cols.virt_size_bytes[h];
+    t->resident_set = tasks->cols.resident_set[h];
+    t->start_time = p->start_time;
+    t->uid = p->userid;
+    t->command = share_string(old != NULL ? old->command : NULL, p->command);
+    t->username = share_string(old != NULL ? (char *)old->username : NULL, p->username);
+    return st;
+}
+
+// releases a reference to a record of a snapshot, freeing it (and releasing its strings) with the last one
+static void snapshot_task_unref(struct snapshot_task *st)
+{
+    if (atomic_fetch_sub_explicit(&st->refs, 1, memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+    if (st->t.command != NULL)
+        g_ref_string_release(st->t.command);
+    if (st->t.username != NULL)
+        g_ref_string_release((char *)st->t.username);
+    free(st);
+}
+
+/**
+ * \brief Takes an immutable snapshot of the processes
+ *
+ * The processes are listed in PID order, and merged in a single pass with those of the
+ * previous snapshot (sorted the same way): a process whose fields, command and username are
+ * all unchanged is shared with it (its record takes another reference), so that only the
+ * processes that started or changed are copied. The strings of a process that changed are
+ * shared too, if they didn't. The handles of the TaskList are left as they are: their PID
+ * order is sorted in a separate array. Reading the TaskList, the caller must hold its lock
+ * \param [in] tasks The processes
+ * \param [in] prev The previous snapshot (NULL to copy every process)
+ * \param [in,out] handles The array the handles are sorted in (guint), kept by the caller across snapshots
+ * \return Returns the snapshot, with a reference owned by the caller, or NULL if it could not be allocated
+ */
+Snapshot_t *snapshot_take(TaskList *tasks, const Snapshot_t *prev, GArray *handles)
+{
+    Snapshot_t *snap = calloc(1, sizeof(Snapshot_t));
+    if (snap == NULL)
+    {
+        return NULL;
+    }
+    atomic_init(&snap->refs, 1);
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    snap->time_ms = wall.tv_sec * 1000LL + wall.tv_nsec / 1000000;
+    snap->tasks = g_array_sized_new(false, false, sizeof(struct snapshot_task *), tasks->num_ps);
+
+    g_array_set_size(handles, tasks->num_ps);
+    for (long i = 0; i < tasks->num_ps; i++)
+    {
+        g_array_index(handles, guint, i) = task_handle(tasks, i);
+    }
+    g_array_sort_with_data(handles, cmp_pid_incr, tasks);
+    guint j = 0;
+    guint prev_len = (prev != NULL ? prev->tasks->len : 0);
+    for (long i = 0; i < tasks->num_ps; i++)
+    {
+        guint h = g_array_index(handles, guint, i);
+        int pid = tasks->cols.pid[h];
+        // the processes of the previous snapshot that ended are skipped
+        while (j < prev_len && snapshot_task(prev, j)->pid < pid)
+        {
+            j++;
+        }
+        struct snapshot_task *old = NULL;
+        if (j < prev_len && snapshot_task(prev, j)->pid == pid &&
+            snapshot_task(prev, j)->start_time == task_at(tasks, h)->start_time)
+        {
+            old = g_array_index(prev->tasks, struct snapshot_task *, j);
+        }
+        struct snapshot_task *st;
+        if (old != NULL && same_task(&old->t, tasks, h) == true)
+        {
+            atomic_fetch_add_explicit(&old->refs, 1, memory_order_relaxed);
+            st = old;
+        }
+        else if ((st = new_snapshot_task(tasks, h, (old != NULL ? &old->t : NULL))) == NULL)
+        {
+            snapshot_unref(snap);
+            return NULL;
+        }
+        g_array_append_val(snap->tasks, st);
+    }
+    return snap;
+}
+
+Snapshot_t *snapshot_ref(Snapshot_t *snap)
+{
+    atomic_fetch_add_explicit(&snap->refs, 1, memory_order_relaxed);
+    return snap;
+}
+
+void snapshot_unref(Snapshot_t *snap)
+{
+    if (snap == NULL || atomic_fetch_sub_explicit(&snap->refs, 1, memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+    // the processes shared with another snapshot stay with it
+    for (guint i = 0; i < snap->tasks->len; i++)
+    {
+        snapshot_task_unref(g_array_index(snap->tasks, struct snapshot_task *, i));
+    }
+    g_array_free(snap->tasks, true);
+    free(snap);
+}
@@ -0,0 +1,95 @@
+/**
+ * \file snapshot.h
+ * \brief The state of the system at a tick, as recorded, published by the daemon and returned by libsummer-collect
+ *
+ * A state holds the memory summary, the CPU usage and the processes, sorted by PID. Its
+ * commands are owned by the state when it's decoded from a log, or borrowed from the
+ * TaskList when it's filled from the collectors (see rec_fill_state()). A Snapshot_t holds
+ * the processes at an update and doesn't change once taken: it's shared by reference among
+ * the threads reading it, and shares with the previous snapshot the processes that didn't
+ * change since
+ */
+#ifndef SNAPSHOT_INCLUDED
+#define SNAPSHOT_INCLUDED
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include <glib.h>
+
+#include "common.h"
+
+// the fields of /proc/meminfo recorded (total, free, available, buffers and cache, swap total and free)
+#define REC_MEM_FIELDS 6
+
+// a process as recorded
+struct rec_task
+{
+    int pid;
+    int ppid;
+    char state;
+    unsigned long cpu; // the CPU usage since the previous update, in percent of one core
+    long nice;
+    long num_threads;
+    long virt_size_bytes;
+    long resident_set;
+    unsigned long long start_time; ///< with the PID it identifies the process
+    int uid;
+    const char *username; ///< not owned (it's in the usernames of the TaskList or of the state)
+    char *command;        ///< owned by the state (NULL if the process has none)
+};
+
+// the system at a tick, as recorded
+struct rec_state
+{
+    long long time_ms;            ///< the time of the tick (milliseconds since the epoch)
+    long long mem[REC_MEM_FIELDS]; ///< kB
+    int num_cores;
+    long long *perc;           ///< the CPU percentages in tenths: CPU_NFIELDS of the total, then of each core
+    bool *online;              ///< the cores online
+    long long procs_running;
+    long long procs_blocked;
+    long long ctxt;  ///< context switches since boot
+    long long intr;  ///< interrupts since boot
+    long long forks; ///< processes created since boot
+    char *model;     ///< the model of the CPU (written in keyframes only, not owned by a state being encoded)
+    GArray *tasks;   ///< the processes (struct rec_task), sorted by PID
+    GHashTable *users; ///< the usernames (or NULL) written or read since the last keyframe, by uid
+};
+
+// a process in a snapshot, shared by the consecutive snapshots in which it didn't change
+struct snapshot_task
+{
+    atomic_int refs;   ///< the snapshots holding it
+    struct rec_task t; ///< its command and username are reference-counted strings (GRefString)
+};
+
+// the processes at an update, shared by their readers and freed when the last one releases them (see snapshot_take())
+typedef struct snapshot_t
+{
+    atomic_int refs;   ///< the references held
+    long long time_ms; ///< when it was taken (milliseconds since the epoch)
+    GArray *tasks;     ///< the processes (struct snapshot_task *), sorted by PID
+} Snapshot_t;
+
+// the i-th process of a snapshot, by increasing PID (a const struct rec_task *)
+#define snapshot_task(snap, i) ((const struct rec_task *)&g_array_index((snap)->tasks, struct snapshot_task *, (i))->t)
+
+// initializes an empty state
+void rec_state_init(struct rec_state *s);
+// empties a state, freeing its strings (as before a keyframe)
+void rec_state_clear(struct rec_state *s);
+// frees the strings and the processes of a state
+void rec_state_free(struct rec_state *s);
+// copies the data collected at a tick into cur (its strings are borrowed from the TaskList)
+bool rec_fill_state(struct rec_state *cur, const Mem_data_t *mem, const CPU_data_t *cpu, TaskList *tasks);
+// frees a state filled by rec_fill_state(): only its arrays, since its strings are borrowed
+void rec_state_release(struct rec_state *s);
+// takes a snapshot of the processes, sharing those unchanged since prev (the caller holds the lock of the TaskList, and gets a reference)
+Snapshot_t *snapshot_take(TaskList *tasks, const Snapshot_t *prev, GArray *handles);
+// takes another reference to a snapshot
+Snapshot_t *snapshot_ref(Snapshot_t *snap);
+// releases a reference to a snapshot (can be NULL), freeing it with the last one
+void snapshot_unref(Snapshot_t *snap);
+
+#endif
@@ -0,0 +1,238 @@
+/**
+ * \file str_arena.c
+ * \brief Implements an arena of strings with generation-based reclamation
+ *
+ * The command lines of the processes would otherwise take a strdup() and a free() per
+ * process at each scan. Here they are copied into large blocks,
+ * and a whole generation of blocks is reclaimed at once when a scan ends. The reclaimed
+ * blocks are kept as spares for the next generation, so with a steady set of processes
+ * the same blocks are used over and over without calling malloc()
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "str_arena.h"
+
+void str_arena_init(Str_arena_t *arena)
+{
+    memset(arena, 0, sizeof(Str_arena_t));
+}
+
+// frees a list of blocks
+static void free_blocks(struct str_block *b)
+{
+    while (b)
+    {
+        struct str_block *next = b->next;
+        free(b);
+        b = next;
+    }
+}
+
+void str_arena_free(Str_arena_t *arena)
+{
+    free_blocks(arena->live);
+    free_blocks(arena->old);
+    free_blocks(arena->spare);
+    str_arena_init(arena);
+}
+
+// gets an empty block with room for at least need bytes, reusing a spare one if possible
+static struct str_block *get_block(Str_arena_t *arena, size_t need)
+{
+    struct str_block **prev = &arena->spare;
+    for (struct str_block *b = arena->spare; b != NULL; prev = &b->next, b = b->next)
+    {
+        if (b->size >= need)
+        {
+            *prev = b->next;
+            b->used = 0;
+            return b;
+        }
+    }
+    size_t size = (need > STR_ARENA_BLOCKSZ ? need : STR_ARENA_BLOCKSZ);
+    struct str_block *b = malloc(sizeof(struct str_block) + size);
+    if (b)
+    {
+        b->size = size;
+        b->used = 0;
+        arena->block_allocs++;
+        arena->reserved_bytes += size;
+    }
+    return b;
+}
+
+// takes size bytes, aligned to align, from the current generation
+static char *arena_reserve(Str_arena_t *arena, size_t size, size_t align)
+{
+    struct str_block *b = arena->live;
+    size_t pad = (b ? (align - (uintptr_t)(b->data + b->used) % align) % align : 0);
+    if (b == NULL || b->size - b->used < pad + size)
+    {
+        // a new block has room for any alignment, since its data is aligned like malloc's memory
+        b = get_block(arena, size + align);
+        if (b == NULL)
+        {
+            return NULL;
+        }
+        if (arena->live != NULL && size + align > STR_ARENA_BLOCKSZ)
+        {
+            // a string that needs a block of its own goes behind the block being filled,
+            // whose free space would be lost otherwise
+            b->next = arena->live->next;
+            arena->live->next = b;
+        }
+        else
+        {
+            b->next = arena->live;
+            arena->live = b;
+        }
+        pad = (align - (uintptr_t)b->data % align) % align;
+    }
+    char *mem = b->data + b->used + pad;
+    b->used += pad + size;
+    arena->live_bytes += pad + size;
+    return mem;
+}
+
+char *str_arena_strndup(Str_arena_t *arena, const char *s, size_t len)
+{
+    char *str = arena_reserve(arena, len + 1, 1);
+    if (str == NULL)
+    {
+        return NULL;
+    }
+    memcpy(str, s, len);
+    str[len] = '\0';
+    arena->strings++;
+    return str;
+}
+
+char *str_arena_strdup(Str_arena_t *arena, const char *s)
+{
+    return str_arena_strndup(arena, s, strlen(s));
+}
+
+char *str_arena_carry(Str_arena_t *arena, const char *s)
+{
+    if (s == NULL)
+    {
+        return NULL;
+    }
+    arena->carried++;
+    return str_arena_strdup(arena, s);
+}
+
+/**
+ * \brief Stores a list of strings separated by NULs as a NULL-terminated vector
+ *
+ * The vector and the strings are stored together, the strings right after the vector,
+ * so that the vector alone is enough to copy them (see str_arena_carry_argv())
+ * \param [in,out] arena The arena
+ * \param [in] s The strings, each followed by a NUL except (possibly) the last one
+ * \param [in] len The length of s, without the NULs that follow the last string
+ * \return Returns the vector, or NULL if it can't be allocated
+ */
+char **str_arena_argv(Str_arena_t *arena, const char *s, size_t len)
+{
+    size_t argc = 1;
+    for (const char *sep = memchr(s, '\0', len); sep != NULL; sep = memchr(sep + 1, '\0', s + len - sep - 1))
+    {
+        argc++;
+    }
+    char **argv = (char **)arena_reserve(arena, (argc + 1) * sizeof(char *) + len + 1, sizeof(char *));
+    if (argv == NULL)
+    {
+        return NULL;
+    }
+    char *str = (char *)(argv + argc + 1);
+    memcpy(str, s, len);
+    str[len] = '\0';
+    argv[0] = str;
+    size_t i = 1;
+    for (size_t c = 0; c < len; c++)
+    {
+        if (str[c] == '\0')
+        {
+            argv[i++] = str + c + 1;
+        }
+    }
+    argv[argc] = NULL;
+    arena->strings++;
+    return argv;
+}
+
+char **str_arena_carry_argv(Str_arena_t *arena, char *const *argv)
+{
+    if (argv == NULL || argv[0] == NULL)
+    {
+        return NULL;
+    }
+    // the strings are contiguous: they end with the last one
+    char *const *last = argv;
+    while (*(last + 1) != NULL)
+    {
+        last++;
+    }
+    arena->carried++;
+    return str_arena_argv(arena, argv[0], *last + strlen(*last) - argv[0]);
+}
+
+void str_arena_begin(Str_arena_t *arena)
+{
+    // if the previous generation was not reclaimed (the scan stopped early) its strings
+    // may still be in use, so it's merged with the one ending now
+    struct str_block **tail = &arena->old;
+    while (*tail != NULL)
+    {
+        tail = &(*tail)->next;
+    }
+    *tail = arena->live;
+    arena->live = NULL;
+    arena->live_bytes = 0;
+    arena->generation++;
+}
+
+/**
+ * \brief Reclaims the blocks of the previous generation
+ *
+ * The blocks become spares for the next generation. The spares exceeding the size of the
+ * current generation (plus a block) are freed, so that the arena shrinks back after a
+ * spike in the number of processes
+ * \param [in,out] arena The arena
+ */
+void str_arena_reclaim(Str_arena_t *arena)
+{
+    struct str_block **tail = &arena->spare;
+    while (*tail != NULL)
+    {
+        tail = &(*tail)->next;
+    }
+    *tail = arena->old;
+    arena->old = NULL;
+
+    size_t keep = STR_ARENA_BLOCKSZ;
+    for (struct str_block *b = arena->live; b != NULL; b = b->next)
+    {
+        keep += b->size;
+    }
+    size_t kept = 0;
+    struct str_block **prev = &arena->spare;
+    while (*prev != NULL)
+    {
+        struct str_block *b = *prev;
+        if (kept + b->size > keep)
+        {
+            *prev = b->next;
+            arena->reserved_bytes -= b->size;
+            arena->block_frees++;
+            free(b);
+        }
+        else
+        {
+            kept += b->size;
+            prev = &b->next;
+        }
+    }
+}
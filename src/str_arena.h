@@ -0,0 +1,65 @@
+/**
+ * \file str_arena.h
+ * \brief Arena for the strings of the processes, reclaimed one generation at a time
+ */
+#ifndef STR_ARENA_INCLUDED
+#define STR_ARENA_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// size of a block of the arena (larger strings get a block of their own)
+#define STR_ARENA_BLOCKSZ 65536
+
+// a block of memory holding strings one after the other
+struct str_block
+{
+    struct str_block *next;
+    size_t size; ///< the number of bytes of data
+    size_t used; ///< the number of bytes of data taken by strings
+    char data[];
+};
+
+/**
+ * \brief The strings of a generation are stored in its blocks and freed all at once
+ *
+ * A scan of the processes begins a generation: the strings it reads, and the ones it keeps
+ * unchanged, are copied into the blocks of the new generation. When the scan ends the
+ * blocks of the previous generation are reclaimed, to be reused by the next one, so that
+ * no memory is allocated once the blocks are enough for the strings of a scan
+ */
+typedef struct str_arena_t
+{
+    struct str_block *live;   ///< the blocks of the current generation (the first one is being filled)
+    struct str_block *old;    ///< the blocks of the previous generation, until it's reclaimed
+    struct str_block *spare;  ///< reclaimed blocks, reused before allocating new ones
+    unsigned long generation; ///< the number of generations begun
+    // allocation counters, since the arena was initialized
+    unsigned long block_allocs; ///< the number of blocks allocated (calls to malloc)
+    unsigned long block_frees;  ///< the number of blocks freed (spares exceeding what a generation needs)
+    unsigned long strings;      ///< the number of strings stored (including the carried ones)
+    unsigned long carried;      ///< the number of strings carried unchanged from the previous generation
+    size_t live_bytes;          ///< the bytes taken by the strings of the current generation
+    size_t reserved_bytes;      ///< the bytes of all the blocks (live, old and spare)
+} Str_arena_t;
+
+// initializes an empty arena
+void str_arena_init(Str_arena_t *arena);
+// frees all the blocks of the arena, invalidating its strings
+void str_arena_free(Str_arena_t *arena);
+// stores a copy of the first len bytes of s (plus a terminator) in the current generation
+char *str_arena_strndup(Str_arena_t *arena, const char *s, size_t len);
+// stores a copy of s in the current generation
+char *str_arena_strdup(Str_arena_t *arena, const char *s);
+// copies a string of the previous generation (can be NULL) into the current one
+char *str_arena_carry(Str_arena_t *arena, const char *s);
+// stores strings separated by NULs (len bytes in all) as a NULL-terminated vector in the current generation
+char **str_arena_argv(Str_arena_t *arena, const char *s, size_t len);
+// copies a vector of the previous generation made by str_arena_argv (can be NULL) into the current one
+char **str_arena_carry_argv(Str_arena_t *arena, char *const *argv);
+// begins a new generation: the strings stored so far stay valid until str_arena_reclaim()
+void str_arena_begin(Str_arena_t *arena);
+// reclaims the blocks of the previous generation, invalidating its strings
+void str_arena_reclaim(Str_arena_t *arena);
+
+#endif
@@ -1,4 +1,9 @@
 #include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include <unistd.h>
 
@@ -7,6 +12,27 @@
 #include "mem_info.h"
 #include "cpu_info.h"
 #include "process_info.h"
+#include "history.h"
+#include "psi_info.h"
+#include "cgroup_info.h"
+#include "numa_info.h"
+#include "freeze.h"
+
+// set by update_psi() while the system is under pressure: data is refreshed more often (read by every update thread)
+static atomic_bool pressure_boost = false;
+
+// sleeps for delay, or for a quarter of it while the system is under pressure
+static void refresh_sleep(const struct timespec *delay)
+{
+    struct timespec d = *delay;
+    if (atomic_load(&pressure_boost) == true)
+    {
+        long long ns = (d.tv_sec * 1000000000LL + d.tv_nsec) / 4;
+        d.tv_sec = ns / 1000000000LL;
+        d.tv_nsec = ns % 1000000000LL;
+    }
+    nanosleep(&d, NULL);
+}
 
 /**
  * \brief This is the function executed by the thread that updates the memory data structure
@@ -28,14 +54,23 @@ void *update_mem(void *mem_ds)
         }
         mdata->is_busy = true;
 
-        get_mem_info(mdata);
+        if (get_mem_info(mdata) == true && mdata->total_mem > 0)
+        {
+            // record the percentages of memory and swap in use in their histories
+            double now = history_now();
+            history_append(&mdata->ram_hist, 100.0 - (mdata->avail_mem * 100.0) / mdata->total_mem, now);
+            history_append(&mdata->swp_hist,
+                           (mdata->swp_tot > 0 ? 100.0 - (mdata->swp_free * 100.0) / mdata->swp_tot : 0),
+                           now);
+        }
+        get_vmstat_info(mdata);
 
         mdata->is_busy = false;
         pthread_cond_signal(&mdata->cond_updating);
         // shared data is not accessed now: unlock
         pthread_mutex_unlock(&mdata->mux_memdata);
 
-        nanosleep(&delay, NULL);
+        refresh_sleep(&delay);
     }
     return (void *)0;
 }
@@ -59,14 +94,19 @@ void *update_cpu(void *cpu_ds)
         }
         cpudata->is_busy = true;
 
-        get_cpu_info(cpudata);
+        if (get_cpu_info(cpudata) == true)
+        {
+            history_append(&cpudata->usage_hist,
+                           100.0 - cpudata->total.perc[CPU_IDLE] - cpudata->total.perc[CPU_IOWAIT],
+                           history_now());
+        }
 
         cpudata->is_busy = false;
         pthread_cond_signal(&cpudata->cond_updating);
         // shared data is not accessed now: unlock
         pthread_mutex_unlock(&cpudata->mux_memdata);
 
-        nanosleep(&delay, NULL);
+        refresh_sleep(&delay);
     }
     return (void *)0;
 }
@@ -94,13 +134,149 @@ void *update_proc(void *all_ds)
         tl->is_busy = true;
 
         get_processes_info(tl, cpu);
+        // the cgroups' own statistics are needed only when they are displayed
+        if (tl->group_by_cgroup == true)
+        {
+            get_cgroups_info(tl->cgroups);
+        }
+        // while the list is frozen, the processes just read are compared with it
+        freeze_update(ds->freeze, tl);
 
         tl->is_busy = false;
         pthread_cond_signal(&tl->cond_updating);
         // shared data is not accessed now: unlock
         pthread_mutex_unlock(&tl->mux_memdata);
 
-        nanosleep(&delay, NULL);
+        refresh_sleep(&delay);
+    }
+    return (void *)0;
+}
+/**
+ * \brief This is the function executed by the thread that updates the pressure data structure
+ *
+ * The thread blocks on the pressure triggers (see psi_triggers_wait()), so it costs nothing
+ * while the system is calm. When a trigger fires (or, without triggers, when the 10s average
+ * of any resource exceeds PSI_AVG_THRESHOLD) the other update threads and the windows are
+ * refreshed every PSI_FAST_REFRESH_MS, until no pressure is detected for PSI_CALM_SEC seconds
+ */
+void *update_psi(void *all_ds)
+{
+    struct taskmgr_data_t *ds = (struct taskmgr_data_t *)all_ds;
+    PSI_data_t *psi = ds->psi_stats;
+
+    while (1)
+    {
+        int fired = psi_triggers_wait(psi, (atomic_load(&pressure_boost) == true ? PSI_FAST_REFRESH_MS : 1000));
+
+        // about to access shared data: lock
+        pthread_mutex_lock(&psi->mux_memdata);
+        while (psi->is_busy == true)
+        {
+            pthread_cond_wait(&psi->cond_updating, &psi->mux_memdata);
+        }
+        psi->is_busy = true;
+
+        get_psi_info(psi);
+        bool spike = (fired > 0);
+        if (psi->has_triggers == false)
+        {
+            for (int r = 0; r < PSI_NRESOURCES; r++)
+            {
+                if (psi->res[r].some.avg10 > PSI_AVG_THRESHOLD)
+                {
+                    spike = true;
+                }
+            }
+        }
+        double now = history_now();
+        if (spike == true)
+        {
+            psi->last_event = now;
+            psi->under_pressure = true;
+        }
+        else if (psi->under_pressure == true && now - psi->last_event > PSI_CALM_SEC)
+        {
+            psi->under_pressure = false;
+        }
+        bool boost = psi->under_pressure;
+        atomic_store(&pressure_boost, boost);
+
+        psi->is_busy = false;
+        pthread_cond_signal(&psi->cond_updating);
+        // shared data is not accessed now: unlock
+        pthread_mutex_unlock(&psi->mux_memdata);
+
+        // redraw the windows as well, unless the refresh timer is stopped (the menu is shown)
+        struct itimerspec curr;
+        if (boost == true && timer_gettime(ds->refresh_timer, &curr) == 0 &&
+            (curr.it_value.tv_sec != 0 || curr.it_value.tv_nsec != 0))
+        {
+            kill(getpid(), SIGALRM);
+        }
+    }
+    return (void *)0;
+}
+/**
+ * \brief This is the function executed by the thread that updates the NUMA data structure
+ *
+ * The topology is read again only when a hotplug event has been received. The per-core
+ * statistics are copied from the CPU data structure, so that its lock is not held while
+ * the nodes' files are read
+ */
+void *update_numa(void *all_ds)
+{
+    struct timespec delay;
+    delay.tv_sec = 2;
+    delay.tv_nsec = 0;
+
+    struct taskmgr_data_t *ds = (struct taskmgr_data_t *)all_ds;
+    NUMA_data_t *numa = ds->numa_stats;
+    CPU_data_t *cpu = ds->cpu_stats;
+    struct core_data_t *percore = NULL;
+    int num_cores = 0;
+
+    while (1)
+    {
+        pthread_mutex_lock(&cpu->mux_memdata);
+        while (cpu->is_busy == true)
+        {
+            pthread_cond_wait(&cpu->cond_updating, &cpu->mux_memdata);
+        }
+        cpu->is_busy = true;
+        if (cpu->num_cores != num_cores)
+        {
+            struct core_data_t *tmp = realloc(percore, cpu->num_cores * sizeof(struct core_data_t));
+            if (tmp)
+            {
+                percore = tmp;
+                num_cores = cpu->num_cores;
+            }
+        }
+        memcpy(percore, cpu->percore, num_cores * sizeof(struct core_data_t));
+        cpu->is_busy = false;
+        pthread_cond_signal(&cpu->cond_updating);
+        pthread_mutex_unlock(&cpu->mux_memdata);
+
+        // about to access shared data: lock
+        pthread_mutex_lock(&numa->mux_memdata);
+        while (numa->is_busy == true)
+        {
+            pthread_cond_wait(&numa->cond_updating, &numa->mux_memdata);
+        }
+        numa->is_busy = true;
+
+        if (numa_hotplug_pending(numa) == true)
+        {
+            numa_topology_init(numa);
+        }
+        get_numa_info(numa, percore, num_cores);
+
+        numa->is_busy = false;
+        pthread_cond_signal(&numa->cond_updating);
+        // shared data is not accessed now: unlock
+        pthread_mutex_unlock(&numa->mux_memdata);
+
+        refresh_sleep(&delay);
     }
     return (void *)0;
 }
@@ -4,5 +4,7 @@
 void *update_mem(void *mem_ds);
 void *update_cpu(void *cpu_ds);
 void *update_proc(void *all_ds);
+void *update_psi(void *all_ds);
+void *update_numa(void *all_ds);
 
 #endif
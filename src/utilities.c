@@ -12,6 +12,8 @@
 #include <ncurses.h>
 
 #include "process_info.h"
+#include "net_info.h"
+#include "windows.h"
 #include "main.h"
 
 /**
@@ -55,35 +57,6 @@ int print_menu(int *keybinds, char **items, char **descriptions, const int nitem
     return 0;
 }
 
-/**
- * \brief Utility function to convert a string to long int
- *
- * - 0: conversione ok
- * - 1: non e' un numbero
- * - 2: overflow/underflow
- * \param [in] s La stringa da convertire in un intero
- * \param [out] n Puntatore all'intero risultato della conversione
- * \return Ritorna un numero corrispondente all'esito della conversione, come riportato nella descrizione
- */
-int isNumber(const char *s, long *n)
-{
-    if (s == NULL)
-        return 1;
-    if (strlen(s) == 0)
-        return 1;
-    char *e = NULL;
-    errno = 0;
-    long val = strtol(s, &e, 10);
-    if (errno == ERANGE)
-        return 2; // overflow
-    if (e != NULL && *e == (char)0)
-    {
-        *n = val;
-        return 0; // successo
-    }
-    return 1; // non e' un numero
-}
-
 int string_dup(char **dest, const char *src)
 {
     if ((*dest = strndup(src, strlen(src) + 1)) == NULL)
@@ -184,7 +157,7 @@ void find_pattern(TaskList *tasks)
     int matches = 0;
     for (int p = 0; p < tasks->num_ps; p++)
     {
-        Task *t = &g_array_index(tasks->ps, Task, p);
+        Task *t = task_at(tasks, p);
         if (t->command && strstr(t->command, pattern) != NULL)
         {
             t->highlight = true;
@@ -218,12 +191,10 @@ void kill_process(TaskList *tasks)
     {
         // The PID is searched in the task list
         Task *process = NULL;
-        Task t;
-        t.pid = pid;
-        unsigned int idx;
-        if (g_array_binary_search(tasks->ps, &t, cmp_pid_incr, &idx) == true)
+        long int h = find_task(tasks, pid);
+        if (h >= 0)
         {
-            process = &g_array_index(tasks->ps, Task, idx);
+            process = task_at(tasks, h);
         }
         errno = 0;
         if (kill((pid_t)pid, SIGKILL) == -1)
@@ -257,3 +228,186 @@ void kill_process(TaskList *tasks)
     free(pattern);
     wrefresh(stdscr);
 }
+
+/**
+ * \brief Scrolls a list displayed on the whole screen according to the key pressed
+ *
+ * \param [in] key The key pressed
+ * \param [in,out] first The index of the first item displayed
+ * \param [in] len The number of items in the list
+ * \return Returns true if the key scrolls the list, false if it quits the list
+ */
+static bool scroll_list(int key, long int *first, long int len)
+{
+    // the rows taken by the list's header and the border
+    long int page = LINES - 4;
+    switch (key)
+    {
+    case KEY_DOWN:
+        (*first)++;
+        break;
+    case KEY_UP:
+        (*first)--;
+        break;
+    case KEY_NPAGE:
+        *first += page;
+        break;
+    case KEY_PPAGE:
+        *first -= page;
+        break;
+    default:
+        return false;
+    }
+    if (*first > len - 1)
+    {
+        *first = len - 1;
+    }
+    if (*first < 0)
+    {
+        *first = 0;
+    }
+    return true;
+}
+
+// gets the PID and (a copy of) the command of the process under the cursor: returns -1 if there is none
+static int get_cursor_task(TaskList *tasks, char **command)
+{
+    int pid = -1;
+    *command = NULL;
+    pthread_mutex_lock(&tasks->mux_memdata);
+    while (tasks->is_busy == true)
+    {
+        pthread_cond_wait(&tasks->cond_updating, &tasks->mux_memdata);
+    }
+    tasks->is_busy = true;
+    if (tasks->cursor_start < tasks->num_ps)
+    {
+        Task *t = task_at(tasks, task_handle(tasks, tasks->cursor_start));
+        pid = t->pid;
+        *command = (t->command ? strdup(t->command) : NULL);
+    }
+    tasks->is_busy = false;
+    pthread_cond_signal(&tasks->cond_updating);
+    pthread_mutex_unlock(&tasks->mux_memdata);
+    return pid;
+}
+
+/**
+ * \brief Shows the open file descriptors of the process under the cursor
+ *
+ * The list of open files is read only now, since it takes a readlink() per file
+ * descriptor, and it's not updated while it's displayed. The user can scroll it
+ * with the arrow keys: any other key quits the view
+ */
+void show_open_fds(TaskList *tasks)
+{
+    char *command;
+    // get the process under the cursor (the first one displayed)
+    int pid = get_cursor_task(tasks, &command);
+    if (pid == -1)
+    {
+        return;
+    }
+
+    GArray *fds = get_fd_list(pid);
+    if (fds == NULL)
+    {
+        mvprintw(LINES - 1, 1, "Cannot list the open files of PID %d: %s", pid, strerror(errno));
+        wrefresh(stdscr);
+        free(command);
+        return;
+    }
+    long int first = 0;
+    do
+    {
+        fd_window_update(stdscr, pid, command, fds, first);
+    } while (scroll_list(getch(), &first, fds->len) == true);
+    free_fd_list(fds);
+    free(command);
+    erase();
+    refresh();
+}
+
+/**
+ * \brief Shows the TCP and UDP sockets of the process under the cursor
+ *
+ * The socket tables are read and indexed only now, and the list is not updated
+ * while it's displayed
+ */
+void show_sockets(TaskList *tasks)
+{
+    char *command;
+    int pid = get_cursor_task(tasks, &command);
+    if (pid == -1)
+    {
+        return;
+    }
+    Net_data_t net;
+    net_init(&net);
+    GArray *found = g_array_new(false, false, sizeof(guint));
+    if (get_sockets(&net) == false || get_task_sockets(&net, pid, found) == -1)
+    {
+        mvprintw(LINES - 1, 1, "Cannot list the sockets of PID %d: %s", pid, strerror(errno));
+        wrefresh(stdscr);
+    }
+    else
+    {
+        char title[LINE_MAXLEN];
+        snprintf(title, LINE_MAXLEN, "Sockets of PID %d (%s): %u", pid, (command ? command : "no cmdline"), found->len);
+        long int first = 0;
+        do
+        {
+            socket_window_update(stdscr, title, &net, found, first);
+        } while (scroll_list(getch(), &first, found->len) == true);
+        erase();
+        refresh();
+    }
+    g_array_free(found, true);
+    net_close(&net);
+    free(command);
+}
+
+/**
+ * \brief Shows the processes listening on the port entered
+ *
+ * The listening TCP sockets and the unconnected UDP sockets bound to the port are found
+ * in the socket tables, then the open files of every process are scanned to find their owners
+ */
+void find_port_listeners(void)
+{
+    char *pattern = read_pattern(stdscr, LINES - 1, 1, "(listening on port) ");
+    long int port;
+    if (isNumber(pattern, &port) != 0 || port <= 0 || port > 65535)
+    {
+        addstr(": not a valid port");
+        wrefresh(stdscr);
+        free(pattern);
+        return;
+    }
+    Net_data_t net;
+    net_init(&net);
+    GArray *found = g_array_new(false, false, sizeof(guint));
+    get_sockets(&net);
+    find_listeners(&net, port, found);
+    if (found->len == 0)
+    {
+        mvprintw(LINES - 1, 1, "No process is listening on port %ld", port);
+        wrefresh(stdscr);
+    }
+    else
+    {
+        find_socket_owners(&net);
+        char title[LINE_MAXLEN];
+        snprintf(title, LINE_MAXLEN, "Sockets listening on port %ld: %u", port, found->len);
+        long int first = 0;
+        do
+        {
+            socket_window_update(stdscr, title, &net, found, first);
+        } while (scroll_list(getch(), &first, found->len) == true);
+        erase();
+        refresh();
+    }
+    g_array_free(found, true);
+    net_close(&net);
+    free(pattern);
+}
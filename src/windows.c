@@ -1,7 +1,13 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include <unistd.h>
 
 #include <glib.h>
 #include <ncurses.h>
@@ -10,6 +16,9 @@
 #include "mem_info.h"
 #include "process_info.h"
 #include "windows.h"
+#include "history.h"
+#include "cgroup_info.h"
+#include "net_info.h"
 
 /**
  * \brief Scales down by factors of 1K the given quantity and returns the amount of
@@ -34,7 +43,8 @@ int scale_down_1K(size_t *quantity, int scale_in)
 }
 
 // function that deals with meters included in the memory window
-void mem_window_update(WINDOW *win, Mem_data_t *mem_usage, int scaling)
+void mem_window_update(WINDOW *win, Mem_data_t *mem_usage, int scaling, int history_level, bool show_extra,
+                       CPU_data_t *vmstat_cpu)
 {
     int lines, cols;
     getmaxyx(win, lines, cols);
@@ -49,8 +59,17 @@ void mem_window_update(WINDOW *win, Mem_data_t *mem_usage, int scaling)
     init_bars(swp_bar, scale);
     char ram_values[LINE_MAXLEN];
     char swp_values[LINE_MAXLEN];
+    // sparklines of the usage history, drawn next to the bars
+    char ram_spark[HISTORY_LEN + 1];
+    char swp_spark[HISTORY_LEN + 1];
     // local vars to store the memory quantities to be displayed
     unsigned long total, avail, free, buff_cache, swptot, swpfree;
+    // the fields of /proc/meminfo not in the summary, displayed in the rows left
+    struct meminfo_field extra[MEMINFO_MAXFIELDS];
+    int nextra = 0;
+    // the rates of the paging counters and of context switches and interrupts
+    double vm_rates[VMSTAT_NKEYS];
+    double ctxt_rate = 0, intr_rate = 0;
 
     // about to access shared data: lock
     pthread_mutex_lock(&mem_usage->mux_memdata);
@@ -66,16 +85,49 @@ void mem_window_update(WINDOW *win, Mem_data_t *mem_usage, int scaling)
     buff_cache = mem_usage->buffer_cached;
     swptot = mem_usage->swp_tot;
     swpfree = mem_usage->swp_free;
+    history_sparkline(&mem_usage->ram_hist, history_level, ram_spark, HISTORY_LEN);
+    history_sparkline(&mem_usage->swp_hist, history_level, swp_spark, HISTORY_LEN);
+    if (show_extra == true)
+    {
+        for (int f = 0; f < mem_usage->num_fields; f++)
+        {
+            if (mem_usage->fields[f].key == -1)
+            {
+                extra[nextra++] = mem_usage->fields[f];
+            }
+        }
+    }
+    for (int k = 0; k < VMSTAT_NKEYS; k++)
+    {
+        vm_rates[k] = counter_rate(&mem_usage->vmstat[k]);
+    }
 
     mem_usage->is_busy = false;
     pthread_cond_signal(&mem_usage->cond_updating);
     // shared data is not accessed now: unlock
     pthread_mutex_unlock(&mem_usage->mux_memdata);
 
+    if (vmstat_cpu != NULL)
+    {
+        // context switches and interrupts are read from /proc/stat by the cpu thread
+        pthread_mutex_lock(&vmstat_cpu->mux_memdata);
+        while (vmstat_cpu->is_busy == true)
+        {
+            pthread_cond_wait(&vmstat_cpu->cond_updating, &vmstat_cpu->mux_memdata);
+        }
+        vmstat_cpu->is_busy = true;
+        ctxt_rate = counter_rate(&vmstat_cpu->ctxt);
+        intr_rate = counter_rate(&vmstat_cpu->intr);
+        vmstat_cpu->is_busy = false;
+        pthread_cond_signal(&vmstat_cpu->cond_updating);
+        pthread_mutex_unlock(&vmstat_cpu->mux_memdata);
+    }
+
     // the percentage needs to be calculated before the eventual scaling, so that operating
     // on raw values yields precise results
-    gfloat ram_percent = 100.0 - (avail * 100.0) / (float)total;
-    gfloat swp_percent = 100 - (swpfree * 100) / (float)swptot;
+    // (a system without swap, or memory not read yet, shows an empty bar)
+    gfloat ram_percent = (total > 0 ? 100.0 - (avail * 100.0) / (float)total : 0);
+    gfloat swp_percent = (swptot > 0 ? 100 - (swpfree * 100) / (float)swptot : 0);
 
     char *units[4] = {"B", "KiB", "MiB", "GiB"};
     // scale memory quantities down (they are already expressed in KB, so the initial scale is 1)
@@ -111,28 +163,216 @@ void mem_window_update(WINDOW *win, Mem_data_t *mem_usage, int scaling)
     // erase the previous window contents and add the new values, then refresh
     werase(win);
     mvwprintw(win, yoff++, xoff, "%s (%.3f%% in use)", ram_bar, ram_percent);
+    print_sparkline(win, ram_spark, history_level);
     mvwaddstr(win, yoff++, xoff, scale);
     mvwprintw(win, yoff++, xoff, ram_values);
     mvwprintw(win, yoff++, xoff, "%s (%.3f%% in use)", swp_bar, swp_percent);
+    print_sparkline(win, swp_spark, history_level);
     mvwaddstr(win, yoff++, xoff, scale);
     mvwprintw(win, yoff++, xoff, swp_values);
+    if (vmstat_cpu != NULL && yoff < lines)
+    {
+        // major faults and swapping out are the first signs of thrashing: highlight them
+        bool thrashing = (vm_rates[VMSTAT_PGMAJFAULT] >= 1 || vm_rates[VMSTAT_PSWPOUT] >= 1);
+        if (thrashing == true)
+        {
+            wattr_on(win, A_BOLD, NULL);
+        }
+        mvwprintw(win, yoff++, xoff,
+                  "Per second: faults %.0f  major %.0f  swap in %.0f  out %.0f  scanned %.0f  ctxt %.0f  intr %.0f",
+                  vm_rates[VMSTAT_PGFAULT], vm_rates[VMSTAT_PGMAJFAULT], vm_rates[VMSTAT_PSWPIN],
+                  vm_rates[VMSTAT_PSWPOUT], vm_rates[VMSTAT_PGSCAN], ctxt_rate, intr_rate);
+        if (thrashing == true)
+        {
+            wattr_off(win, A_BOLD, NULL);
+        }
+    }
+
+    // the other fields are printed in columns, filling the rows left in the window
+    int per_row = (cols - xoff) / MEMINFO_COLWIDTH;
+    for (int f = 0; f < nextra && yoff < lines && per_row > 0; f++)
+    {
+        size_t value = extra[f].value;
+        const char *unit = "";
+        if (extra[f].in_kb == true)
+        {
+            unit = units[(scaling == 1 ? scale_down_1K(&value, 1) : 1)];
+        }
+        mvwprintw(win, yoff, xoff + (f % per_row) * MEMINFO_COLWIDTH, "%s: %lu %s", extra[f].name, value, unit);
+        if (f % per_row == per_row - 1)
+        {
+            yoff++;
+        }
+    }
 
     wrefresh(win);
 }
-/// function that deals with meters included in the cpu window
-void cpu_window_update(WINDOW *win, CPU_data_t *cpu_usage)
+// buffers reused by cpu_window_update() across refreshes: they are grown only when the
+// number of cores changes, so that drawing a frame does not allocate anything
+static float *core_usage = NULL;
+static float *node_usage = NULL;
+static int *node_ids = NULL;
+static struct core_data_t *core_stats = NULL;
+static int core_usage_sz = 0;
+
+// the number of '#' of a bar of len columns filled to perc percent, bounded to the bar
+static int bar_fill(double perc, int len)
+{
+    long n = (long)round(perc * len / 100);
+    return (n < 0 ? 0 : (n > len ? len : n));
+}
+
+/**
+ * \brief Draws the per-core usage as a grid of cells, one glyph per core
+ *
+ * Used instead of the per-core bars when they don't fit in the window. Each cell is
+ * a glyph from CPU_HEAT_GLYPHS, picked by usage in steps of 10%, and coloured green,
+ * yellow or red (if the terminal supports colors). Offline cores (negative usage) are
+ * left blank. Rows are prefixed by the number of their first core and cells are grouped
+ * by CPU_GRID_GROUP to ease counting. If the cores don't fit in max_rows, the last row
+ * ends with the number of those left out
+ * \param [in] win The CPU window
+ * \param [in] yoff The first row of the window where the grid is drawn
+ * \param [in] max_rows The number of rows available for the grid
+ * \param [in] usage The usage percentage of each core
+ * \param [in] ids The number of each core in usage (NULL if usage is indexed by core number)
+ * \param [in] num_cores The length of usage
+ * \return The number of rows used by the grid
+ */
+int cpu_grid_update(WINDOW *win, int yoff, int max_rows, const float *usage, const int *ids, int num_cores)
 {
-    // First allocate memory for the buffers that will hold data
-    char *model_cores = malloc(LINE_MAXLEN * sizeof(char));
-    if (!model_cores)
+    // the rows are bounded by max_rows: only the width of the window matters
+    int cols = getmaxx(win);
+    // each row starts with a label of 5 columns holding the first core's index
+    int label_w = 5;
+    // every group of cells takes one more column for the separating blank
+    int groups = (cols - label_w - 2) / (CPU_GRID_GROUP + 1);
+    int per_row = (groups > 0 ? groups * CPU_GRID_GROUP : 1);
+    int nglyphs = strlen(CPU_HEAT_GLYPHS);
+    // the cores drawn: if they don't all fit, two groups of cells are left for the "+N more" marker
+    int shown = num_cores;
+    if (max_rows > 0 && (num_cores + per_row - 1) / per_row > max_rows)
     {
-        return;
+        int reserved = (per_row < 2 * CPU_GRID_GROUP ? per_row : 2 * CPU_GRID_GROUP);
+        shown = max_rows * per_row - reserved;
     }
-    char *totals = malloc(55 * sizeof(char));
-    if (!totals)
+
+    int row = 0;
+    int core = 0;
+    for (; core < shown && row < max_rows; row++)
     {
-        return;
+        mvwprintw(win, yoff + row, 1, "%4d", (ids ? ids[core] : core));
+        wmove(win, yoff + row, label_w + 1);
+        for (int i = 0; i < per_row && core < shown; i++, core++)
+        {
+            if (i > 0 && i % CPU_GRID_GROUP == 0)
+            {
+                waddch(win, ' ');
+            }
+            if (usage[core] < 0)
+            {
+                waddch(win, ' ');
+                continue;
+            }
+            int level = (int)(usage[core] / 10);
+            if (level < 0)
+                level = 0;
+            if (level >= nglyphs)
+                level = nglyphs - 1;
+            short pair = (usage[core] < 50 ? CPU_HEAT_LOW_PAIR : (usage[core] < 80 ? CPU_HEAT_MID_PAIR : CPU_HEAT_HIGH_PAIR));
+            wattr_on(win, COLOR_PAIR(pair), NULL);
+            waddch(win, CPU_HEAT_GLYPHS[level]);
+            wattr_off(win, COLOR_PAIR(pair), NULL);
+        }
+    }
+    // the cores left out are counted after the last cell (or on a row of their own, if the last one is full)
+    if (core < num_cores)
+    {
+        if (row < max_rows)
+        {
+            wmove(win, yoff + row++, label_w + 1);
+        }
+        wprintw(win, " +%d more", num_cores - core);
+    }
+    // the legend is printed if there is still room for it (and the grid is not part of the NUMA view)
+    if (row < max_rows && ids == NULL)
+    {
+        mvwprintw(win, yoff + row++, 1, "legend: '%s' = 0..100%% in steps of 10%%, blank = offline", CPU_HEAT_GLYPHS);
+    }
+    return row;
+}
+
+/**
+ * \brief Draws the NUMA nodes with their memory, their usage and a grid of their cores
+ *
+ * Must be called by cpu_window_update(), once core_usage holds the usage of each core
+ * \param [in] win The CPU window
+ * \param [in] yoff The first row of the window where the nodes are drawn
+ * \param [in] max_rows The number of rows available
+ * \param [in] numa The NUMA topology and statistics
+ * \param [in] num_cores The length of core_usage
+ * \return The number of rows used
+ */
+int numa_rows_update(WINDOW *win, int yoff, int max_rows, NUMA_data_t *numa, int num_cores)
+{
+    char node_bar[NUMA_BARLEN + 3];
+    int row = 0;
+
+    // about to access shared data: lock
+    pthread_mutex_lock(&numa->mux_memdata);
+    while (numa->is_busy == true)
+    {
+        pthread_cond_wait(&numa->cond_updating, &numa->mux_memdata);
+    }
+    numa->is_busy = true;
+
+    for (int n = 0; n < numa->num_nodes && row < max_rows; n++)
+    {
+        struct numa_node *node = &numa->nodes[n];
+        memset(node_bar, ' ', sizeof(node_bar));
+        node_bar[0] = '[';
+        node_bar[NUMA_BARLEN + 1] = ']';
+        node_bar[NUMA_BARLEN + 2] = '\0';
+        memset(&node_bar[1], '#', bar_fill(node->cpu_usage, NUMA_BARLEN));
+        float mem_perc = (node->mem_total > 0 ? node->mem_used * 100.0 / node->mem_total : 0);
+        wattr_on(win, A_BOLD, NULL);
+        mvwprintw(win, yoff + row++, 1,
+                  "node%d cpus %s (%d online) %s %5.1f%% io %.1f  mem used %lu/%lu MiB (%.1f%%)",
+                  node->id, node->cpulist, node->num_cpus, node_bar, node->cpu_usage, node->cpu_iowait,
+                  node->mem_used >> 10, node->mem_total >> 10, mem_perc);
+        wattr_off(win, A_BOLD, NULL);
+        // the grid of the node's cores (those beyond the CPU data are left out, with their numbers)
+        int ncpus = 0;
+        for (int i = 0; i < node->num_cpus; i++)
+        {
+            if (node->cpus[i] < num_cores)
+            {
+                node_usage[ncpus] = core_usage[node->cpus[i]];
+                node_ids[ncpus++] = node->cpus[i];
+            }
+        }
+        row += cpu_grid_update(win, yoff + row, max_rows - row, node_usage, node_ids, ncpus);
     }
+
+    numa->is_busy = false;
+    pthread_cond_signal(&numa->cond_updating);
+    // shared data is not accessed now: unlock
+    pthread_mutex_unlock(&numa->mux_memdata);
+    return row;
+}
+
+/// function that deals with meters included in the cpu window
+void cpu_window_update(WINDOW *win, CPU_data_t *cpu_usage, int history_level, NUMA_data_t *numa)
+{
+    int lines, cols;
+    getmaxyx(win, lines, cols);
+
+    char model_cores[LINE_MAXLEN];
+    char totals[LINE_MAXLEN];
+    char counters[LINE_MAXLEN];
+    char core_bar[BARLEN];
+    char usage_spark[HISTORY_LEN + 1];
+
     // about to access shared data: lock
     pthread_mutex_lock(&cpu_usage->mux_memdata);
     while (cpu_usage->is_busy == true)
@@ -140,22 +380,63 @@ void cpu_window_update(WINDOW *win, CPU_data_t *cpu_usage)
         pthread_cond_wait(&cpu_usage->cond_updating, &cpu_usage->mux_memdata);
     }
     cpu_usage->is_busy = true;
-    // Alloc and set the cpu usage bars
     int core = 0;
     int num_cores = cpu_usage->num_cores;
-    char **core_bars = malloc(num_cores * sizeof(char *));
-    float *usage_perc = malloc(num_cores * sizeof(float));
+    // grow the usage buffers only if the number of cores exceeds their size
+    if (num_cores > core_usage_sz)
+    {
+        float *tmp = realloc(core_usage, num_cores * sizeof(float));
+        float *tmp_node = realloc(node_usage, num_cores * sizeof(float));
+        int *tmp_ids = realloc(node_ids, num_cores * sizeof(int));
+        struct core_data_t *tmp_stats = realloc(core_stats, num_cores * sizeof(struct core_data_t));
+        if (tmp)
+        {
+            core_usage = tmp;
+        }
+        if (tmp_node)
+        {
+            node_usage = tmp_node;
+        }
+        if (tmp_ids)
+        {
+            node_ids = tmp_ids;
+        }
+        if (tmp_stats)
+        {
+            core_stats = tmp_stats;
+        }
+        if (tmp && tmp_node && tmp_ids && tmp_stats)
+        {
+            core_usage_sz = num_cores;
+        }
+        else
+        {
+            num_cores = core_usage_sz;
+        }
+    }
+    memcpy(core_stats, cpu_usage->percore, num_cores * sizeof(struct core_data_t));
     for (core = 0; core < num_cores; core++)
     {
-        usage_perc[core] = 100.0 - cpu_usage->percore[core].perc_idle;
+        // time waiting for I/O is idle time as well
+        core_usage[core] = 100.0 - core_stats[core].perc[CPU_IDLE] - core_stats[core].perc[CPU_IOWAIT];
+        if (core_stats[core].online == false)
+        {
+            core_usage[core] = -1;
+        }
     }
     // prepare the string containing the model and number of cores
     snprintf(model_cores, LINE_MAXLEN, "Model: \'%s\'\tCores: %d", cpu_usage->model, num_cores);
     // the one containing usage percentages as well
-    snprintf(totals, 55,
-             "CPU%% usr: %.2f\tnice: %.2f\tsys: %.2f\tidle: %.2f",
-             cpu_usage->total.perc_usr, cpu_usage->total.perc_usr_nice,
-             cpu_usage->total.perc_sys, cpu_usage->total.perc_idle);
+    float *perc = cpu_usage->total.perc;
+    snprintf(totals, LINE_MAXLEN,
+             "CPU%% usr: %.2f  nice: %.2f  sys: %.2f  iowait: %.2f  irq: %.2f  softirq: %.2f  steal: %.2f  idle: %.2f",
+             perc[CPU_USER], perc[CPU_NICE], perc[CPU_SYSTEM], perc[CPU_IOWAIT],
+             perc[CPU_IRQ], perc[CPU_SOFTIRQ], perc[CPU_STEAL], perc[CPU_IDLE]);
+    snprintf(counters, LINE_MAXLEN,
+             "ctxt/s: %.0f  intr/s: %.0f  forks/s: %.1f  running: %d  blocked: %d",
+             counter_rate(&cpu_usage->ctxt), counter_rate(&cpu_usage->intr), counter_rate(&cpu_usage->forks),
+             cpu_usage->procs_running, cpu_usage->procs_blocked);
+    history_sparkline(&cpu_usage->usage_hist, history_level, usage_spark, HISTORY_LEN);
 
     cpu_usage->is_busy = false;
     pthread_cond_signal(&cpu_usage->cond_updating);
@@ -166,35 +447,145 @@ void cpu_window_update(WINDOW *win, CPU_data_t *cpu_usage)
     werase(win);
 
     mvwaddstr(win, 1, 1, model_cores);
-    for (core = 0; core < num_cores; core++)
+    // rows left for the cores: the model line, the totals and counters lines and
+    // an empty line before them are always printed
+    int core_rows = lines - 5;
+    int yoff = 2;
+    // one bar per core needs a row each and the full bar width ("coreN [###...] (xx.xxx%)"):
+    // switch to the compact grid if that doesn't fit in the window
+    if (numa != NULL)
     {
-        core_bars[core] = malloc(BARLEN * sizeof(char));
-        memset(core_bars[core], ' ', BARLEN * sizeof(char));
-        core_bars[core][BARLEN - 1] = '\0';
-        core_bars[core][0] = '[';
-        core_bars[core][BARLEN - 2] = ']';
-        memset(&(core_bars[core][1]), '#', ((long)round(usage_perc[core])) * sizeof(char));
-        mvwprintw(win, core + 2, 1, "core%d %s (%.3f%%)",
-                  core, core_bars[core], usage_perc[core]);
+        yoff += numa_rows_update(win, yoff, core_rows, numa, num_cores);
+    }
+    else if (num_cores > core_rows || cols < BARLEN + CPU_BAR_EXTRA)
+    {
+        yoff += cpu_grid_update(win, yoff, core_rows, core_usage, NULL, num_cores);
+    }
+    else
+    {
+        for (core = 0; core < num_cores; core++)
+        {
+            if (core_usage[core] < 0)
+            {
+                mvwprintw(win, yoff++, 1, "core%d offline", core);
+                continue;
+            }
+            memset(core_bar, ' ', BARLEN * sizeof(char));
+            core_bar[BARLEN - 1] = '\0';
+            core_bar[0] = '[';
+            core_bar[BARLEN - 2] = ']';
+            // the bar holds 100 columns, one per percent: usage above 100% (from skewed jiffies) fills it
+            memset(&core_bar[1], '#', bar_fill(core_usage[core], BARLEN - 3));
+            mvwprintw(win, yoff++, 1, "core%d %s (%.3f%%) io %.1f st %.1f",
+                      core, core_bar, core_usage[core],
+                      core_stats[core].perc[CPU_IOWAIT], core_stats[core].perc[CPU_STEAL]);
+        }
     }
-    mvwaddstr(win, num_cores + 3, 1, totals);
+    mvwaddstr(win, yoff + 1, 1, totals);
+    print_sparkline(win, usage_spark, history_level);
+    mvwaddstr(win, yoff + 2, 1, counters);
     // refresh the window to display the contents
     wrefresh(win);
+}
 
-    // free everything that was alloc'd
-    free(model_cores);
-    free(totals);
-    free(usage_perc);
-    for (core = 0; core < num_cores; core++)
+// sorts cgroups by decreasing memory usage, then by decreasing number of tasks
+static int cmp_cgroups(const void *a, const void *b)
+{
+    Cgroup *ca = *(Cgroup **)a;
+    Cgroup *cb = *(Cgroup **)b;
+    if (ca->memory_current != cb->memory_current)
     {
-        free(core_bars[core]);
+        return (ca->memory_current < cb->memory_current ? 1 : -1);
     }
-    free(core_bars);
+    return cb->num_tasks - ca->num_tasks;
+}
+
+/// function that displays the cgroups of the processes instead of the process list
+void cgroup_window_update(WINDOW *win, TaskList *tasks)
+{
+    int lines, cols;
+    getmaxyx(win, lines, cols);
+    int yoff = 1;
+    long page_size = sysconf(_SC_PAGESIZE);
+    char line[LINE_MAXLEN];
+
+    // about to access shared data: lock
+    pthread_mutex_lock(&tasks->mux_memdata);
+    while (tasks->is_busy == true)
+    {
+        pthread_cond_wait(&tasks->cond_updating, &tasks->mux_memdata);
+    }
+    tasks->is_busy = true;
+
+    // collect the cgroups in an array to sort them
+    GArray *groups = g_array_sized_new(false, false, sizeof(Cgroup *), g_hash_table_size(tasks->cgroups));
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, tasks->cgroups);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        g_array_append_val(groups, value);
+    }
+    g_array_sort(groups, cmp_cgroups);
+    long ngroups = groups->len;
+    if (tasks->cursor_start >= ngroups)
+    {
+        tasks->cursor_start = (ngroups > 0 ? ngroups - 1 : 0);
+    }
+
+    werase(win);
+    wattr_on(win, A_BOLD, NULL);
+    snprintf(line, LINE_MAXLEN, "cgroups: %ld\tprocesses: %ld\tthreads: %ld",
+             ngroups, tasks->num_ps, tasks->num_threads);
+    mvwaddnstr(win, yoff++, 0, line, cols);
+    wattr_off(win, A_BOLD, NULL);
+
+    wattr_on(win, A_STANDOUT, NULL);
+    snprintf(line, LINE_MAXLEN, " %-7s %-8s %-10s %-10s %-8s %-7s %-s",
+             "TASKS", "THREADS", "RSS (MiB)", "MEM (MiB)", "PIDS", "CPU%", "CGROUP");
+    mvwaddnstr(win, yoff++, 0, line, cols);
+    wattr_off(win, A_STANDOUT, NULL);
+
+    for (int i = 0; i < lines - yoff - 1 && tasks->cursor_start + i < ngroups; i++)
+    {
+        Cgroup *cg = g_array_index(groups, Cgroup *, tasks->cursor_start + i);
+        if (cg->has_stats == true)
+        {
+            snprintf(line, LINE_MAXLEN, " %-7ld %-8ld %-10ld %-10llu %-8ld %-7.1f %-s",
+                     cg->num_tasks, cg->num_threads, cg->resident_set * page_size / 1048576,
+                     cg->memory_current / 1048576, cg->pids_current, cg->cpu_perc, cg->path);
+        }
+        else
+        {
+            // the cgroup's files can't be read: only the aggregates are known
+            snprintf(line, LINE_MAXLEN, " %-7ld %-8ld %-10ld %-10s %-8s %-7s %-s",
+                     cg->num_tasks, cg->num_threads, cg->resident_set * page_size / 1048576,
+                     "-", "-", "-", cg->path);
+        }
+        attr_t attrs = (i == 0 ? A_REVERSE : 0);
+        wattr_on(win, attrs, NULL);
+        mvwaddnstr(win, i + yoff, 0, line, cols);
+        wattr_off(win, attrs, NULL);
+    }
+    g_array_free(groups, true);
+
+    tasks->is_busy = false;
+    pthread_cond_signal(&tasks->cond_updating);
+    // shared data is not accessed now: unlock
+    pthread_mutex_unlock(&tasks->mux_memdata);
+
+    wrefresh(win);
 }
 
 /// function that deals with meters included in the process list window
 void proc_window_update(WINDOW *win, TaskList *tasks)
 {
+    if (tasks->group_by_cgroup == true)
+    {
+        cgroup_window_update(win, tasks);
+        return;
+    }
+
     // defines colors for the table header and the process under the cursor
     short table_header_color = 4;
     short cursor_highlight_color = 5;
@@ -218,14 +609,24 @@ void proc_window_update(WINDOW *win, TaskList *tasks)
     }
     tasks->is_busy = true;
 
-    // sort processes based on the function indicated at runtime
-    g_array_sort(tasks->ps, tasks->sortfun);
+    // sort the handles of the processes based on the function indicated at runtime
+    g_array_sort_with_data(tasks->order, tasks->sortfun, tasks);
+    // the processes displayed by this frame (and those within the scroll margin) are marked,
+    // so that their expensive fields are read first
+    tasks->frame++;
+    for (long int p = tasks->cursor_start - PROC_VIEW_MARGIN;
+         p < tasks->cursor_start + lines + PROC_VIEW_MARGIN && p < tasks->num_ps; p++)
+    {
+        if (p >= 0)
+        {
+            task_at(tasks, task_handle(tasks, p))->shown_frame = tasks->frame;
+        }
+    }
 
     int running_procs = 0;
-    for (int i = 0; i < tasks->num_ps; i++)
+    for (long int h = 0; h < tasks->num_ps; h++)
     {
-        Task t = g_array_index(tasks->ps, Task, i);
-        if (t.state == 'R')
+        if (tasks->cols.state[h] == 'R')
         {
             running_procs++;
         }
@@ -234,9 +635,28 @@ void proc_window_update(WINDOW *win, TaskList *tasks)
     snprintf(proc_counters, LINE_MAXLEN,
         "processes: %ld\trunning: %d\tthreads: %ld",
         tasks->num_ps, running_procs, tasks->num_threads);
+    // the I/O columns are shown when they are enabled or sorted on
+    bool show_io = tasks_need_io(tasks);
     int null_term = snprintf(table_header, LINE_MAXLEN,
-                             " %-10s %-10s %-20s %-5s %-5s %-10s %-10s %-10s %-10s",
-                             "PID", "PPID", "USER", "STATE", "NICE", "CPU", "THREADS", "VSZ (GiB)", "CMD");
+                             " %-10s %-10s %-20s %-5s %-5s %-10s %-10s %-10s %-10s %-10s %-10s ",
+                             "PID", "PPID", "USER", "STATE", "NICE", "CPU%", "THREADS", "VSZ (MiB)",
+                             "PSS (MiB)", "USS (MiB)", "SWAP (MiB)");
+    if (show_io == true)
+    {
+        null_term += snprintf(table_header + null_term, LINE_MAXLEN - null_term, "%-10s %-10s %-10s %-10s ",
+                              "RD KiB/s", "WR KiB/s", "SYSCR/s", "SYSCW/s");
+    }
+    bool show_fds = tasks_need_fds(tasks);
+    if (show_fds == true)
+    {
+        null_term += snprintf(table_header + null_term, LINE_MAXLEN - null_term, "%-10s ", "FDS");
+    }
+    bool show_conns = tasks_need_conns(tasks);
+    if (show_conns == true)
+    {
+        null_term += snprintf(table_header + null_term, LINE_MAXLEN - null_term, "%-10s ", "CONNS");
+    }
+    null_term += snprintf(table_header + null_term, LINE_MAXLEN - null_term, "%-10s", "CMD");
     char tmp = table_header[null_term];
     table_header[null_term] = table_header[LINE_MAXLEN - 1];
     table_header[LINE_MAXLEN - 1] = tmp;
@@ -253,17 +673,73 @@ void proc_window_update(WINDOW *win, TaskList *tasks)
 
     char *procline = NULL;
     int i = 0;
-    while ((i < lines - yoff - 1) || (tasks->cursor_start + i == tasks->num_ps))
+    // stop at the end of the list as well, since the rows are marked as displayed
+    while (i < lines - yoff - 1 && tasks->cursor_start + i < tasks->num_ps)
     {
         procline = malloc(LINE_MAXLEN * sizeof(char));
         memset(procline, ' ', LINE_MAXLEN * sizeof(char));
-        Task *t = &(g_array_index(tasks->ps, Task, tasks->cursor_start + i));
+        guint h = task_handle(tasks, tasks->cursor_start + i);
+        Task *t = task_at(tasks, h);
         if (t->visible == true)
         {
+            // in viewport mode, the processes scrolled into view catch up here
+            if (t->details_pending == true)
+            {
+                get_task_details(tasks, t);
+            }
             null_term = snprintf(procline, LINE_MAXLEN,
-                                 " %-10d %-10d %-20s %-5c %-5ld %-10ld %-10ld %-10ld %-s",
-                                 t->pid, t->ppid, t->username, t->state, t->nice, t->cpu_usr + t->cpu_sys, t->num_threads,
-                                 t->virt_size_bytes / 1048576, t->command);
+                                 " %-10d %-10d %-20s %-5c %-5ld %-10ld %-10ld %-10ld ",
+                                 tasks->cols.pid[h], tasks->cols.ppid[h], t->username, tasks->cols.state[h], t->nice,
+                                 tasks->cols.cpu[h], tasks->cols.num_threads[h], tasks->cols.virt_size_bytes[h] / 1048576);
+            // the fields read only when needed are shown as unreadable ("-") until they are read
+            const struct task_extra *x = task_extra(tasks, t);
+            // the values from smaps_rollup are shown once read (they are refreshed within a time budget)
+            if (x == NULL || x->smaps_denied == true || x->smaps_time == 0)
+            {
+                null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-10s %-10s %-10s ",
+                                      "-", "-", "-");
+            }
+            else
+            {
+                null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-10.1f %-10.1f %-10.1f ",
+                                      x->pss_kb / 1024.0, x->uss_kb / 1024.0, x->swap_kb / 1024.0);
+            }
+            if (show_io == true && (x == NULL || x->io_denied == true))
+            {
+                null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-10s %-10s %-10s %-10s ",
+                                      "-", "-", "-", "-");
+            }
+            else if (show_io == true)
+            {
+                null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-10.1f %-10.1f %-10.0f %-10.0f ",
+                                      counter_rate(&x->io[TASK_IO_READ_BYTES]) / 1024,
+                                      counter_rate(&x->io[TASK_IO_WRITE_BYTES]) / 1024,
+                                      counter_rate(&x->io[TASK_IO_SYSCR]), counter_rate(&x->io[TASK_IO_SYSCW]));
+            }
+            if (show_fds == true && (x == NULL || x->fds_denied == true || x->fds_time == 0))
+            {
+                null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-10s ", "-");
+            }
+            else if (show_fds == true)
+            {
+                null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-10ld ", x->num_fds);
+            }
+            if (show_conns == true && (x == NULL || x->num_conns < 0 || x->conns_time == 0))
+            {
+                null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-10s ", "-");
+            }
+            else if (show_conns == true)
+            {
+                null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-10ld ", x->num_conns);
+            }
+            // the command line is cut at the display cap (searches use all of it)
+            null_term += snprintf(procline + null_term, LINE_MAXLEN - null_term, "%-.*s",
+                                  (tasks->cmdline_cap > 0 ? tasks->cmdline_cap : LINE_MAXLEN), t->command);
+            if (null_term > LINE_MAXLEN - 1)
+            {
+                // the line was truncated by snprintf
+                null_term = LINE_MAXLEN - 1;
+            }
             tmp = procline[null_term];
             procline[null_term] = procline[LINE_MAXLEN - 1];
             procline[LINE_MAXLEN - 1] = tmp;
@@ -297,6 +773,284 @@ void proc_window_update(WINDOW *win, TaskList *tasks)
     free(proc_counters);
 }
 
+// formats a field of a row of the diff view: its value, or both values if it changed
+static void diff_field(char *buf, size_t len, const struct task_diff *d, long before, long after)
+{
+    if (d->before != NULL && d->after != NULL && before != after)
+    {
+        snprintf(buf, len, "%ld > %ld", before, after);
+    }
+    else
+    {
+        snprintf(buf, len, "%ld", (d->after != NULL ? after : before));
+    }
+}
+
+/**
+ * \brief Displays the processes frozen, or their differences from the latest update
+ *
+ * It takes the place of proc_window_update() while the list is frozen (see freeze.h). The
+ * frozen processes are shown in the order they had on the screen when they were frozen;
+ * the diff view marks with + the processes that appeared since then, with - those that
+ * exited and with ~ those whose CPU usage, resident set or threads changed by more than the
+ * thresholds, showing the value at the freeze and the latest one. The snapshots are read
+ * without locking the TaskList: only the scrolling position is taken from it
+ * \param [in] win The process window
+ * \param [in,out] fz The state of the freeze mode, with the frozen snapshot
+ * \param [in] tasks The live processes (for the scrolling position)
+ */
+void frozen_window_update(WINDOW *win, Freeze_t *fz, TaskList *tasks)
+{
+    short cursor_highlight_color = 5;
+    init_pair(cursor_highlight_color, COLOR_WHITE, COLOR_BLUE);
+
+    int lines, cols;
+    getmaxyx(win, lines, cols);
+    int yoff = 1;
+    long page_size = sysconf(_SC_PAGESIZE);
+    char line[LINE_MAXLEN];
+    char when[16] = "?";
+    struct tm tm;
+    time_t frozen_at = fz->frozen->time_ms / 1000;
+    if (localtime_r(&frozen_at, &tm) != NULL)
+    {
+        strftime(when, sizeof(when), "%H:%M:%S", &tm);
+    }
+
+    bool show_diff = false;
+    Snapshot_t *live = freeze_get_live(fz, &show_diff);
+    long num_rows = fz->shown->len;
+    werase(win);
+    wattr_on(win, A_BOLD, NULL);
+    if (show_diff == true)
+    {
+        // until the first update since the freeze there is nothing to compare with
+        g_array_set_size(fz->diff, 0);
+        if (live != NULL)
+        {
+            freeze_diff(fz->diff, fz->frozen, live);
+        }
+        long count[3] = {0, 0, 0};
+        for (guint r = 0; r < fz->diff->len; r++)
+        {
+            count[g_array_index(fz->diff, struct task_diff, r).kind]++;
+        }
+        num_rows = fz->diff->len;
+        snprintf(line, LINE_MAXLEN, "frozen at %s\tsince then: %ld appeared, %ld exited, %ld changed\t(u: frozen list, i: unfreeze)",
+                 when, count[DIFF_APPEARED], count[DIFF_EXITED], count[DIFF_CHANGED]);
+    }
+    else
+    {
+        snprintf(line, LINE_MAXLEN, "frozen at %s\tprocesses: %u\t(u: differences, i: unfreeze)", when,
+                 fz->frozen->tasks->len);
+    }
+    mvwaddnstr(win, yoff++, 0, line, cols);
+    wattr_off(win, A_BOLD, NULL);
+
+    if (show_diff == true)
+    {
+        snprintf(line, LINE_MAXLEN, "   %-10s %-20s %-21s %-21s %-21s %-10s", "PID", "USER", "CPU%", "RSS (MiB)",
+                 "THREADS", "CMD");
+    }
+    else
+    {
+        snprintf(line, LINE_MAXLEN, " %-10s %-10s %-20s %-5s %-5s %-10s %-10s %-10s %-10s %-10s", "PID", "PPID",
+                 "USER", "STATE", "NICE", "CPU%", "THREADS", "VSZ (MiB)", "RSS (MiB)", "CMD");
+    }
+    wattr_on(win, A_STANDOUT, NULL);
+    // the bar is drawn to the end of the line
+    mvwprintw(win, yoff++, 0, "%-*.*s", cols, cols, line);
+    wattr_off(win, A_STANDOUT, NULL);
+
+    long first = tasks->cursor_start;
+    if (first >= num_rows)
+    {
+        first = (num_rows > 0 ? num_rows - 1 : 0);
+    }
+    for (int i = 0; i < lines - yoff - 1 && first + i < num_rows; i++)
+    {
+        if (show_diff == true)
+        {
+            const struct task_diff *d = &g_array_index(fz->diff, struct task_diff, first + i);
+            const struct rec_task *t = (d->after != NULL ? d->after : d->before);
+            const struct rec_task *b = (d->before != NULL ? d->before : d->after);
+            char cpu[24], rss[24], threads[24];
+            diff_field(cpu, sizeof(cpu), d, (long)b->cpu, (long)t->cpu);
+            diff_field(rss, sizeof(rss), d, b->resident_set * page_size / 1048576, t->resident_set * page_size / 1048576);
+            diff_field(threads, sizeof(threads), d, b->num_threads, t->num_threads);
+            char mark = (d->kind == DIFF_APPEARED ? '+' : (d->kind == DIFF_EXITED ? '-' : '~'));
+            snprintf(line, LINE_MAXLEN, " %c %-10d %-20s %-21s %-21s %-21s %s", mark, t->pid,
+                     (t->username != NULL ? t->username : "-"), cpu, rss, threads,
+                     (t->command != NULL ? t->command : ""));
+        }
+        else
+        {
+            const struct rec_task *t = snapshot_task(fz->frozen, g_array_index(fz->shown, guint, first + i));
+            snprintf(line, LINE_MAXLEN, " %-10d %-10d %-20s %-5c %-5ld %-10lu %-10ld %-10ld %-10ld %s", t->pid,
+                     t->ppid, (t->username != NULL ? t->username : "-"), t->state, t->nice, t->cpu, t->num_threads,
+                     t->virt_size_bytes / 1048576, t->resident_set * page_size / 1048576,
+                     (t->command != NULL ? t->command : ""));
+        }
+        // the cursor is on the first process displayed, as in the live list
+        attr_t attrs = (i == 0 ? COLOR_PAIR(cursor_highlight_color) : 0);
+        wattr_on(win, attrs, NULL);
+        mvwaddnstr(win, i + yoff, 0, line, cols);
+        wattr_off(win, attrs, NULL);
+    }
+    // the rows point into the snapshots: they are merged again at the next refresh
+    g_array_set_size(fz->diff, 0);
+    snapshot_unref(live);
+
+    wrefresh(win);
+}
+
+/**
+ * \brief Prints a sparkline after the window's cursor, if there is room left in the row
+ *
+ * The sparkline is prefixed by the name of its resolution and truncated on the left,
+ * so that the latest samples are always displayed
+ * \param [in] win The window where the sparkline is printed (at the cursor's position)
+ * \param [in] sparkline The sparkline, as built by history_sparkline()
+ * \param [in] history_level The resolution of the sparkline
+ */
+void print_sparkline(WINDOW *win, const char *sparkline, int history_level)
+{
+    int x = getcurx(win), cols = getmaxx(win);
+    char label[16];
+    int label_len = snprintf(label, sizeof(label), "  %s [", history_level_name(history_level));
+    // room for the label, the closing bracket and a blank column at the border
+    int width = cols - x - label_len - 2;
+    int len = strlen(sparkline);
+    if (width < 8)
+    {
+        return;
+    }
+    if (width > len)
+    {
+        width = len;
+    }
+    waddstr(win, label);
+    waddstr(win, sparkline + len - width);
+    waddch(win, ']');
+}
+
+/// function that prints the pressure stall averages on a single line
+void psi_window_update(WINDOW *win, PSI_data_t *psi)
+{
+    int cols = getmaxx(win);
+    char line[LINE_MAXLEN];
+    bool under_pressure;
+
+    // about to access shared data: lock
+    pthread_mutex_lock(&psi->mux_memdata);
+    while (psi->is_busy == true)
+    {
+        pthread_cond_wait(&psi->cond_updating, &psi->mux_memdata);
+    }
+    psi->is_busy = true;
+
+    struct psi_resource_data *res = psi->res;
+    if (psi->available == true)
+    {
+        snprintf(line, LINE_MAXLEN,
+                 "PSI avg10/avg60 some: cpu %.2f/%.2f  mem %.2f/%.2f  io %.2f/%.2f  full: mem %.2f/%.2f  io %.2f/%.2f",
+                 res[PSI_CPU].some.avg10, res[PSI_CPU].some.avg60,
+                 res[PSI_MEMORY].some.avg10, res[PSI_MEMORY].some.avg60,
+                 res[PSI_IO].some.avg10, res[PSI_IO].some.avg60,
+                 res[PSI_MEMORY].full.avg10, res[PSI_MEMORY].full.avg60,
+                 res[PSI_IO].full.avg10, res[PSI_IO].full.avg60);
+    }
+    else
+    {
+        snprintf(line, LINE_MAXLEN, "PSI: not available (needs a kernel with CONFIG_PSI)");
+    }
+    under_pressure = psi->under_pressure;
+
+    psi->is_busy = false;
+    pthread_cond_signal(&psi->cond_updating);
+    // shared data is not accessed now: unlock
+    pthread_mutex_unlock(&psi->mux_memdata);
+
+    werase(win);
+    mvwaddnstr(win, 0, 1, line, cols - 1);
+    if (under_pressure == true)
+    {
+        wattr_on(win, A_BOLD, NULL);
+        waddnstr(win, "  [fast refresh]", cols - getcurx(win));
+        wattr_off(win, A_BOLD, NULL);
+    }
+    wrefresh(win);
+}
+
+void replay_window_update(WINDOW *win, Replay_t *replay)
+{
+    int cols = getmaxx(win);
+    char line[LINE_MAXLEN];
+
+    pthread_mutex_lock(&replay->mux_memdata);
+    long pos = replay->shown_pos;
+    long num_frames = replay->frames->len;
+    time_t shown = (time_t)(replay->shown_ms / 1000);
+    double speed = replay->speed;
+    bool paused = replay->paused;
+    pthread_mutex_unlock(&replay->mux_memdata);
+
+    char when[32] = "-";
+    struct tm tm;
+    if (pos >= 0 && localtime_r(&shown, &tm) != NULL)
+    {
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    }
+    snprintf(line, LINE_MAXLEN, "Replay %s  frame %ld/%ld  x%g", when, pos + 1, num_frames, speed);
+
+    werase(win);
+    mvwaddnstr(win, 0, 1, line, cols - 1);
+    if (paused == true)
+    {
+        wattr_on(win, A_BOLD, NULL);
+        waddnstr(win, "  [paused]", cols - getcurx(win));
+        wattr_off(win, A_BOLD, NULL);
+    }
+    waddnstr(win, "  space: pause  [ ]: speed  < >: seek 1 min", cols - getcurx(win));
+    wrefresh(win);
+}
+
+void attach_window_update(WINDOW *win, Attach_t *attach)
+{
+    int cols = getmaxx(win);
+    char line[LINE_MAXLEN];
+
+    pthread_mutex_lock(&attach->mux_memdata);
+    uint32_t gen = attach->shown_gen;
+    long long shown_ms = attach->shown_ms;
+    int pid = attach->writer_pid;
+    pthread_mutex_unlock(&attach->mux_memdata);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    double age = (now.tv_sec * 1000LL + now.tv_nsec / 1000000 - shown_ms) / 1000.0;
+    bool running = (kill(pid, 0) == 0 || errno == EPERM);
+    if (gen == 0)
+    {
+        snprintf(line, LINE_MAXLEN, "Attached to %s (PID %d): waiting for the first snapshot", attach->name, pid);
+    }
+    else
+    {
+        snprintf(line, LINE_MAXLEN, "Attached to %s (PID %d)  snapshot #%u, %.1fs old", attach->name, pid, gen,
+                 (age > 0 ? age : 0));
+    }
+
+    werase(win);
+    mvwaddnstr(win, 0, 1, line, cols - 1);
+    if (running == false)
+    {
+        wattr_on(win, A_BOLD, NULL);
+        waddnstr(win, "  [collector stopped]", cols - getcurx(win));
+        wattr_off(win, A_BOLD, NULL);
+    }
+    wrefresh(win);
+}
+
 // initializes the bar to empty (like this: "[        ]") and the scale to mark quarters
 void init_bars(char *bar, char *scale)
 {
@@ -314,3 +1068,71 @@ void init_bars(char *bar, char *scale)
     scale[(3 * BARLEN) / 4] = '|';
     scale[BARLEN - 2] = '|';
 }
+
+/**
+ * \brief Draws the open file descriptors of a process, and the files they refer to
+ *
+ * \param [in] win The window where the list is drawn (it's erased first)
+ * \param [in] pid The PID of the process
+ * \param [in] command The command of the process (may be NULL)
+ * \param [in] fds The open file descriptors, as returned by get_fd_list()
+ * \param [in] first The index in fds of the first entry displayed (to implement scrolling)
+ */
+void fd_window_update(WINDOW *win, int pid, const char *command, GArray *fds, long int first)
+{
+    int lines, cols;
+    getmaxyx(win, lines, cols);
+    int yoff = 1;
+
+    werase(win);
+    wattr_on(win, A_BOLD, NULL);
+    mvwprintw(win, yoff++, 1, "Open files of PID %d (%s): %u", pid, (command ? command : "no cmdline"), fds->len);
+    wattr_off(win, A_BOLD, NULL);
+    mvwaddnstr(win, yoff++, 1, "arrows/page up/page down to scroll, any other key to go back", cols - 2);
+    for (long int i = first; i < (long int)fds->len && yoff < lines - 1; i++)
+    {
+        struct fd_entry *entry = &g_array_index(fds, struct fd_entry, i);
+        mvwprintw(win, yoff, 1, "%10d  ", entry->fd);
+        waddnstr(win, entry->target, cols - 14);
+        yoff++;
+    }
+    wrefresh(win);
+}
+
+/**
+ * \brief Draws a list of sockets, with their addresses, state and owner
+ *
+ * \param [in] win The window where the list is drawn (it's erased first)
+ * \param [in] title The first row of the list
+ * \param [in] net The sockets read by get_sockets()
+ * \param [in] positions The positions in net->sockets of the sockets to be displayed
+ * \param [in] first The index in positions of the first socket displayed (to implement scrolling)
+ */
+void socket_window_update(WINDOW *win, const char *title, Net_data_t *net, GArray *positions, long int first)
+{
+    int lines, cols;
+    getmaxyx(win, lines, cols);
+    int yoff = 1;
+    char local[NET_ADDRLEN];
+    char remote[NET_ADDRLEN];
+    char line[LINE_MAXLEN];
+
+    werase(win);
+    wattr_on(win, A_BOLD, NULL);
+    mvwaddnstr(win, yoff++, 1, title, cols - 2);
+    wattr_off(win, A_BOLD, NULL);
+    snprintf(line, LINE_MAXLEN, "%-5s %-47s %-47s %-12s %-10s", "PROTO", "LOCAL", "REMOTE", "STATE", "PID");
+    wattr_on(win, A_STANDOUT, NULL);
+    mvwaddnstr(win, yoff++, 1, line, cols - 2);
+    wattr_off(win, A_STANDOUT, NULL);
+    for (long int i = first; i < (long int)positions->len && yoff < lines - 1; i++)
+    {
+        struct socket_entry *s = &g_array_index(net->sockets, struct socket_entry, g_array_index(positions, guint, i));
+        socket_format_addr(s, false, local, NET_ADDRLEN);
+        socket_format_addr(s, true, remote, NET_ADDRLEN);
+        snprintf(line, LINE_MAXLEN, "%-5s %-47s %-47s %-12s %-10d",
+                 socket_proto_name(s), local, remote, socket_state_name(s), s->pid);
+        mvwaddnstr(win, yoff++, 1, line, cols - 2);
+    }
+    wrefresh(win);
+}
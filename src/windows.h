@@ -8,16 +8,53 @@
 #include "mem_info.h"
 #include "cpu_info.h"
 #include "process_info.h"
+#include "psi_info.h"
+#include "numa_info.h"
+#include "record.h"
+#include "collector.h"
+#include "freeze.h"
 
 // lenght of the scale and progress bars drawn inside the windows
 #define BARLEN 103
 // lenght of a fixed buffer that should be long enough for output lines
 #define LINE_MAXLEN 512
+// columns taken by a core's bar in addition to BARLEN (label, percentage, iowait and steal)
+#define CPU_BAR_EXTRA 38
+// width of the columns holding the other fields of /proc/meminfo in the memory window
+#define MEMINFO_COLWIDTH 30
+// glyphs used in the compact cpu grid, from idle to fully used (one every 10%)
+#define CPU_HEAT_GLYPHS ".:-=+*#%@@"
+// number of cells in each group of the compact cpu grid
+#define CPU_GRID_GROUP 8
+// the color pairs of the cells of the compact cpu grid, by usage (defined when ncurses starts)
+#define CPU_HEAT_LOW_PAIR 6
+#define CPU_HEAT_MID_PAIR 7
+#define CPU_HEAT_HIGH_PAIR 8
+// lenght of the usage bar of a NUMA node
+#define NUMA_BARLEN 20
 
 // an header that collects all functions dealing with windows
-void mem_window_update(WINDOW *win, Mem_data_t *mem_usage, int scaling);
-void cpu_window_update(WINDOW *win, CPU_data_t *cpu_usage);
+void mem_window_update(WINDOW *win, Mem_data_t *mem_usage, int scaling, int history_level, bool show_extra,
+                       CPU_data_t *vmstat_cpu);
+void cpu_window_update(WINDOW *win, CPU_data_t *cpu_usage, int history_level, NUMA_data_t *numa);
+// draws one cell per core instead of bars (used when bars don't fit in the window)
+int cpu_grid_update(WINDOW *win, int yoff, int max_rows, const float *usage, const int *ids, int num_cores);
+// draws the NUMA nodes and the grid of their cores (instead of the per-core bars)
+int numa_rows_update(WINDOW *win, int yoff, int max_rows, NUMA_data_t *numa, int num_cores);
 void proc_window_update(WINDOW *win, TaskList *tasks);
+// displays the frozen processes, or their differences from the live ones, in place of proc_window_update
+void frozen_window_update(WINDOW *win, Freeze_t *fz, TaskList *tasks);
+void fd_window_update(WINDOW *win, int pid, const char *command, GArray *fds, long int first);
+void socket_window_update(WINDOW *win, const char *title, Net_data_t *net, GArray *positions, long int first);
+void psi_window_update(WINDOW *win, PSI_data_t *psi);
+// displays the position and the speed of the replay (in place of the PSI line)
+void replay_window_update(WINDOW *win, Replay_t *replay);
+// displays the collector a client is attached to and the age of the snapshot shown (in place of the PSI line)
+void attach_window_update(WINDOW *win, Attach_t *attach);
+// displays the cgroups of the processes (called by proc_window_update in grouped mode)
+void cgroup_window_update(WINDOW *win, TaskList *tasks);
+// prints the rightmost part of a sparkline that fits in the row, after the cursor
+void print_sparkline(WINDOW *win, const char *sparkline, int history_level);
 // initializes the bar to empty (like this: "[        ]") and the scale to mark quarters
 void init_bars(char *bar, char *scale);
 